@@ -0,0 +1,28 @@
+/**
+ * @file id3_parser_fuzz.c
+ * @brief libFuzzer target for the bounded tag parser.
+ *
+ * The input is treated as the start of a file: its header is validated, then
+ * the frames are parsed from the bytes that follow it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "id3_parser.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    Id3Header hdr;
+    if (id3_parse_header(data, size, &hdr) != ID3_PARSE_OK) return 0;
+    TagData *tag = create_tag_data();
+    if (!tag) return 0;
+    id3_parse_frames(&hdr, data + ID3_HEADER_SIZE, size - ID3_HEADER_SIZE, tag);
+    // Every value that was stored must be readable within its length.
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        const char *value = tag_get(tag, (TagField)i);
+        if (value && value[tag_length(tag, (TagField)i)] != '\0') __builtin_trap();
+    }
+    free_tag_data(tag);
+    return 0;
+}
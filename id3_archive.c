@@ -0,0 +1,321 @@
+/**
+ * @file id3_archive.c
+ * @brief Export and import of raw tag blocks for a whole library in one file.
+ *
+ * Archive layout (all integers little-endian):
+ *   "MP3TAGS\0", u32 format version
+ *   repeated: u32 path length, path bytes, u32 raw tag length, u32 packed length, packed bytes
+ *   u32 0 (end marker)
+ *
+ * Packed data is a sequence of tokens, each a varint (n << 1 | zero_run): a zero run
+ * expands to n zero bytes, a literal is followed by its n bytes. Tag blocks are
+ * mostly short text and long zero padding, so this captures nearly all of the
+ * redundancy without an external compression library.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "id3_archive.h"
+#include "id3_batch.h"
+#include "id3_io.h"
+#include "id3_parser.h"
+#include "id3_utils.h"
+#include "id3_writer.h"
+#include "error_handling.h"
+
+#define ARCHIVE_MAGIC     "MP3TAGS"
+#define ARCHIVE_VERSION   1
+#define ARCHIVE_MAX_PATH  4096
+#define MIN_ZERO_RUN      4    /**< Shorter zero runs are cheaper as literals */
+
+/**
+ * @brief Shared state of an export run.
+ */
+typedef struct 
+{
+    const Id3PathList *files; /**< Files to export */
+    FILE *out;                /**< Archive being written */
+    pthread_mutex_t lock;     /**< Serializes appends to the archive */
+    int write_failed;         /**< Set once an append fails */
+} ExportState;
+
+static void put_u32(unsigned char *p, unsigned int v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static unsigned int get_u32(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static size_t put_varint(unsigned char *out, size_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+size_t id3_pack_bound(size_t len)
+{
+    // Worst case: a literal token header (up to 10 bytes) for every input byte run
+    // separated by minimal zero runs, which is below two output bytes per input byte.
+    return 2 * len + 20;
+}
+
+size_t id3_pack(const unsigned char *in, size_t len, unsigned char *out)
+{
+    size_t o = 0;
+    size_t i = 0;
+    size_t literal_start = 0;
+    while (i < len)
+    {
+        if (in[i] != 0)
+        {
+            i++;
+            continue;
+        }
+        size_t run = i;
+        while (run < len && in[run] == 0) run++;
+        if (run - i < MIN_ZERO_RUN && run < len)
+        {
+            i = run;
+            continue;
+        }
+        if (i > literal_start)
+        {
+            o += put_varint(out + o, (i - literal_start) << 1);
+            memcpy(out + o, in + literal_start, i - literal_start);
+            o += i - literal_start;
+        }
+        o += put_varint(out + o, ((run - i) << 1) | 1);
+        i = literal_start = run;
+    }
+    if (len > literal_start)
+    {
+        o += put_varint(out + o, (len - literal_start) << 1);
+        memcpy(out + o, in + literal_start, len - literal_start);
+        o += len - literal_start;
+    }
+    return o;
+}
+
+int id3_unpack(const unsigned char *in, size_t len, unsigned char *out, size_t out_len)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (i < len)
+    {
+        size_t token = 0;
+        int shift = 0;
+        for (;;)
+        {
+            if (i >= len || shift > 56) return -1;
+            unsigned char b = in[i++];
+            token |= (size_t)(b & 0x7F) << shift;
+            shift += 7;
+            if (!(b & 0x80)) break;
+        }
+        size_t n = token >> 1;
+        if (n > out_len - o) return -1;
+        if (token & 1)
+        {
+            memset(out + o, 0, n);
+        }
+        else
+        {
+            if (n > len - i) return -1;
+            memcpy(out + o, in + i, n);
+            i += n;
+        }
+        o += n;
+    }
+    return o == out_len ? 0 : -1;
+}
+
+/**
+ * @brief Batch work function exporting one file's tag block.
+ */
+static int export_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    ExportState *state = (ExportState *)ctx;
+    const char *path = state->files->paths[index];
+    size_t path_len = strlen(path);
+    if (!pool || path_len > ARCHIVE_MAX_PATH) return -1;
+
+    int fd = id3_open(path, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    unsigned char header[ID3_HEADER_SIZE];
+    Id3Header hdr;
+    if (fstat(fd, &st) != 0 || id3_pread_full(fd, header, sizeof(header), 0) != 0 ||
+        memcmp(header, "ID3", 3) != 0)
+    {
+        close(fd);
+        return 0; // Nothing to export for files without a tag
+    }
+    // Only export what import can restore.
+    Id3ParseStatus status = id3_parse_header(header, sizeof(header), &hdr);
+    if (status != ID3_PARSE_OK)
+    {
+        close(fd);
+        fprintf(stderr, "Error: %s: %s\n", path, id3_parse_status_string(status));
+        return -1;
+    }
+    size_t raw_len = ID3_HEADER_SIZE + (size_t)hdr.tag_size;
+    if ((off_t)raw_len > st.st_size)
+    {
+        close(fd);
+        fprintf(stderr, "Error: ID3 tag of %s extends past the end of the file.\n", path);
+        return -1;
+    }
+    unsigned char *raw = id3_pool_io_buffer(pool, raw_len);
+    unsigned char *packed = id3_pool_serializer_buffer(pool, id3_pack_bound(raw_len));
+    if (!raw || !packed || id3_pread_full(fd, raw, raw_len, 0) != 0)
+    {
+        close(fd);
+        fprintf(stderr, "Error: Failed to read tag of %s\n", path);
+        return -1;
+    }
+    close(fd);
+    size_t packed_len = id3_pack(raw, raw_len, packed);
+
+    unsigned char rec[12];
+    put_u32(rec, (unsigned int)path_len);
+    put_u32(rec + 4, (unsigned int)raw_len);
+    put_u32(rec + 8, (unsigned int)packed_len);
+
+    pthread_mutex_lock(&state->lock);
+    int ok = fwrite(rec, 1, 4, state->out) == 4 &&
+             fwrite(path, 1, path_len, state->out) == path_len &&
+             fwrite(rec + 4, 1, 8, state->out) == 8 &&
+             fwrite(packed, 1, packed_len, state->out) == packed_len;
+    if (!ok) state->write_failed = 1;
+    pthread_mutex_unlock(&state->lock);
+    return ok ? 0 : -1;
+}
+
+long id3_archive_export(const char *archive, const Id3PathList *files, int jobs)
+{
+    ExportState state;
+    state.files = files;
+    state.write_failed = 0;
+    state.out = fopen(archive, "wb");
+    if (!state.out)
+    {
+        display_error("Cannot create archive file.");
+        return -1;
+    }
+    // Large stdio buffer: the archive is written as one sequential stream.
+    setvbuf(state.out, NULL, _IOFBF, 1 << 20);
+    pthread_mutex_init(&state.lock, NULL);
+
+    unsigned char head[12];
+    memcpy(head, ARCHIVE_MAGIC, 8);
+    put_u32(head + 8, ARCHIVE_VERSION);
+    fwrite(head, 1, sizeof(head), state.out);
+
+    long failures = id3_batch_run(files->count, jobs, export_one, &state);
+
+    unsigned char end[4] = {0, 0, 0, 0};
+    fwrite(end, 1, sizeof(end), state.out);
+    if (fclose(state.out) != 0) state.write_failed = 1;
+    pthread_mutex_destroy(&state.lock);
+    if (state.write_failed || failures < 0)
+    {
+        display_error("Failed to write archive.");
+        return -1;
+    }
+    return failures;
+}
+
+long id3_archive_import(const char *archive)
+{
+    FILE *in = fopen(archive, "rb");
+    if (!in)
+    {
+        display_error("Cannot open archive file.");
+        return -1;
+    }
+    setvbuf(in, NULL, _IOFBF, 1 << 20);
+
+    unsigned char head[12];
+    if (fread(head, 1, sizeof(head), in) != sizeof(head) ||
+        memcmp(head, ARCHIVE_MAGIC, 8) != 0 || get_u32(head + 8) != ARCHIVE_VERSION)
+    {
+        fclose(in);
+        display_error("Not a tag archive, or unsupported archive version.");
+        return -1;
+    }
+
+    Id3Pool *pool = id3_pool_create();
+    char *path = (char *)malloc(ARCHIVE_MAX_PATH + 1);
+    long failures = 0;
+    int malformed = !pool || !path;
+    while (!malformed)
+    {
+        unsigned char rec[8];
+        if (fread(rec, 1, 4, in) != 4) { malformed = 1; break; }
+        size_t path_len = get_u32(rec);
+        if (path_len == 0) break; // End marker
+        if (path_len > ARCHIVE_MAX_PATH ||
+            fread(path, 1, path_len, in) != path_len ||
+            fread(rec, 1, 8, in) != 8)
+        {
+            malformed = 1;
+            break;
+        }
+        path[path_len] = '\0';
+
+        size_t raw_len = get_u32(rec);
+        size_t packed_len = get_u32(rec + 4);
+        if (raw_len < ID3_HEADER_SIZE || raw_len > ID3_HEADER_SIZE + (size_t)ID3_MAX_TAG_SIZE ||
+            packed_len > id3_pack_bound(raw_len))
+        {
+            malformed = 1;
+            break;
+        }
+        unsigned char *packed = id3_pool_serializer_buffer(pool, packed_len);
+        unsigned char *raw = id3_pool_io_buffer(pool, raw_len);
+        if (!packed || !raw || fread(packed, 1, packed_len, in) != packed_len ||
+            id3_unpack(packed, packed_len, raw, raw_len) != 0)
+        {
+            malformed = 1;
+            break;
+        }
+        if (write_raw_tag(path, raw, raw_len) != 0)
+        {
+            fprintf(stderr, "Error: Failed to restore tag of %s\n", path);
+            failures++;
+        }
+    }
+    fclose(in);
+    free(path);
+    id3_pool_destroy(pool);
+    if (malformed)
+    {
+        display_error("Archive is truncated or malformed.");
+        return -1;
+    }
+    return failures;
+}
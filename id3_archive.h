@@ -0,0 +1,61 @@
+#ifndef ID3_ARCHIVE_H
+#define ID3_ARCHIVE_H
+
+#include <stddef.h>
+#include "id3_scan.h"
+
+/**
+ * @brief Writes the raw tag block of every file in @p files to one archive.
+ *
+ * Tags are read by a pool of worker threads and appended to the archive as they
+ * complete, each record holding the file's path and its complete tag (header,
+ * frames and padding) in packed form. Files without an ID3 tag are skipped.
+ *
+ * @param archive Path of the archive to create.
+ * @param files   Files whose tags are exported.
+ * @param jobs    Number of worker threads (0 selects the default).
+ * @return Number of files that could not be exported, or -1 if the archive could not be written.
+ */
+long id3_archive_export(const char *archive, const Id3PathList *files, int jobs);
+
+/**
+ * @brief Restores every tag stored in an archive to the file it came from.
+ *
+ * The archive is read sequentially; each tag is written back in place when the
+ * file's current tag has room for it, and by rewriting the file otherwise.
+ *
+ * @param archive Path of the archive to read.
+ * @return Number of files that could not be restored, or -1 if the archive is unreadable or malformed.
+ */
+long id3_archive_import(const char *archive);
+
+/**
+ * @brief Returns the largest size id3_pack() can produce for @p len input bytes.
+ *
+ * @param len Input length.
+ * @return Required output buffer size.
+ */
+size_t id3_pack_bound(size_t len);
+
+/**
+ * @brief Packs a tag block, collapsing runs of zero bytes such as padding.
+ *
+ * @param in  Input bytes.
+ * @param len Number of input bytes.
+ * @param out Output buffer of at least id3_pack_bound(len) bytes.
+ * @return Number of bytes written to @p out.
+ */
+size_t id3_pack(const unsigned char *in, size_t len, unsigned char *out);
+
+/**
+ * @brief Unpacks data produced by id3_pack().
+ *
+ * @param in      Packed bytes.
+ * @param len     Number of packed bytes.
+ * @param out     Output buffer.
+ * @param out_len Exact number of bytes the packed data must expand to.
+ * @return 0 on success, -1 if the packed data is malformed or does not expand to @p out_len.
+ */
+int id3_unpack(const unsigned char *in, size_t len, unsigned char *out, size_t out_len);
+
+#endif // ID3_ARCHIVE_H
@@ -0,0 +1,170 @@
+/**
+ * @file id3_batch.c
+ * @brief Worker thread pool for processing many files in parallel.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "id3_batch.h"
+#include "id3_io.h"
+
+#define DEFERRED_JOBS_DIVISOR 4 /**< Deferred items run with this fraction of the workers */
+
+static long file_budget_ms = 0; /**< Time budget per item, or 0 for none */
+
+/**
+ * @brief State shared by all workers of one batch.
+ */
+typedef struct 
+{
+    size_t count;            /**< Number of items */
+    const size_t *items;     /**< Item indices to run, or NULL for [0, count) */
+    _Atomic size_t next;     /**< Next item to hand out */
+    _Atomic long failures;   /**< Items whose work function failed */
+    Id3BatchFn fn;           /**< Work function */
+    void *ctx;               /**< Caller context */
+    long budget_ms;          /**< Time budget per item, or 0 for none */
+    size_t *deferred;        /**< Items that ran out of time, to be run again at the end */
+    size_t ndeferred;        /**< Number of deferred items */
+    pthread_mutex_t lock;    /**< Guards deferred */
+} BatchState;
+
+/**
+ * @brief Argument of one worker thread.
+ */
+typedef struct 
+{
+    BatchState *state;       /**< Batch being processed */
+    int index;               /**< Worker number, in [0, workers) */
+} BatchWorker;
+
+static void *batch_worker(void *arg)
+{
+    BatchState *state = ((BatchWorker *)arg)->state;
+    Id3Pool *pool = id3_pool_create();
+    if (pool) pool->worker = ((BatchWorker *)arg)->index;
+    for (;;)
+    {
+        size_t i = atomic_fetch_add(&state->next, 1);
+        if (i >= state->count) break;
+        if (state->items) i = state->items[i];
+        id3_io_set_deadline(state->budget_ms);
+        // Without a pool the work functions fall back to per-call allocation.
+        int ret = state->fn(pool, i, state->ctx);
+        int timed_out = id3_io_deadline_hit();
+        id3_io_set_deadline(0);
+        if (ret != 0 && timed_out)
+        {
+            // The deferred list has room for every item, so appending cannot fail.
+            pthread_mutex_lock(&state->lock);
+            state->deferred[state->ndeferred++] = i;
+            pthread_mutex_unlock(&state->lock);
+        }
+        else if (ret != 0)
+        {
+            atomic_fetch_add(&state->failures, 1);
+        }
+    }
+    id3_pool_destroy(pool);
+    return NULL;
+}
+
+int id3_batch_default_jobs(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+int id3_batch_workers(size_t count, int jobs)
+{
+    if (jobs < 1) jobs = id3_batch_default_jobs();
+    if ((size_t)jobs > count) jobs = count > 0 ? (int)count : 1;
+    return jobs;
+}
+
+void id3_batch_set_file_budget(long ms)
+{
+    file_budget_ms = ms > 0 ? ms : 0;
+}
+
+/**
+ * @brief Runs the items of a batch state on @p jobs threads.
+ */
+static long run_state(BatchState *state, int jobs)
+{
+    jobs = id3_batch_workers(state->count, jobs);
+
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * (size_t)jobs);
+    BatchWorker *workers = (BatchWorker *)malloc(sizeof(BatchWorker) * (size_t)jobs);
+    if (!threads || !workers)
+    {
+        free(threads);
+        free(workers);
+        return -1;
+    }
+    int started = 0;
+    for (; started < jobs; started++)
+    {
+        workers[started].state = state;
+        workers[started].index = started;
+        if (pthread_create(&threads[started], NULL, batch_worker, &workers[started]) != 0) break;
+    }
+    // Any workers that did start will drain the whole batch between them.
+    if (started == 0)
+    {
+        workers[0].state = state;
+        workers[0].index = 0;
+        batch_worker(&workers[0]);
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(workers);
+    return atomic_load(&state->failures);
+}
+
+long id3_batch_run(size_t count, int jobs, Id3BatchFn fn, void *ctx)
+{
+    BatchState state = {0};
+    state.count = count;
+    atomic_init(&state.next, 0);
+    atomic_init(&state.failures, 0);
+    state.fn = fn;
+    state.ctx = ctx;
+    state.budget_ms = file_budget_ms;
+    if (state.budget_ms > 0)
+    {
+        state.deferred = (size_t *)malloc((count ? count : 1) * sizeof(size_t));
+        if (!state.deferred) return -1;
+    }
+    pthread_mutex_init(&state.lock, NULL);
+
+    long failures = run_state(&state, jobs);
+
+    // Slow items run last, without a budget and on fewer threads, so that they
+    // neither hold up the bulk of the batch nor compete with each other for the disk.
+    if (failures >= 0 && state.ndeferred > 0)
+    {
+        int deferred_jobs = id3_batch_workers(count, jobs) / DEFERRED_JOBS_DIVISOR;
+        if (deferred_jobs < 1) deferred_jobs = 1;
+        fprintf(stderr, "Retrying %zu files that exceeded the time budget with %d workers\n",
+                state.ndeferred, deferred_jobs);
+        BatchState slow = {0};
+        slow.count = state.ndeferred;
+        slow.items = state.deferred;
+        atomic_init(&slow.next, 0);
+        atomic_init(&slow.failures, 0);
+        slow.fn = fn;
+        slow.ctx = ctx;
+        long slow_failures = run_state(&slow, deferred_jobs);
+        failures = slow_failures < 0 ? -1 : failures + slow_failures;
+    }
+    pthread_mutex_destroy(&state.lock);
+    free(state.deferred);
+    return failures;
+}
@@ -0,0 +1,67 @@
+#ifndef ID3_BATCH_H
+#define ID3_BATCH_H
+
+#include <stddef.h>
+#include "id3_pool.h"
+
+/**
+ * @brief Work function run for each item of a batch.
+ *
+ * @param pool  Pool owned by the worker thread running the item.
+ * @param index Index of the item, in [0, count).
+ * @param ctx   Caller context passed to id3_batch_run().
+ * @return 0 on success, non-zero on failure.
+ */
+typedef int (*Id3BatchFn)(Id3Pool *pool, size_t index, void *ctx);
+
+/**
+ * @brief Returns the default number of worker threads (one per online CPU).
+ *
+ * @return Number of worker threads to use when none is requested.
+ */
+int id3_batch_default_jobs(void);
+
+/**
+ * @brief Returns the number of worker threads id3_batch_run() starts for a batch.
+ *
+ * Work functions can size per-worker state with it and index that state by
+ * pool->worker, which is always below this number.
+ *
+ * @param count Number of items.
+ * @param jobs  Requested number of worker threads (values below 1 select the default).
+ * @return Number of workers, at least 1.
+ */
+int id3_batch_workers(size_t count, int jobs);
+
+/**
+ * @brief Runs @p fn for every index in [0, count) on a pool of worker threads.
+ *
+ * Workers pull items from a shared counter, so long items do not hold up a
+ * fixed slice of the batch. Each worker owns an Id3Pool that is reused for
+ * all of its items; the pool's @c worker member holds the worker's number.
+ *
+ * With a per-item time budget (see id3_batch_set_file_budget()), an item whose
+ * I/O is cancelled by the budget is not counted as failed but deferred; the
+ * deferred items run again, without a budget, once all others are done.
+ *
+ * @param count Number of items.
+ * @param jobs  Number of worker threads (values below 1 select the default).
+ * @param fn    Function run for each item.
+ * @param ctx   Context passed to @p fn.
+ * @return Number of items for which @p fn failed, or -1 if workers could not be started.
+ */
+long id3_batch_run(size_t count, int jobs, Id3BatchFn fn, void *ctx);
+
+/**
+ * @brief Sets the time budget of each item of later batches.
+ *
+ * An item's reads fail with ETIMEDOUT once it has run longer than the budget
+ * (see id3_io_set_deadline()). Work functions must therefore be safe to run
+ * again for an item that failed this way, which holds for all of them since
+ * files are only replaced once their new content is complete.
+ *
+ * @param ms Budget in milliseconds, or 0 for none (the default).
+ */
+void id3_batch_set_file_budget(long ms);
+
+#endif // ID3_BATCH_H
@@ -0,0 +1,311 @@
+/**
+ * @file id3_cache.c
+ * @brief Sharded LRU cache of parsed tags, revalidated with one stat per lookup.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "id3_cache.h"
+#include "id3_reader.h"
+#include "error_handling.h"
+
+#define CACHE_MIN_BUCKETS 64 /**< Initial hash buckets per shard */
+
+/**
+ * @brief One cached tag, linked into its bucket and its shard's LRU list.
+ */
+typedef struct CacheEntry
+{
+    Id3FileStamp key;               /**< Content identity; tag_hash is not used */
+    unsigned long long hash;        /**< Hash of the key */
+    TagData *data;                  /**< Cached tag, owned by the entry */
+    size_t bytes;                   /**< Memory charged to the entry */
+    struct CacheEntry *chain;       /**< Next entry in the same bucket */
+    struct CacheEntry *newer;       /**< Towards the most recently used entry */
+    struct CacheEntry *older;       /**< Towards the least recently used entry */
+} CacheEntry;
+
+/**
+ * @brief An independently locked part of the cache.
+ */
+typedef struct
+{
+    _Alignas(64) pthread_mutex_t lock;  /**< Guards the shard; shards sit on separate cache lines */
+    CacheEntry **buckets;           /**< Hash table (power-of-two size) */
+    size_t nbuckets;                /**< Number of buckets */
+    size_t entries;                 /**< Entries in the shard */
+    CacheEntry *newest;             /**< Most recently used entry */
+    CacheEntry *oldest;             /**< Least recently used entry, evicted first */
+    size_t bytes;                   /**< Memory charged to the entries */
+    size_t budget;                  /**< Most memory the shard may use */
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} CacheShard;
+
+struct Id3Cache
+{
+    CacheShard shards[ID3_CACHE_SHARDS];
+};
+
+static unsigned long long key_hash(const Id3FileStamp *key)
+{
+    unsigned long long words[4] = { key->dev, key->ino, (unsigned long long)key->size,
+                                    (unsigned long long)key->mtime_ns };
+    return id3_hash64(words, sizeof(words), ID3_HASH64_SEED);
+}
+
+static int key_equal(const Id3FileStamp *a, const Id3FileStamp *b)
+{
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size && a->mtime_ns == b->mtime_ns;
+}
+
+static CacheShard *shard_of(Id3Cache *cache, unsigned long long hash)
+{
+    // The top bits pick the shard and the low bits the bucket, so the two are independent.
+    return &cache->shards[hash >> 60 & (ID3_CACHE_SHARDS - 1)];
+}
+
+static CacheEntry *find_entry(const CacheShard *shard, const Id3FileStamp *key, unsigned long long hash)
+{
+    CacheEntry *e = shard->buckets[hash & (shard->nbuckets - 1)];
+    while (e && (e->hash != hash || !key_equal(&e->key, key))) e = e->chain;
+    return e;
+}
+
+static void lru_unlink(CacheShard *shard, CacheEntry *e)
+{
+    if (e->newer) e->newer->older = e->older;
+    else shard->newest = e->older;
+    if (e->older) e->older->newer = e->newer;
+    else shard->oldest = e->newer;
+}
+
+static void lru_push_newest(CacheShard *shard, CacheEntry *e)
+{
+    e->newer = NULL;
+    e->older = shard->newest;
+    if (shard->newest) shard->newest->newer = e;
+    else shard->oldest = e;
+    shard->newest = e;
+}
+
+static void free_entry(CacheEntry *e)
+{
+    free_tag_data(e->data);
+    free(e);
+}
+
+/**
+ * @brief Removes an entry from its bucket, its LRU list and the shard's totals.
+ */
+static void remove_entry(CacheShard *shard, CacheEntry *e)
+{
+    CacheEntry **link = &shard->buckets[e->hash & (shard->nbuckets - 1)];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+    lru_unlink(shard, e);
+    shard->entries--;
+    shard->bytes -= e->bytes;
+}
+
+/**
+ * @brief Doubles the number of buckets; on allocation failure the chains just grow longer.
+ */
+static void grow_buckets(CacheShard *shard)
+{
+    size_t n = shard->nbuckets * 2;
+    CacheEntry **buckets = (CacheEntry **)calloc(n, sizeof(CacheEntry *));
+    if (!buckets) return;
+    for (size_t i = 0; i < shard->nbuckets; i++)
+    {
+        CacheEntry *e = shard->buckets[i];
+        while (e)
+        {
+            CacheEntry *next = e->chain;
+            e->chain = buckets[e->hash & (n - 1)];
+            buckets[e->hash & (n - 1)] = e;
+            e = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->nbuckets = n;
+}
+
+Id3Cache *id3_cache_create(size_t byte_budget)
+{
+    Id3Cache *cache = (Id3Cache *)calloc(1, sizeof(Id3Cache));
+    if (!cache) return NULL;
+    for (int i = 0; i < ID3_CACHE_SHARDS; i++)
+    {
+        CacheShard *shard = &cache->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->budget = byte_budget / ID3_CACHE_SHARDS;
+        shard->nbuckets = CACHE_MIN_BUCKETS;
+        shard->buckets = (CacheEntry **)calloc(shard->nbuckets, sizeof(CacheEntry *));
+        if (!shard->buckets)
+        {
+            id3_cache_destroy(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void id3_cache_clear(Id3Cache *cache)
+{
+    for (int i = 0; i < ID3_CACHE_SHARDS; i++)
+    {
+        CacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        CacheEntry *e = shard->newest;
+        while (e)
+        {
+            CacheEntry *older = e->older;
+            free_entry(e);
+            e = older;
+        }
+        if (shard->buckets) memset(shard->buckets, 0, shard->nbuckets * sizeof(CacheEntry *));
+        shard->newest = shard->oldest = NULL;
+        shard->entries = 0;
+        shard->bytes = 0;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+void id3_cache_destroy(Id3Cache *cache)
+{
+    if (!cache) return;
+    id3_cache_clear(cache);
+    for (int i = 0; i < ID3_CACHE_SHARDS; i++)
+    {
+        free(cache->shards[i].buckets);
+        pthread_mutex_destroy(&cache->shards[i].lock);
+    }
+    free(cache);
+}
+
+/**
+ * @brief Returns a private copy of a tag, taken from @p pool when one is given.
+ */
+static TagData *copy_out(Id3Pool *pool, const TagData *src)
+{
+    TagData *copy = pool ? id3_pool_acquire_tag(pool) : create_tag_data();
+    if (copy && copy_tag_data(copy, src) != 0)
+    {
+        if (pool) id3_pool_release_tag(pool, copy);
+        else free_tag_data(copy);
+        copy = NULL;
+    }
+    return copy;
+}
+
+/**
+ * @brief Adds a freshly read tag, keyed by the stamp the reader took of the open file.
+ */
+static void insert_tag(Id3Cache *cache, const TagData *data)
+{
+    CacheEntry *e = (CacheEntry *)malloc(sizeof(CacheEntry));
+    if (!e) return;
+    e->data = copy_out(NULL, data);
+    if (!e->data)
+    {
+        free(e);
+        return;
+    }
+    e->key = data->source;
+    e->hash = key_hash(&e->key);
+    e->bytes = sizeof(CacheEntry) + sizeof(TagData) + e->data->arena_cap;
+
+    CacheShard *shard = shard_of(cache, e->hash);
+    pthread_mutex_lock(&shard->lock);
+    if (e->bytes > shard->budget || find_entry(shard, &e->key, e->hash))
+    {
+        // Too large to cache, or another thread cached the same content meanwhile.
+        pthread_mutex_unlock(&shard->lock);
+        free_entry(e);
+        return;
+    }
+    size_t b = e->hash & (shard->nbuckets - 1);
+    e->chain = shard->buckets[b];
+    shard->buckets[b] = e;
+    lru_push_newest(shard, e);
+    shard->entries++;
+    shard->bytes += e->bytes;
+    if (shard->entries > shard->nbuckets) grow_buckets(shard);
+
+    // Entries of files that changed are never hit again and age out here.
+    CacheEntry *evicted = NULL;
+    while (shard->bytes > shard->budget)
+    {
+        CacheEntry *victim = shard->oldest;
+        remove_entry(shard, victim);
+        victim->chain = evicted;
+        evicted = victim;
+        shard->evictions++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    while (evicted)
+    {
+        CacheEntry *next = evicted->chain;
+        free_entry(evicted);
+        evicted = next;
+    }
+}
+
+TagData *id3_cache_read(Id3Cache *cache, Id3Pool *pool, const char *filename)
+{
+    struct stat st;
+    if (fstatat(AT_FDCWD, filename, &st, 0) == 0)
+    {
+        Id3FileStamp key;
+        memset(&key, 0, sizeof(key));
+        key.dev = (unsigned long long)st.st_dev;
+        key.ino = (unsigned long long)st.st_ino;
+        key.size = (long long)st.st_size;
+        key.mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        unsigned long long hash = key_hash(&key);
+        CacheShard *shard = shard_of(cache, hash);
+
+        pthread_mutex_lock(&shard->lock);
+        CacheEntry *e = find_entry(shard, &key, hash);
+        TagData *copy = NULL;
+        if (e)
+        {
+            lru_unlink(shard, e);
+            lru_push_newest(shard, e);
+            copy = copy_out(pool, e->data);
+        }
+        if (copy) shard->hits++;
+        else shard->misses++;
+        pthread_mutex_unlock(&shard->lock);
+        if (copy) return copy;
+    }
+
+    TagData *data = read_id3_tags_pooled(pool, filename);
+    if (data) insert_tag(cache, data);
+    return data;
+}
+
+void id3_cache_stats(Id3Cache *cache, Id3CacheStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < ID3_CACHE_SHARDS; i++)
+    {
+        CacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->entries;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
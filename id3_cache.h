@@ -0,0 +1,81 @@
+#ifndef ID3_CACHE_H
+#define ID3_CACHE_H
+
+#include <stddef.h>
+#include "id3_pool.h"
+#include "id3_utils.h"
+
+#define ID3_CACHE_SHARDS 16 /**< Independently locked parts of a cache */
+
+/**
+ * @brief Cache of parsed tags for applications that read the same files repeatedly.
+ *
+ * Entries are keyed by the identity of the file's content as reported by
+ * stat(): device, inode, size and modification time in nanoseconds. A lookup
+ * costs one fstatat() and a copy of the cached tag; a file that was changed
+ * or replaced has a new key and is read again. Hardlinks share one entry.
+ *
+ * The cache is split into ID3_CACHE_SHARDS shards, each with its own lock,
+ * hash table and least-recently-used list, so concurrent lookups of different
+ * files rarely contend. Each shard evicts its least recently used tags once
+ * it holds more than its share of the byte budget.
+ */
+typedef struct Id3Cache Id3Cache;
+
+/**
+ * @brief Counters of a cache.
+ */
+typedef struct
+{
+    unsigned long long hits;     /**< Lookups answered from the cache */
+    unsigned long long misses;   /**< Lookups that read the file */
+    unsigned long long evictions;/**< Tags dropped to stay within the budget */
+    size_t entries;              /**< Tags currently cached */
+    size_t bytes;                /**< Memory charged to the cached tags */
+} Id3CacheStats;
+
+/**
+ * @brief Creates an empty cache.
+ *
+ * @param byte_budget Most memory the cached tags may use, in bytes.
+ * @return Pointer to the new cache, or NULL if allocation fails.
+ */
+Id3Cache *id3_cache_create(size_t byte_budget);
+
+/**
+ * @brief Frees a cache and every tag in it.
+ *
+ * @param cache Cache to destroy (may be NULL).
+ */
+void id3_cache_destroy(Id3Cache *cache);
+
+/**
+ * @brief Returns the tags of a file, from the cache when its content is unchanged.
+ *
+ * Drop-in replacement for read_id3_tags_pooled(): the result is a private
+ * copy owned by the caller, released with id3_pool_release_tag() when it came
+ * from a pool and free_tag_data() otherwise. Safe to call from several threads.
+ *
+ * @param cache    Cache to look in.
+ * @param pool     Pool to take the copy from, or NULL to allocate it.
+ * @param filename File to read.
+ * @return Tags of the file, or NULL on failure (an error has been displayed).
+ */
+TagData *id3_cache_read(Id3Cache *cache, Id3Pool *pool, const char *filename);
+
+/**
+ * @brief Drops every cached tag.
+ *
+ * @param cache Cache to clear.
+ */
+void id3_cache_clear(Id3Cache *cache);
+
+/**
+ * @brief Returns the counters of a cache, summed over its shards.
+ *
+ * @param cache Cache to inspect.
+ * @param stats Output counters.
+ */
+void id3_cache_stats(Id3Cache *cache, Id3CacheStats *stats);
+
+#endif // ID3_CACHE_H
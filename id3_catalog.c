@@ -0,0 +1,325 @@
+/**
+ * @file id3_catalog.c
+ * @brief Lock-free readable tag catalog with epoch-based reclamation.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_catalog.h"
+#include "id3_reader.h"
+
+#define CATALOG_DEFAULT_CAPACITY (1u << 20)
+#define CATALOG_COLLECT_BATCH    64 /**< Retired records that trigger a reclamation attempt */
+
+/**
+ * @brief Path of a slot. Once stored, a key never changes and lives as long as
+ *        the catalog, so lookups can compare keys without being protected.
+ */
+typedef struct
+{
+    unsigned long long hash;          /**< Hash of the path */
+    char path[];                      /**< Path bytes */
+} CatalogKey;
+
+/**
+ * @brief A published record together with its reclamation state.
+ */
+typedef struct CatalogRecord
+{
+    Id3CatalogRecord pub;             /**< What readers see */
+    struct CatalogRecord *next_retired; /**< Link in the retired list */
+    unsigned long retired_epoch;      /**< Epoch the record was replaced in */
+} CatalogRecord;
+
+/**
+ * @brief One entry of the table: a path for good, and its current record (NULL if removed).
+ */
+typedef struct
+{
+    _Atomic(CatalogKey *) key;
+    _Atomic(CatalogRecord *) record;
+} CatalogSlot;
+
+struct Id3Catalog
+{
+    CatalogSlot *slots;               /**< Open-addressing table */
+    size_t mask;                      /**< Number of slots minus one */
+    unsigned int capacity;            /**< Most distinct paths */
+    _Atomic unsigned int keys;        /**< Slots in use */
+    _Atomic size_t live;              /**< Paths with a record */
+    _Atomic unsigned long long next_version;
+
+    _Atomic unsigned long epoch;      /**< Global epoch */
+    _Atomic unsigned long active[ID3_CATALOG_MAX_READERS]; /**< (epoch << 1) | 1 while pinned, else 0 */
+    _Atomic int claimed[ID3_CATALOG_MAX_READERS];          /**< Reader slots in use */
+
+    pthread_mutex_t retire_lock;      /**< Guards the retired list; only writers take it */
+    CatalogRecord *retired;           /**< Replaced records not yet freed */
+    size_t nretired;                  /**< Length of the retired list */
+};
+
+static void free_record(CatalogRecord *record)
+{
+    if (!record) return;
+    free_tag_data((TagData *)record->pub.data);
+    free(record);
+}
+
+/**
+ * @brief Returns the slot holding @p path, or NULL if the path has none.
+ */
+static CatalogSlot *find_slot(Id3Catalog *catalog, const char *path, unsigned long long hash)
+{
+    for (size_t i = (size_t)hash & catalog->mask;; i = (i + 1) & catalog->mask)
+    {
+        CatalogKey *key = atomic_load_explicit(&catalog->slots[i].key, memory_order_acquire);
+        if (!key) return NULL;
+        if (key->hash == hash && strcmp(key->path, path) == 0) return &catalog->slots[i];
+    }
+}
+
+/**
+ * @brief Returns the slot of @p path, claiming an empty one if the path is new.
+ */
+static CatalogSlot *claim_slot(Id3Catalog *catalog, const char *path, unsigned long long hash)
+{
+    CatalogKey *mine = NULL;
+    for (size_t i = (size_t)hash & catalog->mask;; i = (i + 1) & catalog->mask)
+    {
+        CatalogKey *key = atomic_load_explicit(&catalog->slots[i].key, memory_order_acquire);
+        if (!key)
+        {
+            if (!mine)
+            {
+                // Reserve room for the new path once, then try to take the empty slot.
+                if (atomic_fetch_add(&catalog->keys, 1) >= catalog->capacity)
+                {
+                    atomic_fetch_sub(&catalog->keys, 1);
+                    return NULL;
+                }
+                size_t len = strlen(path);
+                mine = (CatalogKey *)malloc(sizeof(CatalogKey) + len + 1);
+                if (!mine)
+                {
+                    atomic_fetch_sub(&catalog->keys, 1);
+                    return NULL;
+                }
+                mine->hash = hash;
+                memcpy(mine->path, path, len + 1);
+            }
+            if (atomic_compare_exchange_strong(&catalog->slots[i].key, &key, mine)) return &catalog->slots[i];
+            // Another writer took the slot; look at the key it stored.
+        }
+        if (key->hash == hash && strcmp(key->path, path) == 0)
+        {
+            if (mine)
+            {
+                free(mine);
+                atomic_fetch_sub(&catalog->keys, 1);
+            }
+            return &catalog->slots[i];
+        }
+    }
+}
+
+/**
+ * @brief Advances the epoch if every pinned reader has seen the current one,
+ *        then frees the records no reader can still hold. Called with retire_lock held.
+ *
+ * A record replaced in epoch e can only be held by readers pinned in e or
+ * earlier, so it is freed once the epoch has advanced twice past e.
+ */
+static void collect(Id3Catalog *catalog)
+{
+    unsigned long epoch = atomic_load(&catalog->epoch);
+    int advance = 1;
+    for (int i = 0; i < ID3_CATALOG_MAX_READERS && advance; i++)
+    {
+        unsigned long a = atomic_load(&catalog->active[i]);
+        if (a && (a >> 1) != epoch) advance = 0;
+    }
+    if (advance)
+    {
+        epoch++;
+        atomic_store(&catalog->epoch, epoch);
+    }
+
+    CatalogRecord **link = &catalog->retired;
+    while (*link)
+    {
+        CatalogRecord *r = *link;
+        if (r->retired_epoch + 2 <= epoch)
+        {
+            *link = r->next_retired;
+            catalog->nretired--;
+            free_record(r);
+        }
+        else
+        {
+            link = &r->next_retired;
+        }
+    }
+}
+
+static void retire(Id3Catalog *catalog, CatalogRecord *record)
+{
+    pthread_mutex_lock(&catalog->retire_lock);
+    record->retired_epoch = atomic_load(&catalog->epoch);
+    record->next_retired = catalog->retired;
+    catalog->retired = record;
+    if (++catalog->nretired >= CATALOG_COLLECT_BATCH) collect(catalog);
+    pthread_mutex_unlock(&catalog->retire_lock);
+}
+
+/**
+ * @brief Swaps the record of a slot (NULL removes it) and retires the record it replaces.
+ */
+static void publish(Id3Catalog *catalog, CatalogSlot *slot, CatalogRecord *record)
+{
+    CatalogRecord *old = atomic_exchange(&slot->record, record);
+    if (record && !old) atomic_fetch_add(&catalog->live, 1);
+    if (!record && old) atomic_fetch_sub(&catalog->live, 1);
+    if (old) retire(catalog, old);
+}
+
+Id3Catalog *id3_catalog_create(unsigned int capacity)
+{
+    if (capacity == 0) capacity = CATALOG_DEFAULT_CAPACITY;
+    if (capacity > (1u << 30)) return NULL;
+    Id3Catalog *catalog = (Id3Catalog *)calloc(1, sizeof(Id3Catalog));
+    if (!catalog) return NULL;
+    // Keep the table at most half full so probe sequences stay short.
+    size_t slots = 16;
+    while (slots < 2 * (size_t)capacity) slots *= 2;
+    catalog->slots = (CatalogSlot *)calloc(slots, sizeof(CatalogSlot));
+    if (!catalog->slots)
+    {
+        free(catalog);
+        return NULL;
+    }
+    catalog->mask = slots - 1;
+    catalog->capacity = capacity;
+    atomic_init(&catalog->epoch, 1);
+    pthread_mutex_init(&catalog->retire_lock, NULL);
+    return catalog;
+}
+
+void id3_catalog_destroy(Id3Catalog *catalog)
+{
+    if (!catalog) return;
+    for (size_t i = 0; i <= catalog->mask; i++)
+    {
+        free_record(atomic_load(&catalog->slots[i].record));
+        free(atomic_load(&catalog->slots[i].key));
+    }
+    while (catalog->retired)
+    {
+        CatalogRecord *next = catalog->retired->next_retired;
+        free_record(catalog->retired);
+        catalog->retired = next;
+    }
+    free(catalog->slots);
+    pthread_mutex_destroy(&catalog->retire_lock);
+    free(catalog);
+}
+
+int id3_catalog_reader_open(Id3Catalog *catalog, Id3CatalogReader *reader)
+{
+    for (int i = 0; i < ID3_CATALOG_MAX_READERS; i++)
+    {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&catalog->claimed[i], &expected, 1))
+        {
+            reader->catalog = catalog;
+            reader->slot = i;
+            return 0;
+        }
+    }
+    reader->catalog = NULL;
+    reader->slot = -1;
+    return -1;
+}
+
+void id3_catalog_reader_close(Id3CatalogReader *reader)
+{
+    if (reader->slot >= 0) atomic_store(&reader->catalog->claimed[reader->slot], 0);
+    reader->slot = -1;
+}
+
+void id3_catalog_pin(Id3CatalogReader *reader)
+{
+    Id3Catalog *catalog = reader->catalog;
+    unsigned long epoch;
+    // Announce the epoch, then check it is still current; otherwise a collector
+    // that missed the announcement may already be two epochs ahead.
+    do
+    {
+        epoch = atomic_load(&catalog->epoch);
+        atomic_store(&catalog->active[reader->slot], (epoch << 1) | 1);
+    } while (atomic_load(&catalog->epoch) != epoch);
+}
+
+void id3_catalog_unpin(Id3CatalogReader *reader)
+{
+    atomic_store_explicit(&reader->catalog->active[reader->slot], 0, memory_order_release);
+}
+
+const Id3CatalogRecord *id3_catalog_find(Id3Catalog *catalog, const char *path)
+{
+    CatalogSlot *slot = find_slot(catalog, path, id3_hash64(path, strlen(path), ID3_HASH64_SEED));
+    CatalogRecord *record = slot ? atomic_load_explicit(&slot->record, memory_order_acquire) : NULL;
+    return record ? &record->pub : NULL;
+}
+
+int id3_catalog_update(Id3Catalog *catalog, const char *path, const TagData *data)
+{
+    CatalogSlot *slot = claim_slot(catalog, path, id3_hash64(path, strlen(path), ID3_HASH64_SEED));
+    if (!slot) return -1;
+    CatalogRecord *record = (CatalogRecord *)malloc(sizeof(CatalogRecord));
+    TagData *copy = create_tag_data();
+    if (!record || !copy || copy_tag_data(copy, data) != 0)
+    {
+        free(record);
+        free_tag_data(copy);
+        return -1;
+    }
+    // The key outlives every record, so records can point at its path.
+    record->pub.path = atomic_load(&slot->key)->path;
+    record->pub.data = copy;
+    record->pub.version = atomic_fetch_add(&catalog->next_version, 1) + 1;
+    publish(catalog, slot, record);
+    return 0;
+}
+
+int id3_catalog_load(Id3Catalog *catalog, Id3Pool *pool, const char *path)
+{
+    TagData *data = read_id3_tags_pooled(pool, path);
+    if (!data) return -1;
+    int ret = id3_catalog_update(catalog, path, data);
+    if (pool) id3_pool_release_tag(pool, data);
+    else free_tag_data(data);
+    return ret;
+}
+
+int id3_catalog_remove(Id3Catalog *catalog, const char *path)
+{
+    // The path keeps its slot, so probe sequences through it stay intact.
+    CatalogSlot *slot = find_slot(catalog, path, id3_hash64(path, strlen(path), ID3_HASH64_SEED));
+    if (slot) publish(catalog, slot, NULL);
+    return 0;
+}
+
+size_t id3_catalog_count(Id3Catalog *catalog)
+{
+    return atomic_load(&catalog->live);
+}
+
+size_t id3_catalog_retired(Id3Catalog *catalog)
+{
+    pthread_mutex_lock(&catalog->retire_lock);
+    size_t n = catalog->nretired;
+    pthread_mutex_unlock(&catalog->retire_lock);
+    return n;
+}
@@ -0,0 +1,156 @@
+#ifndef ID3_CATALOG_H
+#define ID3_CATALOG_H
+
+#include <stddef.h>
+#include "id3_pool.h"
+#include "id3_utils.h"
+
+#define ID3_CATALOG_MAX_READERS 256 /**< Reader handles open at once per catalog */
+
+/**
+ * @brief In-memory catalog of a library's tags that can be updated while it is read.
+ *
+ * Each file's tags are held in an immutable record. An update builds a new
+ * record and publishes it with a single atomic exchange, so readers never take
+ * a lock and never wait for a writer: they see either the old or the new
+ * record. Replaced records are reclaimed with epoch-based reclamation: a record
+ * is freed only once every reader that could still hold it has moved on.
+ *
+ * Readers use a handle (one per thread) and pin the catalog around lookups:
+ * @code
+ * Id3CatalogReader reader;
+ * id3_catalog_reader_open(catalog, &reader);
+ * id3_catalog_pin(&reader);
+ * const Id3CatalogRecord *record = id3_catalog_find(catalog, "a.mp3");
+ * ... use record->data ...
+ * id3_catalog_unpin(&reader);
+ * @endcode
+ *
+ * Like the intern table, the catalog does not resize, which keeps lookups
+ * lock-free; it holds at most the number of files given at creation.
+ */
+typedef struct Id3Catalog Id3Catalog;
+
+/**
+ * @brief One version of a file's tags.
+ */
+typedef struct
+{
+    const char *path;          /**< File path */
+    const TagData *data;       /**< Tags of the file */
+    unsigned long long version;/**< Increases with every update of the catalog */
+} Id3CatalogRecord;
+
+/**
+ * @brief A reader's registration with a catalog; owned by a single thread.
+ */
+typedef struct
+{
+    Id3Catalog *catalog;       /**< Catalog read */
+    int slot;                  /**< Reader slot, or -1 when closed */
+} Id3CatalogReader;
+
+/**
+ * @brief Creates an empty catalog.
+ *
+ * @param capacity Most files the catalog can hold (0 selects a default).
+ * @return Pointer to the new catalog, or NULL if allocation fails.
+ */
+Id3Catalog *id3_catalog_create(unsigned int capacity);
+
+/**
+ * @brief Frees a catalog and all records; no reader may be pinned.
+ *
+ * @param catalog Catalog to destroy (may be NULL).
+ */
+void id3_catalog_destroy(Id3Catalog *catalog);
+
+/**
+ * @brief Registers a reader.
+ *
+ * @param catalog Catalog to read.
+ * @param reader  Handle to initialize.
+ * @return 0 on success, -1 if ID3_CATALOG_MAX_READERS handles are already open.
+ */
+int id3_catalog_reader_open(Id3Catalog *catalog, Id3CatalogReader *reader);
+
+/**
+ * @brief Unregisters a reader; it must not be pinned.
+ *
+ * @param reader Handle to close.
+ */
+void id3_catalog_reader_close(Id3CatalogReader *reader);
+
+/**
+ * @brief Starts a read-side critical section.
+ *
+ * Records found while pinned stay valid until id3_catalog_unpin(). Pins are
+ * short: a reader that stays pinned delays the freeing of replaced records
+ * (but never blocks writers). Pins do not nest.
+ *
+ * @param reader Open handle.
+ */
+void id3_catalog_pin(Id3CatalogReader *reader);
+
+/**
+ * @brief Ends a read-side critical section.
+ *
+ * @param reader Pinned handle.
+ */
+void id3_catalog_unpin(Id3CatalogReader *reader);
+
+/**
+ * @brief Looks up the current record of a file; the caller must be pinned.
+ *
+ * @param catalog Catalog to search.
+ * @param path    File path.
+ * @return Record of the file, or NULL if it is not in the catalog.
+ */
+const Id3CatalogRecord *id3_catalog_find(Id3Catalog *catalog, const char *path);
+
+/**
+ * @brief Publishes new tags for a file, adding it if it is new.
+ *
+ * Safe to call from several threads at once, also for the same file; the last
+ * exchange wins.
+ *
+ * @param catalog Catalog to update.
+ * @param path    File path.
+ * @param data    New tags; copied.
+ * @return 0 on success, -1 on allocation failure or a full catalog.
+ */
+int id3_catalog_update(Id3Catalog *catalog, const char *path, const TagData *data);
+
+/**
+ * @brief Re-reads a file with read_id3_tags_pooled() and publishes its tags.
+ *
+ * @param catalog Catalog to update.
+ * @param pool    Pool of the calling worker, or NULL.
+ * @param path    File to read.
+ * @return 0 on success, -1 if the file could not be read or published.
+ */
+int id3_catalog_load(Id3Catalog *catalog, Id3Pool *pool, const char *path);
+
+/**
+ * @brief Removes a file from the catalog.
+ *
+ * @param catalog Catalog to update.
+ * @param path    File path.
+ * @return 0 (also if the file was not present).
+ */
+int id3_catalog_remove(Id3Catalog *catalog, const char *path);
+
+/**
+ * @brief Returns the number of files in the catalog.
+ */
+size_t id3_catalog_count(Id3Catalog *catalog);
+
+/**
+ * @brief Returns the number of replaced or removed records not yet freed.
+ *
+ * Stays below a small batch while readers keep unpinning; grows while a reader
+ * stays pinned.
+ */
+size_t id3_catalog_retired(Id3Catalog *catalog);
+
+#endif // ID3_CATALOG_H
@@ -0,0 +1,170 @@
+/**
+ * @file id3_checkpoint.c
+ * @brief Append-only logs of completed files, for resuming and merging runs.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "id3_checkpoint.h"
+#include "id3_scan.h"
+#include "id3_utils.h"
+#include "error_handling.h"
+
+static int log_fd = -1;         /**< Open log, or -1 */
+static char **done_slots;       /**< Open-addressing set of completed paths */
+static size_t done_cap;         /**< Number of slots (power of two) */
+
+/**
+ * @brief Reads every line of a log into a path list.
+ */
+static int read_log(const char *filename, Id3PathList *list)
+{
+    FILE *fp = fopen(filename, "r");
+    if (!fp) return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int ret = 0;
+    while (ret == 0 && (len = getline(&line, &cap, fp)) >= 0)
+    {
+        if (len > 0 && line[len - 1] == '\n') line[--len] = '\0';
+        if (len > 0) ret = id3_path_list_add(list, line);
+    }
+    free(line);
+    fclose(fp);
+    return ret;
+}
+
+static size_t slot_of(const char *path)
+{
+    return (size_t)id3_hash64(path, strlen(path), ID3_HASH64_SEED) & (done_cap - 1);
+}
+
+int id3_checkpoint_open(const char *filename)
+{
+    Id3PathList done = {0};
+    if (access(filename, F_OK) == 0 && read_log(filename, &done) != 0)
+    {
+        id3_path_list_free(&done);
+        display_error("Cannot read checkpoint log.");
+        return -1;
+    }
+
+    // Keep the set at most half full; it takes over the path strings.
+    done_cap = 16;
+    while (done_cap < 2 * done.count) done_cap *= 2;
+    done_slots = (char **)calloc(done_cap, sizeof(char *));
+    if (!done_slots)
+    {
+        id3_path_list_free(&done);
+        display_error("Memory allocation failed.");
+        return -1;
+    }
+    for (size_t i = 0; i < done.count; i++)
+    {
+        size_t s = slot_of(done.paths[i]);
+        while (done_slots[s] && strcmp(done_slots[s], done.paths[i]) != 0) s = (s + 1) & (done_cap - 1);
+        if (done_slots[s]) free(done.paths[i]);
+        else done_slots[s] = done.paths[i];
+    }
+    free(done.paths);
+
+    log_fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (log_fd < 0)
+    {
+        id3_checkpoint_close();
+        display_error("Cannot open checkpoint log for writing.");
+        return -1;
+    }
+    return 0;
+}
+
+int id3_checkpoint_contains(const char *path)
+{
+    if (!done_slots) return 0;
+    for (size_t s = slot_of(path); done_slots[s]; s = (s + 1) & (done_cap - 1))
+    {
+        if (strcmp(done_slots[s], path) == 0) return 1;
+    }
+    return 0;
+}
+
+void id3_checkpoint_record(const char *path)
+{
+    if (log_fd < 0 || strchr(path, '\n')) return;
+    size_t len = strlen(path);
+    char local[512];
+    char *line = len + 1 <= sizeof(local) ? local : (char *)malloc(len + 1);
+    if (!line) return;
+    memcpy(line, path, len);
+    line[len] = '\n';
+    // One write() per line: O_APPEND makes each one land whole at the end of the log.
+    if (write(log_fd, line, len + 1) != (ssize_t)(len + 1))
+    {
+        display_error("Failed to append to checkpoint log.");
+    }
+    if (line != local) free(line);
+}
+
+void id3_checkpoint_close(void)
+{
+    if (log_fd >= 0) close(log_fd);
+    log_fd = -1;
+    for (size_t i = 0; done_slots && i < done_cap; i++)
+    {
+        free(done_slots[i]);
+    }
+    free(done_slots);
+    done_slots = NULL;
+    done_cap = 0;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+long id3_checkpoint_merge(const char *out_path, char *const inputs[], int count)
+{
+    Id3PathList all = {0};
+    for (int i = 0; i < count; i++)
+    {
+        if (read_log(inputs[i], &all) != 0)
+        {
+            fprintf(stderr, "Error: Cannot read checkpoint log %s\n", inputs[i]);
+            id3_path_list_free(&all);
+            return -1;
+        }
+    }
+    qsort(all.paths, all.count, sizeof(char *), compare_paths);
+
+    FILE *out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!out)
+    {
+        id3_path_list_free(&all);
+        display_error("Cannot create merged checkpoint log.");
+        return -1;
+    }
+    long distinct = 0;
+    for (size_t i = 0; i < all.count; i++)
+    {
+        if (i > 0 && strcmp(all.paths[i], all.paths[i - 1]) == 0) continue;
+        fprintf(out, "%s\n", all.paths[i]);
+        distinct++;
+    }
+    int failed = ferror(out);
+    if (out == stdout) fflush(out);
+    else if (fclose(out) != 0) failed = 1;
+    id3_path_list_free(&all);
+    if (failed)
+    {
+        display_error("Failed to write merged checkpoint log.");
+        return -1;
+    }
+    return distinct;
+}
@@ -0,0 +1,52 @@
+#ifndef ID3_CHECKPOINT_H
+#define ID3_CHECKPOINT_H
+
+/**
+ * @brief Opens a checkpoint log, creating it if needed.
+ *
+ * A checkpoint log lists, one per line, the files whose edit has completed.
+ * Files already listed when the log is opened are skipped by id3_scan_paths()
+ * and --apply, so an interrupted run resumes where it stopped; files finished
+ * from now on are appended as they complete.
+ *
+ * @param filename Log file.
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_checkpoint_open(const char *filename);
+
+/**
+ * @brief Returns non-zero if a checkpoint log is open and lists @p path.
+ *
+ * Safe to call from several threads once the log is open.
+ *
+ * @param path File path as given to or produced by the scan.
+ * @return Non-zero if the file was completed by an earlier run.
+ */
+int id3_checkpoint_contains(const char *path);
+
+/**
+ * @brief Appends a completed file to the open checkpoint log, if any.
+ *
+ * Each line is written with a single append, so concurrent workers and processes
+ * sharing a log never interleave within a line.
+ *
+ * @param path File that has been completed.
+ */
+void id3_checkpoint_record(const char *path);
+
+/**
+ * @brief Closes the checkpoint log and frees the list of completed files.
+ */
+void id3_checkpoint_close(void);
+
+/**
+ * @brief Merges checkpoint logs into one sorted log without duplicates.
+ *
+ * @param out_path Log to create ("-" for standard output).
+ * @param inputs   Logs to merge, e.g. one per shard.
+ * @param count    Number of logs.
+ * @return Number of distinct files in the merged log, or -1 on failure.
+ */
+long id3_checkpoint_merge(const char *out_path, char *const inputs[], int count);
+
+#endif // ID3_CHECKPOINT_H
@@ -0,0 +1,138 @@
+/**
+ * @file id3_csv.c
+ * @brief Streaming reader and writer helpers for CSV/TSV files.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "id3_csv.h"
+
+/**
+ * @brief Appends one byte to the current record's cell buffer.
+ */
+static int push_byte(Id3CsvReader *reader, char c)
+{
+    if (reader->buf_len == reader->buf_cap)
+    {
+        size_t cap = reader->buf_cap ? reader->buf_cap * 2 : 1024;
+        char *buf = (char *)realloc(reader->buf, cap);
+        if (!buf) return -1;
+        reader->buf = buf;
+        reader->buf_cap = cap;
+    }
+    reader->buf[reader->buf_len++] = c;
+    return 0;
+}
+
+/**
+ * @brief Records that a new cell starts at the current end of the buffer.
+ */
+static int start_cell(Id3CsvReader *reader)
+{
+    if (reader->ncells == reader->cells_cap)
+    {
+        size_t cap = reader->cells_cap ? reader->cells_cap * 2 : 16;
+        size_t *cells = (size_t *)realloc(reader->cells, cap * sizeof(size_t));
+        if (!cells) return -1;
+        reader->cells = cells;
+        reader->cells_cap = cap;
+    }
+    reader->cells[reader->ncells++] = reader->buf_len;
+    return 0;
+}
+
+int id3_csv_open(Id3CsvReader *reader, const char *filename, char delim)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->fp = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (!reader->fp) return -1;
+    reader->delim = delim;
+    return 0;
+}
+
+int id3_csv_next(Id3CsvReader *reader)
+{
+    FILE *fp = reader->fp;
+    int c;
+
+    // Skip blank lines between records.
+    do
+    {
+        c = getc(fp);
+        if (c == '\n') reader->line++;
+    } while (c == '\n' || c == '\r');
+    if (c == EOF) return 0;
+
+    reader->line++;
+    reader->buf_len = 0;
+    reader->ncells = 0;
+    if (start_cell(reader) != 0) return -1;
+
+    int quoted = 0;
+    for (;; c = getc(fp))
+    {
+        // Cells are NUL-terminated in buf; cells[] holds where each one starts.
+        if (quoted)
+        {
+            if (c == EOF) return -1; // Unterminated quoted cell
+            if (c == '"')
+            {
+                int next = getc(fp);
+                if (next != '"')
+                {
+                    quoted = 0;
+                    ungetc(next, fp);
+                    continue;
+                }
+            }
+            if (c == '\n') reader->line++;
+            if (push_byte(reader, (char)c) != 0) return -1;
+            continue;
+        }
+        if (c == EOF || c == '\n') break;
+        if (c == '\r') continue;
+        if (reader->delim == 0 && (c == ',' || c == '\t')) reader->delim = (char)c;
+        if (c == reader->delim)
+        {
+            if (push_byte(reader, '\0') != 0 || start_cell(reader) != 0) return -1;
+            continue;
+        }
+        if (c == '"' && reader->buf_len == reader->cells[reader->ncells - 1])
+        {
+            quoted = 1;
+            continue;
+        }
+        if (push_byte(reader, (char)c) != 0) return -1;
+    }
+    return push_byte(reader, '\0') == 0 ? 1 : -1;
+}
+
+const char *id3_csv_cell(const Id3CsvReader *reader, size_t i)
+{
+    return i < reader->ncells ? reader->buf + reader->cells[i] : "";
+}
+
+void id3_csv_close(Id3CsvReader *reader)
+{
+    if (reader->fp && reader->fp != stdin) fclose(reader->fp);
+    free(reader->buf);
+    free(reader->cells);
+    memset(reader, 0, sizeof(*reader));
+}
+
+void id3_csv_write_cell(FILE *fp, const char *value, char delim)
+{
+    if (!value) return;
+    if (!strchr(value, delim) && !strpbrk(value, "\"\n\r"))
+    {
+        fputs(value, fp);
+        return;
+    }
+    putc('"', fp);
+    for (const char *p = value; *p; p++)
+    {
+        if (*p == '"') putc('"', fp);
+        putc(*p, fp);
+    }
+    putc('"', fp);
+}
@@ -0,0 +1,71 @@
+#ifndef ID3_CSV_H
+#define ID3_CSV_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * @brief Streaming reader for comma- or tab-separated files.
+ *
+ * Records are read one at a time into buffers that are reused for the next
+ * record, so memory use does not depend on the size of the file. Cells may be
+ * quoted with double quotes ("" inside a quoted cell is a literal quote), which
+ * allows delimiters and newlines in values.
+ */
+typedef struct 
+{
+    FILE *fp;              /**< Underlying stream */
+    char delim;            /**< ',' or '\t'; 0 until detected from the first record */
+    char *buf;             /**< Cell bytes of the current record, each NUL-terminated */
+    size_t buf_len;        /**< Bytes used in buf */
+    size_t buf_cap;        /**< Capacity of buf */
+    size_t *cells;         /**< Offset of each cell in buf */
+    size_t ncells;         /**< Number of cells in the current record */
+    size_t cells_cap;      /**< Capacity of cells */
+    unsigned long line;    /**< Line number the current record started on */
+} Id3CsvReader;
+
+/**
+ * @brief Opens a delimited file for reading.
+ *
+ * @param reader   Reader to initialize.
+ * @param filename File to open, or "-" for standard input.
+ * @param delim    Delimiter, or 0 to detect ',' or '\t' from the first record.
+ * @return 0 on success, -1 if the file cannot be opened.
+ */
+int id3_csv_open(Id3CsvReader *reader, const char *filename, char delim);
+
+/**
+ * @brief Reads the next record.
+ *
+ * @param reader Open reader.
+ * @return 1 if a record was read, 0 at end of file, -1 on malformed input or allocation failure.
+ */
+int id3_csv_next(Id3CsvReader *reader);
+
+/**
+ * @brief Returns a cell of the current record.
+ *
+ * @param reader Reader positioned on a record.
+ * @param i      Cell index.
+ * @return NUL-terminated cell text, or an empty string if the record has fewer cells.
+ */
+const char *id3_csv_cell(const Id3CsvReader *reader, size_t i);
+
+/**
+ * @brief Closes the reader and frees its buffers.
+ *
+ * @param reader Reader to close.
+ */
+void id3_csv_close(Id3CsvReader *reader);
+
+/**
+ * @brief Writes one cell, quoting it if it contains the delimiter, a quote or a newline.
+ *
+ * @param fp    Output stream.
+ * @param value Cell text (NULL writes an empty cell).
+ * @param delim Delimiter the file uses.
+ */
+void id3_csv_write_cell(FILE *fp, const char *value, char delim);
+
+#endif // ID3_CSV_H
@@ -0,0 +1,46 @@
+#ifndef ID3_DIFF_H
+#define ID3_DIFF_H
+
+#include <stdio.h>
+#include "id3_utils.h"
+
+/**
+ * @brief Prints the fields that differ between two tags, one line per field.
+ *
+ * Lines have the form "<prefix>field: "old" -> "new"", with (unset) for missing values.
+ *
+ * @param out    Output stream.
+ * @param prefix Text printed at the start of each line (may be empty).
+ * @param a      Old tag.
+ * @param b      New tag.
+ * @return Number of differing fields.
+ */
+int id3_diff_print(FILE *out, const char *prefix, const TagData *a, const TagData *b);
+
+/**
+ * @brief Compares the tags of two files field by field.
+ *
+ * @param file_a First MP3 file.
+ * @param file_b Second MP3 file.
+ * @param out    Output stream for the differences.
+ * @return Number of differing fields, or -1 if either file cannot be read.
+ */
+long id3_diff_files(const char *file_a, const char *file_b, FILE *out);
+
+/**
+ * @brief Compares two library indexes in one streaming merge-join pass.
+ *
+ * Both indexes must be sorted by path (as written by id3_index_build()). Only
+ * one row of each is held in memory at a time. Files only in @p old_index are
+ * reported as "- path", files only in @p new_index as "+ path", and changed
+ * fields of files in both as "~ path: field: "old" -> "new"".
+ *
+ * @param old_index Older index.
+ * @param new_index Newer index.
+ * @param out       Output stream for the differences.
+ * @return Number of differences reported, or -1 on error (reporting stops at the first
+ *         row that cannot be read).
+ */
+long id3_diff_indexes(const char *old_index, const char *new_index, FILE *out);
+
+#endif // ID3_DIFF_H
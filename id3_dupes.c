@@ -0,0 +1,532 @@
+/**
+ * @file id3_dupes.c
+ * @brief Near-duplicate (artist, title) detection with blocking and bit-parallel edit distance.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_dupes.h"
+#include "id3_batch.h"
+#include "id3_index.h"
+#include "id3_normalize.h"
+#include "id3_reader.h"
+#include "error_handling.h"
+
+/**
+ * @brief Artist and title of one file, with their comparison keys.
+ */
+typedef struct 
+{
+    char *path;
+    char *artist;
+    char *title;
+    char *artist_key;
+    char *title_key;
+    size_t artist_len;    /**< Length of artist_key */
+    size_t title_len;     /**< Length of title_key */
+} DupeRecord;
+
+/**
+ * @brief Pair of matching records, by position in the record array.
+ */
+typedef struct 
+{
+    size_t a;
+    size_t b;
+} DupePair;
+
+/**
+ * @brief Growable list of pairs owned by one worker.
+ */
+typedef struct 
+{
+    DupePair *pairs;
+    size_t count;
+    size_t cap;
+} DupePairList;
+
+/**
+ * @brief State shared by the workers of one run.
+ */
+typedef struct 
+{
+    const Id3PathList *files;  /**< Files being read */
+    DupeRecord *records;       /**< One record per file, in path order */
+    DupeRecord **order;        /**< Records sorted by the current block key */
+    size_t *blocks;            /**< Start and end in order of each block, two entries per block */
+    size_t nblocks;
+    int by_artist;             /**< Blocks share the artist key (compare titles) or the title key */
+    int max_distance;
+    DupePairList *lists;       /**< Per-worker matches, plus one shared */
+    int workers;               /**< Number of workers; lists[workers] is shared */
+    pthread_mutex_t lock;      /**< Guards the shared list */
+} DupeJob;
+
+char *id3_dupe_key(const char *value, size_t len, int artist)
+{
+    char *key = (char *)malloc(len + 1);
+    if (!key) return NULL;
+    size_t n = id3_normalize_value(value, len, key, ID3_NORM_STRIP | ID3_NORM_NFC | ID3_NORM_LOWER);
+
+    // Punctuation separates words like whitespace does.
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned char c = (unsigned char)key[i];
+        if (c < 0x80 && !(c >= 'a' && c <= 'z') && !(c >= '0' && c <= '9')) key[i] = ' ';
+    }
+    char *tmp = (char *)malloc(n + 1);
+    if (!tmp)
+    {
+        free(key);
+        return NULL;
+    }
+    memcpy(tmp, key, n);
+    n = id3_normalize_value(tmp, n, key, ID3_NORM_TRIM | ID3_NORM_COLLAPSE);
+    free(tmp);
+    key[n] = '\0';
+
+    if (artist)
+    {
+        if (n > 4 && memcmp(key, "the ", 4) == 0)
+        {
+            memmove(key, key + 4, n - 4 + 1);
+            n -= 4;
+        }
+        if (n > 4 && memcmp(key + n - 4, " the", 4) == 0)
+        {
+            n -= 4;
+            key[n] = '\0';
+        }
+    }
+    return key;
+}
+
+/**
+ * @brief Myers' bit-parallel edit distance for a pattern of 1..64 bytes.
+ *
+ * Column i of the dynamic programming matrix is kept as vertical delta bit
+ * vectors (Pv: +1, Mv: -1), so each byte of the text advances all 64 cells
+ * with a handful of word operations.
+ *
+ * @param peq  For every byte value, the positions where it occurs in the pattern.
+ * @param m    Pattern length.
+ * @param text Text bytes.
+ * @param n    Text length.
+ */
+static int myers_distance(const uint64_t peq[256], size_t m, const char *text, size_t n)
+{
+    uint64_t pv = ~(uint64_t)0;
+    uint64_t mv = 0;
+    uint64_t last = (uint64_t)1 << (m - 1);
+    int score = (int)m;
+    for (size_t j = 0; j < n; j++)
+    {
+        uint64_t eq = peq[(unsigned char)text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last) score++;
+        else if (mh & last) score--;
+        // The top row of a global distance grows by one per text byte.
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+/**
+ * @brief Row-by-row edit distance for long strings, stopping once @p max is exceeded.
+ */
+static int dp_distance(const char *a, size_t alen, const char *b, size_t blen, int max)
+{
+    int *row = (int *)malloc((blen + 1) * sizeof(int));
+    if (!row) return max + 1;
+    for (size_t j = 0; j <= blen; j++) row[j] = (int)j;
+    for (size_t i = 1; i <= alen; i++)
+    {
+        int diag = row[0];
+        int best = row[0] = (int)i;
+        for (size_t j = 1; j <= blen; j++)
+        {
+            int up = row[j];
+            int cost = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < cost) cost = up + 1;
+            if (row[j - 1] + 1 < cost) cost = row[j - 1] + 1;
+            row[j] = cost;
+            diag = up;
+            if (cost < best) best = cost;
+        }
+        if (best > max)
+        {
+            free(row);
+            return max + 1;
+        }
+    }
+    int d = row[blen];
+    free(row);
+    return d;
+}
+
+/**
+ * @brief Fills the pattern bit masks used by myers_distance().
+ */
+static void build_peq(uint64_t peq[256], const char *pattern, size_t m)
+{
+    for (size_t i = 0; i < m; i++)
+    {
+        peq[(unsigned char)pattern[i]] |= (uint64_t)1 << i;
+    }
+}
+
+/**
+ * @brief Clears the entries build_peq() set, which is cheaper than clearing all 256.
+ */
+static void clear_peq(uint64_t peq[256], const char *pattern, size_t m)
+{
+    for (size_t i = 0; i < m; i++)
+    {
+        peq[(unsigned char)pattern[i]] = 0;
+    }
+}
+
+int id3_edit_distance(const char *a, size_t alen, const char *b, size_t blen, int max)
+{
+    size_t diff = alen > blen ? alen - blen : blen - alen;
+    if (diff > (size_t)max) return max + 1;
+    if (alen == 0 || blen == 0) return (int)(alen + blen);
+    if (alen > 64) return dp_distance(a, alen, b, blen, max);
+    uint64_t peq[256] = {0};
+    build_peq(peq, a, alen);
+    return myers_distance(peq, alen, b, blen);
+}
+
+/**
+ * @brief Returns non-zero if two keys are close enough to call their files duplicates.
+ */
+static int keys_match(int distance, size_t alen, size_t blen, int max)
+{
+    size_t longer = alen > blen ? alen : blen;
+    return distance <= max && (size_t)distance * 3 <= longer;
+}
+
+static void free_record(DupeRecord *r)
+{
+    free(r->path);
+    free(r->artist);
+    free(r->title);
+    free(r->artist_key);
+    free(r->title_key);
+    memset(r, 0, sizeof(*r));
+}
+
+/**
+ * @brief Fills a record from a tag; records without artist or title stay empty.
+ */
+static int fill_record(DupeRecord *r, const char *path, const TagData *data)
+{
+    const char *artist = tag_get(data, TAG_ARTIST);
+    const char *title = tag_get(data, TAG_TITLE);
+    if (!artist || !title) return 0;
+    r->path = strdup(path);
+    r->artist = strdup(artist);
+    r->title = strdup(title);
+    r->artist_key = id3_dupe_key(artist, tag_length(data, TAG_ARTIST), 1);
+    r->title_key = id3_dupe_key(title, tag_length(data, TAG_TITLE), 0);
+    if (!r->path || !r->artist || !r->title || !r->artist_key || !r->title_key)
+    {
+        free_record(r);
+        return -1;
+    }
+    r->artist_len = strlen(r->artist_key);
+    r->title_len = strlen(r->title_key);
+    return 0;
+}
+
+static int dupe_read_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    DupeJob *job = (DupeJob *)ctx;
+    const char *path = job->files->paths[index];
+    TagData *data = read_id3_tags_pooled(pool, path);
+    if (!data)
+    {
+        fprintf(stderr, "Error: Cannot read tags of %s\n", path);
+        return -1;
+    }
+    int ret = fill_record(&job->records[index], path, data);
+    if (pool) id3_pool_release_tag(pool, data);
+    else free_tag_data(data);
+    return ret;
+}
+
+static int compare_by_artist(const void *a, const void *b)
+{
+    const DupeRecord *ra = *(const DupeRecord *const *)a;
+    const DupeRecord *rb = *(const DupeRecord *const *)b;
+    int c = strcmp(ra->artist_key, rb->artist_key);
+    return c ? c : strcmp(ra->title_key, rb->title_key);
+}
+
+static int compare_by_title(const void *a, const void *b)
+{
+    const DupeRecord *ra = *(const DupeRecord *const *)a;
+    const DupeRecord *rb = *(const DupeRecord *const *)b;
+    int c = strcmp(ra->title_key, rb->title_key);
+    return c ? c : strcmp(ra->artist_key, rb->artist_key);
+}
+
+static int add_pair(DupePairList *list, size_t a, size_t b)
+{
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        DupePair *pairs = (DupePair *)realloc(list->pairs, cap * sizeof(DupePair));
+        if (!pairs) return -1;
+        list->pairs = pairs;
+        list->cap = cap;
+    }
+    list->pairs[list->count].a = a;
+    list->pairs[list->count].b = b;
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Compares every pair of records in one block on the key the block does not share.
+ */
+static int compare_block(Id3Pool *pool, size_t index, void *ctx)
+{
+    DupeJob *job = (DupeJob *)ctx;
+    DupeRecord **rec = job->order + job->blocks[2 * index];
+    size_t n = job->blocks[2 * index + 1] - job->blocks[2 * index];
+    DupePairList found = {0};
+    uint64_t peq[256] = {0};
+    int ret = 0;
+
+    for (size_t i = 0; i + 1 < n && ret == 0; i++)
+    {
+        const char *a = job->by_artist ? rec[i]->title_key : rec[i]->artist_key;
+        size_t alen = job->by_artist ? rec[i]->title_len : rec[i]->artist_len;
+        // The pattern masks of record i are reused against every later record.
+        int bit_parallel = alen > 0 && alen <= 64;
+        if (bit_parallel) build_peq(peq, a, alen);
+        for (size_t j = i + 1; j < n && ret == 0; j++)
+        {
+            const char *b = job->by_artist ? rec[j]->title_key : rec[j]->artist_key;
+            size_t blen = job->by_artist ? rec[j]->title_len : rec[j]->artist_len;
+            // Both keys equal was already reported by the artist blocks.
+            if (!job->by_artist && alen == blen && memcmp(a, b, alen) == 0) continue;
+            size_t diff = alen > blen ? alen - blen : blen - alen;
+            if (diff > (size_t)job->max_distance) continue;
+            int d = bit_parallel && blen > 0 ? myers_distance(peq, alen, b, blen)
+                                             : id3_edit_distance(a, alen, b, blen, job->max_distance);
+            if (keys_match(d, alen, blen, job->max_distance))
+            {
+                ret = add_pair(&found, (size_t)(rec[i] - job->records), (size_t)(rec[j] - job->records));
+            }
+        }
+        if (bit_parallel) clear_peq(peq, a, alen);
+    }
+
+    // Hand the matches of this block to the worker's list.
+    DupePairList *list = pool ? &job->lists[pool->worker] : &job->lists[job->workers];
+    if (!pool) pthread_mutex_lock(&job->lock);
+    for (size_t k = 0; k < found.count && ret == 0; k++)
+    {
+        ret = add_pair(list, found.pairs[k].a, found.pairs[k].b);
+    }
+    if (!pool) pthread_mutex_unlock(&job->lock);
+    free(found.pairs);
+    return ret;
+}
+
+/**
+ * @brief Sorts the records by one key and compares the records of each block in parallel.
+ */
+static long run_pass(DupeJob *job, size_t count, int jobs, int by_artist)
+{
+    qsort(job->order, count, sizeof(DupeRecord *), by_artist ? compare_by_artist : compare_by_title);
+    job->by_artist = by_artist;
+    job->nblocks = 0;
+    for (size_t i = 0; i < count;)
+    {
+        size_t j = i + 1;
+        while (j < count && strcmp(by_artist ? job->order[i]->artist_key : job->order[i]->title_key,
+                                   by_artist ? job->order[j]->artist_key : job->order[j]->title_key) == 0)
+        {
+            j++;
+        }
+        // Records with a key of their own have nothing to be compared with.
+        if (j - i > 1)
+        {
+            job->blocks[2 * job->nblocks] = i;
+            job->blocks[2 * job->nblocks + 1] = j;
+            job->nblocks++;
+        }
+        i = j;
+    }
+    return job->nblocks ? id3_batch_run(job->nblocks, jobs, compare_block, job) : 0;
+}
+
+static size_t find_root(size_t *parent, size_t x)
+{
+    while (parent[x] != x)
+    {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+/**
+ * @brief Joins the matching pairs into groups and prints every group in path order.
+ */
+static long print_groups(FILE *out, const DupeRecord *records, size_t count, const DupeJob *job)
+{
+    size_t *parent = (size_t *)malloc(count * sizeof(size_t));
+    size_t *size = (size_t *)calloc(count, sizeof(size_t));
+    size_t *group = (size_t *)malloc(count * sizeof(size_t));
+    size_t *member = (size_t *)malloc(count * sizeof(size_t));
+    if (!parent || !size || !group || !member)
+    {
+        free(parent);
+        free(size);
+        free(group);
+        free(member);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) parent[i] = i;
+    for (int w = 0; w <= job->workers; w++)
+    {
+        for (size_t k = 0; k < job->lists[w].count; k++)
+        {
+            size_t ra = find_root(parent, job->lists[w].pairs[k].a);
+            size_t rb = find_root(parent, job->lists[w].pairs[k].b);
+            // The smaller index becomes the root, so a group's root is its first path.
+            if (ra < rb) parent[rb] = ra;
+            else if (rb < ra) parent[ra] = rb;
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        parent[i] = find_root(parent, i);
+        size[parent[i]]++;
+    }
+
+    // Give every group a range of the member array, in root order, then fill the ranges in
+    // path order: one counting-sort pass instead of a scan of all records per group.
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (parent[i] != i || size[i] < 2) continue;
+        group[i] = used;
+        used += size[i];
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t root = parent[i];
+        if (size[root] > 1) member[group[root]++] = i;
+    }
+
+    // Each group's offset now ends its range.
+    long groups = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (parent[i] != i || size[i] < 2) continue;
+        fprintf(out, "Group %ld (%zu files):\n", ++groups, size[i]);
+        for (size_t k = group[i] - size[i]; k < group[i]; k++)
+        {
+            const DupeRecord *r = &records[member[k]];
+            fprintf(out, "  %s: %s - %s\n", r->path, r->artist, r->title);
+        }
+    }
+    free(parent);
+    free(size);
+    free(group);
+    free(member);
+    return groups;
+}
+
+long id3_find_duplicates(const Id3PathList *files, const char *index, int jobs, int max_distance,
+                         FILE *out)
+{
+    DupeJob job;
+    memset(&job, 0, sizeof(job));
+    job.files = files;
+    job.max_distance = max_distance;
+    size_t count = 0;
+    long failures = 0;
+
+    if (files)
+    {
+        count = files->count;
+        job.records = (DupeRecord *)calloc(count ? count : 1, sizeof(DupeRecord));
+        if (!job.records) return -1;
+        failures = id3_batch_run(count, jobs, dupe_read_one, &job);
+    }
+    else
+    {
+        Id3IndexReader reader;
+        if (id3_index_open(&reader, index) != 0) return -1;
+        size_t cap = 0;
+        int status;
+        while ((status = id3_index_next(&reader)) == 1)
+        {
+            if (count == cap)
+            {
+                cap = cap ? cap * 2 : 1024;
+                DupeRecord *records = (DupeRecord *)realloc(job.records, cap * sizeof(DupeRecord));
+                if (!records)
+                {
+                    status = -1;
+                    break;
+                }
+                job.records = records;
+            }
+            memset(&job.records[count], 0, sizeof(DupeRecord));
+            if (fill_record(&job.records[count], reader.path, reader.record) != 0)
+            {
+                status = -1;
+                break;
+            }
+            count++;
+        }
+        id3_index_close(&reader);
+        if (status != 0) failures = -1;
+    }
+
+    // Only records with both an artist and a title take part.
+    size_t usable = 0;
+    job.order = (DupeRecord **)malloc((count ? count : 1) * sizeof(DupeRecord *));
+    job.blocks = (size_t *)malloc((count + 1) * sizeof(size_t));
+    job.workers = id3_batch_workers(count, jobs);
+    job.lists = (DupePairList *)calloc((size_t)job.workers + 1, sizeof(DupePairList));
+    if (!job.order || !job.blocks || !job.lists) failures = -1;
+    for (size_t i = 0; failures >= 0 && i < count; i++)
+    {
+        if (job.records[i].path) job.order[usable++] = &job.records[i];
+    }
+    pthread_mutex_init(&job.lock, NULL);
+
+    long groups = -1;
+    if (failures >= 0 && run_pass(&job, usable, jobs, 1) == 0 && run_pass(&job, usable, jobs, 0) == 0)
+    {
+        groups = print_groups(out, job.records, count, &job);
+    }
+    if (failures > 0) fprintf(stderr, "Error: %ld files could not be read\n", failures);
+
+    pthread_mutex_destroy(&job.lock);
+    for (int w = 0; job.lists && w <= job.workers; w++) free(job.lists[w].pairs);
+    for (size_t i = 0; job.records && i < count; i++) free_record(&job.records[i]);
+    free(job.lists);
+    free(job.blocks);
+    free(job.order);
+    free(job.records);
+    return groups;
+}
@@ -0,0 +1,59 @@
+#ifndef ID3_DUPES_H
+#define ID3_DUPES_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "id3_scan.h"
+
+#define ID3_DUPES_DEFAULT_DISTANCE 2 /**< Default most edits between near-duplicate keys */
+
+/**
+ * @brief Builds the comparison key of an artist or title.
+ *
+ * The value is normalized (control bytes stripped, accents composed), lowercased,
+ * punctuation becomes a space and whitespace runs are collapsed. For artists, a
+ * leading "the " or trailing " the" is dropped, so "The Beatles" and "Beatles, The"
+ * share the key "beatles".
+ *
+ * @param value  Value to convert.
+ * @param len    Length of @p value.
+ * @param artist Non-zero to apply the artist rules.
+ * @return Newly allocated key, or NULL on allocation failure.
+ */
+char *id3_dupe_key(const char *value, size_t len, int artist);
+
+/**
+ * @brief Computes the edit distance between two byte strings, up to a limit.
+ *
+ * Strings of up to 64 bytes use the bit-parallel algorithm of Myers, one 64-bit
+ * word per column; longer strings use a banded dynamic program.
+ *
+ * @param a    First string.
+ * @param alen Length of @p a.
+ * @param b    Second string.
+ * @param blen Length of @p b.
+ * @param max  Largest distance of interest.
+ * @return The Levenshtein distance, or a value above @p max if it exceeds @p max.
+ */
+int id3_edit_distance(const char *a, size_t alen, const char *b, size_t blen, int max);
+
+/**
+ * @brief Reports groups of files whose (artist, title) pairs are near-duplicates.
+ *
+ * Files are blocked by artist key and compared by title, then blocked by title
+ * key and compared by artist, so only files sharing one exact key are compared.
+ * Two files match when the other key differs by at most @p max_distance edits
+ * and by no more than one edit per three characters. Matches are joined into
+ * groups, which are printed in path order.
+ *
+ * @param files        Files to read (sorted by path, as from id3_scan_paths()), or NULL.
+ * @param index        Index to read instead of files, or NULL.
+ * @param jobs         Number of worker threads (0 selects the default).
+ * @param max_distance Most edits between matching keys.
+ * @param out          Stream the groups are printed to.
+ * @return Number of groups found, or -1 on failure.
+ */
+long id3_find_duplicates(const Id3PathList *files, const char *index, int jobs, int max_distance,
+                         FILE *out);
+
+#endif // ID3_DUPES_H
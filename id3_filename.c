@@ -0,0 +1,213 @@
+/**
+ * @file id3_filename.c
+ * @brief Bulk tag-from-filename and rename-from-tag operations.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "id3_filename.h"
+#include "id3_batch.h"
+#include "id3_checkpoint.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+#include "error_handling.h"
+
+#define RENAME_MAX_PATH 4096
+
+/**
+ * @brief Shared state of a tag-from-filename run.
+ */
+typedef struct 
+{
+    const Id3Pattern *pattern;
+    const Id3PathList *files;
+} FromFilenameJob;
+
+/**
+ * @brief Shared state of a rename run over one base directory.
+ */
+typedef struct 
+{
+    const Id3Pattern *pattern;
+    const Id3PathList *files;  /**< Paths as scanned, each starting with base */
+    size_t base_len;           /**< Length of the base prefix, including its '/' */
+    int base_fd;               /**< Descriptor of the base directory */
+} RenameJob;
+
+static int tag_from_filename(Id3Pool *pool, size_t index, void *ctx)
+{
+    const FromFilenameJob *job = (const FromFilenameJob *)ctx;
+    const char *path = job->files->paths[index];
+    TagData *values = pool ? id3_pool_acquire_tag(pool) : create_tag_data();
+    if (!values) return -1;
+
+    unsigned int mask;
+    int ret = id3_pattern_match(job->pattern, path, values, &mask);
+    if (ret != 0)
+    {
+        fprintf(stderr, "Error: %s does not match the pattern\n", path);
+    }
+    else if (edit_tags_pooled(pool, path, values, mask) != 0)
+    {
+        fprintf(stderr, "Error: Failed to tag %s\n", path);
+        ret = -1;
+    }
+    if (pool) id3_pool_release_tag(pool, values);
+    else free_tag_data(values);
+    return ret;
+}
+
+long id3_tags_from_filenames(const Id3Pattern *pattern, const Id3PathList *files, int jobs)
+{
+    FromFilenameJob job = { pattern, files };
+    return id3_batch_run(files->count, jobs, tag_from_filename, &job);
+}
+
+/**
+ * @brief Creates every missing directory leading up to @p rel, relative to @p dir_fd.
+ */
+static int make_parent_dirs(int dir_fd, char *rel)
+{
+    for (char *slash = strchr(rel, '/'); slash; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        int ret = mkdirat(dir_fd, rel, 0755);
+        *slash = '/';
+        if (ret != 0 && errno != EEXIST) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Renames without replacing an existing file.
+ */
+static int rename_no_replace(int dir_fd, const char *from, const char *to)
+{
+    if (renameat2(dir_fd, from, dir_fd, to, RENAME_NOREPLACE) == 0) return 0;
+    if (errno != EINVAL && errno != ENOSYS) return -1;
+    // Filesystems without RENAME_NOREPLACE: check first, accepting the small race.
+    struct stat st;
+    if (fstatat(dir_fd, to, &st, AT_SYMLINK_NOFOLLOW) == 0)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+    return renameat(dir_fd, from, dir_fd, to);
+}
+
+static int rename_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    const RenameJob *job = (const RenameJob *)ctx;
+    const char *path = job->files->paths[index];
+    TagData *data = read_id3_tags_pooled(pool, path);
+    if (!data)
+    {
+        fprintf(stderr, "Error: Cannot read tags of %s\n", path);
+        return -1;
+    }
+
+    char target[RENAME_MAX_PATH];
+    int ret = id3_pattern_format(job->pattern, data, target, sizeof(target));
+    if (pool) id3_pool_release_tag(pool, data);
+    else free_tag_data(data);
+    if (ret != 0)
+    {
+        fprintf(stderr, "Error: Tags of %s do not fill the pattern\n", path);
+        return -1;
+    }
+
+    const char *from = path + job->base_len;
+    if (strcmp(from, target) != 0)
+    {
+        if (make_parent_dirs(job->base_fd, target) != 0 ||
+            rename_no_replace(job->base_fd, from, target) != 0)
+        {
+            fprintf(stderr, "Error: Cannot rename %s to %s: %s\n", path, target, strerror(errno));
+            return -1;
+        }
+    }
+    // Log both names: a rerun given the old name skips it, and a rescan finds the new one done.
+    char renamed[RENAME_MAX_PATH];
+    int n = snprintf(renamed, sizeof(renamed), "%.*s%s", (int)job->base_len, path, target);
+    id3_checkpoint_record(path);
+    if (n > 0 && (size_t)n < sizeof(renamed) && strcmp(renamed, path) != 0) id3_checkpoint_record(renamed);
+    return 0;
+}
+
+/**
+ * @brief Renames a list of files that all live below @p base.
+ */
+static long rename_in_base(const Id3Pattern *pattern, const char *base, const Id3PathList *files, int jobs)
+{
+    int fd = open(base, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open directory %s\n", base);
+        return (long)files->count;
+    }
+    RenameJob job = { pattern, files, strlen(base) + 1, fd };
+    long failures = id3_batch_run(files->count, jobs, rename_one, &job);
+    close(fd);
+    return failures;
+}
+
+long id3_rename_from_tags(const Id3Pattern *pattern, char *const inputs[], int count, int jobs)
+{
+    long failures = 0;
+    for (int i = 0; i < count; i++)
+    {
+        Id3PathList files = {0};
+        char base[RENAME_MAX_PATH];
+        struct stat st;
+        int is_dir = stat(inputs[i], &st) == 0 && S_ISDIR(st.st_mode);
+        if (is_dir)
+        {
+            snprintf(base, sizeof(base), "%s", inputs[i]);
+            size_t len = strlen(base);
+            while (len > 1 && base[len - 1] == '/') base[--len] = '\0';
+        }
+        else
+        {
+            // A single file is renamed relative to its own directory; scanned paths
+            // are built as "<base>/<name>", so give it that shape.
+            const char *slash = strrchr(inputs[i], '/');
+            if (slash) snprintf(base, sizeof(base), "%.*s", (int)(slash - inputs[i]), inputs[i]);
+            else snprintf(base, sizeof(base), ".");
+        }
+        char *one = NULL;
+        if (!is_dir)
+        {
+            const char *name = strrchr(inputs[i], '/');
+            size_t len = strlen(base) + strlen(name ? name + 1 : inputs[i]) + 2;
+            one = (char *)malloc(len);
+            if (!one) return -1;
+            snprintf(one, len, "%s/%s", base, name ? name + 1 : inputs[i]);
+            // Like scanned files, a file named directly is only renamed by its shard, and only
+            // once per checkpoint log (which records it in the form built above).
+            if (!id3_path_selected(inputs[i]) || id3_checkpoint_contains(one))
+            {
+                free(one);
+                continue;
+            }
+        }
+        int ret = is_dir ? id3_scan_paths(&inputs[i], 1, &files) : id3_path_list_add(&files, one);
+        free(one);
+        if (ret != 0)
+        {
+            id3_path_list_free(&files);
+            return -1;
+        }
+        long f = rename_in_base(pattern, base, &files, jobs);
+        id3_path_list_free(&files);
+        if (f < 0) return -1;
+        failures += f;
+    }
+    return failures;
+}
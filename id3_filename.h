@@ -0,0 +1,39 @@
+#ifndef ID3_FILENAME_H
+#define ID3_FILENAME_H
+
+#include "id3_pattern.h"
+#include "id3_scan.h"
+
+/**
+ * @brief Sets tags of many files from their paths.
+ *
+ * Each path is matched against @p pattern; the extracted fields are applied to
+ * the file in a single write, which is skipped if nothing changes.
+ *
+ * @param pattern Compiled pattern, e.g. "%artist%/%album%/%track% - %title%.mp3".
+ * @param files   Files to tag.
+ * @param jobs    Number of worker threads (0 selects the default).
+ * @return Number of files that did not match or could not be written, or -1 on setup failure.
+ */
+long id3_tags_from_filenames(const Id3Pattern *pattern, const Id3PathList *files, int jobs);
+
+/**
+ * @brief Renames files to paths built from their tags.
+ *
+ * Each input directory is scanned and its files are renamed to the expanded
+ * pattern relative to that directory; a file given directly is renamed relative
+ * to the directory containing it. Renames are done with renameat() on a descriptor
+ * of that base directory, intermediate directories are created as needed, and
+ * existing files are never overwritten. Files given directly are filtered by
+ * id3_path_selected() like scanned ones, and each renamed file is recorded in
+ * the checkpoint log under its old and its new path.
+ *
+ * @param pattern Compiled pattern.
+ * @param inputs  Files and directories.
+ * @param count   Number of entries in @p inputs.
+ * @param jobs    Number of worker threads (0 selects the default).
+ * @return Number of files that could not be renamed, or -1 on setup failure.
+ */
+long id3_rename_from_tags(const Id3Pattern *pattern, char *const inputs[], int count, int jobs);
+
+#endif // ID3_FILENAME_H
@@ -0,0 +1,295 @@
+/**
+ * @file id3_index.c
+ * @brief Building and reading sorted, tab-separated library indexes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_index.h"
+#include "id3_batch.h"
+#include "id3_mpeg.h"
+#include "id3_reader.h"
+#include "error_handling.h"
+
+#define INDEX_CHUNK        1024 /**< Files read in parallel before a chunk is written */
+#define INDEX_COL_IGNORE   -1   /**< Column the reader does not know */
+#define INDEX_COL_PATH     -2   /**< The "path" column */
+#define INDEX_COL_VERSION  -3   /**< The "version" column */
+#define INDEX_COL_ART      -4   /**< The "art_bytes" column */
+#define INDEX_COL_DURATION -5   /**< The "duration" column */
+
+/**
+ * @brief State of one chunk of an index build.
+ */
+typedef struct 
+{
+    const Id3PathList *files; /**< All files being indexed */
+    size_t first;             /**< Index of the chunk's first file */
+    TagData **slots;          /**< One TagData per file of the chunk */
+    int *ok;                  /**< Whether each file of the chunk was read */
+} IndexChunk;
+
+static int index_read_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    IndexChunk *chunk = (IndexChunk *)ctx;
+    const char *path = chunk->files->paths[chunk->first + index];
+    TagData *data = read_id3_tags_pooled(pool, path);
+    chunk->ok[index] = 0;
+    if (!data)
+    {
+        fprintf(stderr, "Error: Cannot index %s\n", path);
+        return -1;
+    }
+    // Pooled TagData belongs to this worker, so keep a copy in the chunk's slot.
+    chunk->ok[index] = copy_tag_data(chunk->slots[index], data) == 0;
+    chunk->slots[index]->duration = id3_file_duration(path);
+    if (pool) id3_pool_release_tag(pool, data);
+    else free_tag_data(data);
+    return chunk->ok[index] ? 0 : -1;
+}
+
+/**
+ * @brief Writes the header row naming every column of the index.
+ */
+static void write_header(FILE *out)
+{
+    fputs("path\tversion\tart_bytes\tduration", out);
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        fprintf(out, "\t%s", tag_field_name((TagField)i));
+    }
+    putc('\n', out);
+}
+
+/**
+ * @brief Writes one row: the path, version, picture bytes, duration and every field (empty when unset).
+ */
+static void write_row(FILE *out, const char *path, const TagData *data)
+{
+    id3_csv_write_cell(out, path, '\t');
+    putc('\t', out);
+    id3_csv_write_cell(out, data->version, '\t');
+    fprintf(out, "\t%zu\t", data->art_bytes);
+    if (data->duration >= 0) fprintf(out, "%d", data->duration);
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        putc('\t', out);
+        id3_csv_write_cell(out, tag_get(data, (TagField)i), '\t');
+    }
+    putc('\n', out);
+}
+
+long id3_index_build(const char *out_path, const Id3PathList *files, int jobs)
+{
+    FILE *out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!out)
+    {
+        display_error("Cannot create index file.");
+        return -1;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+    IndexChunk chunk;
+    chunk.files = files;
+    chunk.slots = (TagData **)calloc(INDEX_CHUNK, sizeof(TagData *));
+    chunk.ok = (int *)calloc(INDEX_CHUNK, sizeof(int));
+    int ret = chunk.slots && chunk.ok ? 0 : -1;
+    for (size_t i = 0; ret == 0 && i < INDEX_CHUNK; i++)
+    {
+        chunk.slots[i] = create_tag_data();
+        if (!chunk.slots[i]) ret = -1;
+    }
+
+    long failures = 0;
+    if (ret == 0) write_header(out);
+    for (size_t first = 0; ret == 0 && first < files->count; first += INDEX_CHUNK)
+    {
+        size_t n = files->count - first < INDEX_CHUNK ? files->count - first : INDEX_CHUNK;
+        chunk.first = first;
+        long f = id3_batch_run(n, jobs, index_read_one, &chunk);
+        if (f < 0)
+        {
+            ret = -1;
+            break;
+        }
+        failures += f;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (chunk.ok[i]) write_row(out, files->paths[first + i], chunk.slots[i]);
+        }
+    }
+
+    for (size_t i = 0; chunk.slots && i < INDEX_CHUNK; i++)
+    {
+        free_tag_data(chunk.slots[i]);
+    }
+    free(chunk.slots);
+    free(chunk.ok);
+    if (ferror(out)) ret = -1;
+    if (out == stdout) fflush(out);
+    else if (fclose(out) != 0) ret = -1;
+    if (ret != 0)
+    {
+        display_error("Failed to write index.");
+        return -1;
+    }
+    return failures;
+}
+
+int id3_index_open(Id3IndexReader *reader, const char *filename)
+{
+    memset(reader, 0, sizeof(*reader));
+    if (id3_csv_open(&reader->csv, filename, '\t') != 0)
+    {
+        fprintf(stderr, "Error: Cannot open index %s\n", filename);
+        return -1;
+    }
+    int has_path = 0;
+    if (id3_csv_next(&reader->csv) != 1 || reader->csv.ncells > ID3_INDEX_MAX_COLUMNS)
+    {
+        fprintf(stderr, "Error: Index %s has no usable header row\n", filename);
+        id3_csv_close(&reader->csv);
+        return -1;
+    }
+    reader->ncolumns = reader->csv.ncells;
+    for (size_t i = 0; i < reader->ncolumns; i++)
+    {
+        const char *name = id3_csv_cell(&reader->csv, i);
+        int field = tag_field_from_name(name);
+        if (strcmp(name, "path") == 0)
+        {
+            reader->columns[i] = INDEX_COL_PATH;
+            has_path = 1;
+        }
+        else if (strcmp(name, "version") == 0) reader->columns[i] = INDEX_COL_VERSION;
+        else if (strcmp(name, "art_bytes") == 0) reader->columns[i] = INDEX_COL_ART;
+        else if (strcmp(name, "duration") == 0) reader->columns[i] = INDEX_COL_DURATION;
+        else reader->columns[i] = field >= 0 ? field : INDEX_COL_IGNORE;
+    }
+    reader->record = create_tag_data();
+    if (!has_path || !reader->record)
+    {
+        fprintf(stderr, "Error: Index %s has no path column\n", filename);
+        id3_index_close(reader);
+        return -1;
+    }
+    return 0;
+}
+
+int id3_index_next(Id3IndexReader *reader)
+{
+    int status = id3_csv_next(&reader->csv);
+    if (status != 1) return status;
+
+    clear_tag_data(reader->record);
+    reader->path = "";
+    for (size_t i = 0; i < reader->ncolumns; i++)
+    {
+        const char *cell = id3_csv_cell(&reader->csv, i);
+        int role = reader->columns[i];
+        if (role == INDEX_COL_PATH) reader->path = cell;
+        else if (role == INDEX_COL_VERSION) tag_set_version(reader->record, cell);
+        else if (role == INDEX_COL_ART) reader->record->art_bytes = (size_t)strtoull(cell, NULL, 10);
+        else if (role == INDEX_COL_DURATION && *cell) reader->record->duration = atoi(cell);
+        else if (role >= 0 && *cell && tag_set(reader->record, (TagField)role, cell) != 0) return -1;
+    }
+
+    // Merge-joins depend on byte-order sorting, so refuse out-of-order input.
+    size_t len = strlen(reader->path);
+    if (reader->prev_path && strcmp(reader->prev_path, reader->path) >= 0)
+    {
+        fprintf(stderr, "Error: Index is not sorted by path at line %lu\n", reader->csv.line);
+        return -1;
+    }
+    if (len + 1 > reader->prev_cap)
+    {
+        char *p = (char *)realloc(reader->prev_path, len + 1);
+        if (!p) return -1;
+        reader->prev_path = p;
+        reader->prev_cap = len + 1;
+    }
+    memcpy(reader->prev_path, reader->path, len + 1);
+    return 1;
+}
+
+void id3_index_close(Id3IndexReader *reader)
+{
+    id3_csv_close(&reader->csv);
+    free_tag_data(reader->record);
+    free(reader->prev_path);
+    memset(reader, 0, sizeof(*reader));
+}
+
+long id3_index_merge(const char *out_path, char *const inputs[], int count)
+{
+    Id3IndexReader *readers = (Id3IndexReader *)calloc((size_t)count, sizeof(Id3IndexReader));
+    int *status = (int *)calloc((size_t)count, sizeof(int));
+    if (!readers || !status)
+    {
+        free(readers);
+        free(status);
+        display_error("Memory allocation failed.");
+        return -1;
+    }
+    int opened = 0;
+    int ret = 0;
+    for (; opened < count; opened++)
+    {
+        if (id3_index_open(&readers[opened], inputs[opened]) != 0)
+        {
+            ret = -1;
+            break;
+        }
+        status[opened] = id3_index_next(&readers[opened]);
+        if (status[opened] < 0) ret = -1;
+    }
+
+    FILE *out = NULL;
+    if (ret == 0)
+    {
+        out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+        if (!out) ret = -1;
+        else setvbuf(out, NULL, _IOFBF, 1 << 20);
+    }
+    if (out) write_header(out);
+
+    // k-way merge: repeatedly emit the smallest current path of all fragments.
+    long rows = 0;
+    while (ret == 0)
+    {
+        int min = -1;
+        for (int i = 0; i < count; i++)
+        {
+            if (status[i] == 1 && (min < 0 || strcmp(readers[i].path, readers[min].path) < 0)) min = i;
+        }
+        if (min < 0) break;
+        write_row(out, readers[min].path, readers[min].record);
+        rows++;
+        // Shards are disjoint, but a path present in several fragments is written once.
+        for (int i = 0; i < count && ret == 0; i++)
+        {
+            if (i == min || status[i] != 1 || strcmp(readers[i].path, readers[min].path) != 0) continue;
+            status[i] = id3_index_next(&readers[i]);
+            if (status[i] < 0) ret = -1;
+        }
+        status[min] = id3_index_next(&readers[min]);
+        if (status[min] < 0) ret = -1;
+    }
+
+    for (int i = 0; i < opened; i++)
+    {
+        id3_index_close(&readers[i]);
+    }
+    free(readers);
+    free(status);
+    if (out && ferror(out)) ret = -1;
+    if (out == stdout) fflush(out);
+    else if (out && fclose(out) != 0) ret = -1;
+    if (ret != 0)
+    {
+        display_error("Failed to merge indexes.");
+        return -1;
+    }
+    return rows;
+}
@@ -0,0 +1,80 @@
+#ifndef ID3_INDEX_H
+#define ID3_INDEX_H
+
+#include <stddef.h>
+#include "id3_csv.h"
+#include "id3_scan.h"
+#include "id3_utils.h"
+
+#define ID3_INDEX_MAX_COLUMNS 64 /**< Most columns an index header may have */
+
+/**
+ * @brief Streaming reader for a library index.
+ *
+ * An index is a tab-separated file whose header row names its columns: "path",
+ * "version", "art_bytes", "duration" (seconds) and one column per tag field. Rows are sorted by path in byte order,
+ * which lets two indexes be merge-joined in a single pass. Columns the reader
+ * does not know are ignored, so newer indexes remain readable.
+ */
+typedef struct 
+{
+    Id3CsvReader csv;                     /**< Underlying TSV reader */
+    int columns[ID3_INDEX_MAX_COLUMNS];   /**< Column roles: TagField, or INDEX_COL_* */
+    size_t ncolumns;                      /**< Number of header columns */
+    TagData *record;                      /**< Values of the current row */
+    const char *path;                     /**< Path of the current row (owned by csv) */
+    char *prev_path;                      /**< Path of the previous row, for the order check */
+    size_t prev_cap;                      /**< Capacity of prev_path */
+} Id3IndexReader;
+
+/**
+ * @brief Reads the tags of every file and writes a sorted index.
+ *
+ * Files are read in parallel in fixed-size chunks and each chunk is written in
+ * order, so memory use does not grow with the size of the library.
+ *
+ * @param out_path Index file to create ("-" for standard output).
+ * @param files    Files to index, sorted by path (as produced by id3_scan_paths()).
+ * @param jobs     Number of worker threads (0 selects the default).
+ * @return Number of files that could not be read, or -1 if the index could not be written.
+ */
+long id3_index_build(const char *out_path, const Id3PathList *files, int jobs);
+
+/**
+ * @brief Merges sorted index fragments, e.g. one per shard, into one sorted index.
+ *
+ * The fragments are streamed side by side, so memory use does not depend on
+ * their size. A path present in more than one fragment is taken from the first.
+ *
+ * @param out_path Index file to create ("-" for standard output).
+ * @param inputs   Fragments to merge.
+ * @param count    Number of fragments.
+ * @return Number of rows written, or -1 on failure.
+ */
+long id3_index_merge(const char *out_path, char *const inputs[], int count);
+
+/**
+ * @brief Opens an index and reads its header.
+ *
+ * @param reader   Reader to initialize.
+ * @param filename Index file ("-" for standard input).
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_index_open(Id3IndexReader *reader, const char *filename);
+
+/**
+ * @brief Reads the next row into reader->path and reader->record.
+ *
+ * @param reader Open reader.
+ * @return 1 if a row was read, 0 at end of file, -1 if the index is malformed or out of order.
+ */
+int id3_index_next(Id3IndexReader *reader);
+
+/**
+ * @brief Closes an index reader.
+ *
+ * @param reader Reader to close.
+ */
+void id3_index_close(Id3IndexReader *reader);
+
+#endif // ID3_INDEX_H
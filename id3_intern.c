@@ -0,0 +1,213 @@
+/**
+ * @file id3_intern.c
+ * @brief Shared string interning table with lock-free lookups.
+ *
+ * Strings are kept in an open-addressing hash table with a fixed number of
+ * slots. Each slot holds 0 (empty) or ID + 1, and each ID maps to an immutable
+ * record in a fixed-size entry array. Writers fill in the record, publish it in
+ * the entry array, bump the count and only then publish the slot, all with release stores, so a
+ * reader that observes a slot with an acquire load always sees a complete record
+ * and a count that already includes its ID.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_intern.h"
+
+#define INTERN_DEFAULT_CAPACITY (1u << 20)
+#define INTERN_BLOCK_SIZE       (64 * 1024) /**< Size of each string storage block */
+
+/**
+ * @brief Immutable record for one interned string.
+ */
+typedef struct 
+{
+    unsigned int hash;   /**< Hash of the string bytes */
+    unsigned int len;    /**< Length of the string */
+    char text[];         /**< NUL-terminated string bytes */
+} InternEntry;
+
+/**
+ * @brief Block of string storage; blocks are chained so they can be freed.
+ */
+typedef struct InternBlock 
+{
+    struct InternBlock *next;
+    size_t used;
+    size_t cap;
+    char data[];
+} InternBlock;
+
+struct Id3InternTable 
+{
+    _Atomic unsigned int *slots;          /**< Hash slots holding ID + 1, or 0 */
+    unsigned int slot_mask;               /**< Number of slots minus one */
+    InternEntry *_Atomic *entries;        /**< Records indexed by ID */
+    unsigned int capacity;                /**< Maximum number of IDs */
+    _Atomic unsigned int count;           /**< Number of IDs issued */
+    pthread_mutex_t lock;                 /**< Serializes inserts */
+    InternBlock *blocks;                  /**< String storage, written under lock */
+};
+
+/**
+ * @brief FNV-1a hash of a byte string.
+ */
+static unsigned int hash_bytes(const char *value, size_t len)
+{
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)value[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Probes for a string; returns its ID, or NONE with the first empty slot in @p empty.
+ */
+static unsigned int probe(const Id3InternTable *table, const char *value, size_t len,
+                          unsigned int hash, unsigned int *empty)
+{
+    unsigned int i = hash & table->slot_mask;
+    for (;;)
+    {
+        unsigned int slot = atomic_load_explicit(&table->slots[i], memory_order_acquire);
+        if (slot == 0)
+        {
+            if (empty) *empty = i;
+            return ID3_INTERN_NONE;
+        }
+        const InternEntry *e = atomic_load_explicit(&table->entries[slot - 1], memory_order_acquire);
+        if (e->hash == hash && e->len == len && memcmp(e->text, value, len) == 0)
+        {
+            return slot - 1;
+        }
+        i = (i + 1) & table->slot_mask;
+    }
+}
+
+/**
+ * @brief Copies a string into block storage. Must be called with the lock held.
+ */
+static InternEntry *store_entry(Id3InternTable *table, const char *value, size_t len, unsigned int hash)
+{
+    size_t need = sizeof(InternEntry) + len + 1;
+    need = (need + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    InternBlock *b = table->blocks;
+    if (!b || b->cap - b->used < need)
+    {
+        size_t cap = need > INTERN_BLOCK_SIZE ? need : INTERN_BLOCK_SIZE;
+        b = (InternBlock *)malloc(sizeof(InternBlock) + cap);
+        if (!b) return NULL;
+        b->next = table->blocks;
+        b->used = 0;
+        b->cap = cap;
+        table->blocks = b;
+    }
+    InternEntry *e = (InternEntry *)(b->data + b->used);
+    b->used += need;
+    e->hash = hash;
+    e->len = (unsigned int)len;
+    memcpy(e->text, value, len);
+    e->text[len] = '\0';
+    return e;
+}
+
+Id3InternTable *id3_intern_create(unsigned int capacity)
+{
+    if (capacity == 0) capacity = INTERN_DEFAULT_CAPACITY;
+    if (capacity > (1u << 30)) return NULL;
+
+    // Keep the load factor at or below one half so probe chains stay short.
+    unsigned int slots = 2;
+    while (slots < 2 * capacity) slots *= 2;
+
+    Id3InternTable *table = (Id3InternTable *)calloc(1, sizeof(Id3InternTable));
+    if (!table) return NULL;
+    table->slots = (_Atomic unsigned int *)calloc(slots, sizeof(*table->slots));
+    table->entries = (InternEntry *_Atomic *)calloc(capacity, sizeof(*table->entries));
+    if (!table->slots || !table->entries)
+    {
+        free((void *)table->slots);
+        free((void *)table->entries);
+        free(table);
+        return NULL;
+    }
+    table->slot_mask = slots - 1;
+    table->capacity = capacity;
+    pthread_mutex_init(&table->lock, NULL);
+    return table;
+}
+
+void id3_intern_destroy(Id3InternTable *table)
+{
+    if (!table) return;
+    while (table->blocks)
+    {
+        InternBlock *next = table->blocks->next;
+        free(table->blocks);
+        table->blocks = next;
+    }
+    pthread_mutex_destroy(&table->lock);
+    free((void *)table->slots);
+    free((void *)table->entries);
+    free(table);
+}
+
+unsigned int id3_intern_find(const Id3InternTable *table, const char *value, size_t len)
+{
+    return probe(table, value, len, hash_bytes(value, len), NULL);
+}
+
+unsigned int id3_intern(Id3InternTable *table, const char *value, size_t len)
+{
+    if (len > ID3_MAX_TAG_SIZE) return ID3_INTERN_NONE;
+    unsigned int hash = hash_bytes(value, len);
+
+    // Fast path: most values in a library scan have been seen before.
+    unsigned int id = probe(table, value, len, hash, NULL);
+    if (id != ID3_INTERN_NONE) return id;
+
+    pthread_mutex_lock(&table->lock);
+    unsigned int empty;
+    id = probe(table, value, len, hash, &empty);
+    if (id == ID3_INTERN_NONE)
+    {
+        unsigned int count = atomic_load_explicit(&table->count, memory_order_relaxed);
+        InternEntry *e = count < table->capacity ? store_entry(table, value, len, hash) : NULL;
+        if (e)
+        {
+            id = count;
+            atomic_store_explicit(&table->entries[id], e, memory_order_release);
+            atomic_store_explicit(&table->count, count + 1, memory_order_release);
+            atomic_store_explicit(&table->slots[empty], id + 1, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&table->lock);
+    return id;
+}
+
+const char *id3_intern_string(const Id3InternTable *table, unsigned int id)
+{
+    if (id >= atomic_load_explicit(&table->count, memory_order_acquire)) return NULL;
+    return atomic_load_explicit(&table->entries[id], memory_order_acquire)->text;
+}
+
+unsigned int id3_intern_count(const Id3InternTable *table)
+{
+    return atomic_load_explicit(&table->count, memory_order_acquire);
+}
+
+void id3_intern_tag(Id3InternTable *table, const TagData *data, unsigned int ids[TAG_FIELD_COUNT])
+{
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        ids[i] = ID3_INTERN_NONE;
+        if (i != TAG_ARTIST && i != TAG_ALBUM && i != TAG_GENRE) continue;
+        const char *value = tag_get(data, (TagField)i);
+        if (value) ids[i] = id3_intern(table, value, tag_length(data, (TagField)i));
+    }
+}
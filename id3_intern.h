@@ -0,0 +1,84 @@
+#ifndef ID3_INTERN_H
+#define ID3_INTERN_H
+
+#include <stddef.h>
+#include "id3_utils.h"
+
+#define ID3_INTERN_NONE 0xFFFFFFFFu /**< ID returned for unset values or a full table */
+
+/**
+ * @brief Table mapping each distinct string to a single stored copy and a 32-bit ID.
+ *
+ * One table is shared by every worker of a run. Lookups (id3_intern_find() and
+ * id3_intern_string()) never take a lock; inserts are serialized internally.
+ * IDs are dense, start at 0 and stay valid until the table is destroyed.
+ */
+typedef struct Id3InternTable Id3InternTable;
+
+/**
+ * @brief Creates an interning table.
+ *
+ * The table does not resize, which is what keeps readers lock-free; once
+ * @p capacity distinct strings are stored, further new strings are refused.
+ *
+ * @param capacity Maximum number of distinct strings (0 selects a default).
+ * @return Pointer to the new table, or NULL if allocation fails.
+ */
+Id3InternTable *id3_intern_create(unsigned int capacity);
+
+/**
+ * @brief Frees a table and every string stored in it.
+ *
+ * @param table Table to destroy (may be NULL).
+ */
+void id3_intern_destroy(Id3InternTable *table);
+
+/**
+ * @brief Returns the ID of a string, storing it first if it is new.
+ *
+ * @param table Table to intern into.
+ * @param value String bytes (need not be NUL-terminated).
+ * @param len   Number of bytes in @p value.
+ * @return The string's ID, or ID3_INTERN_NONE if the table is full or out of memory.
+ */
+unsigned int id3_intern(Id3InternTable *table, const char *value, size_t len);
+
+/**
+ * @brief Returns the ID of a string already in the table, without inserting. Lock-free.
+ *
+ * @param table Table to search.
+ * @param value String bytes.
+ * @param len   Number of bytes in @p value.
+ * @return The string's ID, or ID3_INTERN_NONE if it has not been interned.
+ */
+unsigned int id3_intern_find(const Id3InternTable *table, const char *value, size_t len);
+
+/**
+ * @brief Returns the stored copy of an interned string. Lock-free.
+ *
+ * @param table Table the ID was issued by.
+ * @param id    ID returned by id3_intern().
+ * @return NUL-terminated string owned by the table, or NULL for an unknown ID.
+ */
+const char *id3_intern_string(const Id3InternTable *table, unsigned int id);
+
+/**
+ * @brief Returns the number of distinct strings stored so far.
+ *
+ * @param table Table to query.
+ * @return Number of IDs issued.
+ */
+unsigned int id3_intern_count(const Id3InternTable *table);
+
+/**
+ * @brief Interns the artist, album and genre of a tag.
+ *
+ * Other fields and unset values get ID3_INTERN_NONE.
+ *
+ * @param table Table to intern into.
+ * @param data  Tag whose fields are interned.
+ * @param ids   Output array receiving one ID per TagField.
+ */
+void id3_intern_tag(Id3InternTable *table, const TagData *data, unsigned int ids[TAG_FIELD_COUNT]);
+
+#endif // ID3_INTERN_H
@@ -0,0 +1,244 @@
+/**
+ * @file id3_io.c
+ * @brief Positioned, 64-bit clean file I/O helpers shared by the reader and writer.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "id3_io.h"
+#include "id3_utils.h"
+
+#define COPY_CHUNK_SIZE (64 * 1024)
+#define READ_SLICE_SIZE (1024 * 1024) /**< Largest read between two deadline checks */
+#define WRITE_SLICE_SIZE (1024 * 1024) /**< Largest write charged to the rate limit at once */
+
+#define IOPRIO_CLASS_IDLE 3         /**< From linux/ioprio.h, which libc does not wrap */
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+#define RATE_BURST_SECONDS 0.25     /**< Unused bandwidth is saved up for at most this long */
+
+#define RETRY_MAX_ATTEMPTS 8        /**< Retries of one call before an error is final */
+#define RETRY_BASE_DELAY_US 10000   /**< Backoff before the first retry */
+
+static _Atomic long retry_budget = ID3_IO_DEFAULT_RETRY_BUDGET; /**< Retries left in this run */
+static _Atomic long retries_used;                               /**< Retries made in this run */
+static pthread_mutex_t rate_lock = PTHREAD_MUTEX_INITIALIZER; /**< Guards the token bucket */
+static double rate_limit;                   /**< Bytes per second, or 0 for no limit */
+static double rate_tokens;                  /**< Bytes that may be moved now; negative is debt */
+static struct timespec rate_stamp;          /**< When the bucket was last refilled */
+static _Thread_local struct timespec deadline;  /**< Zero when no deadline is set */
+static _Thread_local int deadline_hit;           /**< A read was cancelled by the deadline */
+
+int id3_io_set_idle_priority(void)
+{
+    // Applies to the calling thread and is inherited by the threads it starts.
+    return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0 ? 0 : -1;
+}
+
+void id3_io_set_rate_limit(long long bytes_per_sec)
+{
+    pthread_mutex_lock(&rate_lock);
+    rate_limit = bytes_per_sec > 0 ? (double)bytes_per_sec : 0;
+    rate_tokens = 0;
+    clock_gettime(CLOCK_MONOTONIC, &rate_stamp);
+    pthread_mutex_unlock(&rate_lock);
+}
+
+/**
+ * @brief Takes @p bytes from the shared token bucket, sleeping until they are available.
+ *
+ * A caller may overdraw the bucket; the debt makes the callers after it wait
+ * longer, so the total rate of all threads stays at the limit.
+ */
+static void throttle(size_t bytes)
+{
+    if (rate_limit <= 0) return; // Set before any worker starts
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&rate_lock);
+    double elapsed = (double)(now.tv_sec - rate_stamp.tv_sec) + (double)(now.tv_nsec - rate_stamp.tv_nsec) / 1e9;
+    if (elapsed > 0)
+    {
+        rate_tokens += elapsed * rate_limit;
+        if (rate_tokens > rate_limit * RATE_BURST_SECONDS) rate_tokens = rate_limit * RATE_BURST_SECONDS;
+        rate_stamp = now;
+    }
+    rate_tokens -= (double)bytes;
+    double wait = rate_tokens < 0 ? -rate_tokens / rate_limit : 0;
+    pthread_mutex_unlock(&rate_lock);
+    if (wait > 0)
+    {
+        struct timespec ts;
+        ts.tv_sec = (time_t)wait;
+        ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1e9);
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+    }
+}
+
+int id3_io_transient(int err)
+{
+    return err == EIO || err == ESTALE || err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+}
+
+void id3_io_set_retry_budget(long retries)
+{
+    atomic_store(&retry_budget, retries > 0 ? retries : 0);
+}
+
+long id3_io_retries_used(void)
+{
+    return atomic_load(&retries_used);
+}
+
+int id3_io_retry(int err, int attempt)
+{
+    if (err == EINTR) return 1;
+    if (!id3_io_transient(err) || attempt >= RETRY_MAX_ATTEMPTS) return 0;
+    if (atomic_fetch_sub(&retry_budget, 1) <= 0)
+    {
+        atomic_fetch_add(&retry_budget, 1);
+        return 0;
+    }
+    atomic_fetch_add(&retries_used, 1);
+
+    // Exponential backoff with jitter, so workers hit by the same outage spread out.
+    unsigned int delay = RETRY_BASE_DELAY_US << attempt;
+    usleep(delay / 2 + id3_random() % (delay / 2));
+    errno = err;
+    return 1;
+}
+
+int id3_open(const char *path, int flags, mode_t mode)
+{
+    for (int attempt = 0;; attempt++)
+    {
+        int fd = open(path, flags, mode);
+        if (fd >= 0 || !id3_io_retry(errno, attempt)) return fd;
+    }
+}
+
+void id3_io_set_deadline(long ms)
+{
+    deadline_hit = 0;
+    if (ms <= 0)
+    {
+        deadline.tv_sec = 0;
+        deadline.tv_nsec = 0;
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+}
+
+int id3_io_deadline_hit(void)
+{
+    return deadline_hit;
+}
+
+/**
+ * @brief Returns non-zero, with errno set to ETIMEDOUT, if the thread's deadline has passed.
+ */
+static int deadline_passed(void)
+{
+    if (deadline.tv_sec == 0) return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec < deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec < deadline.tv_nsec))
+    {
+        return 0;
+    }
+    deadline_hit = 1;
+    errno = ETIMEDOUT;
+    return 1;
+}
+
+int id3_pread_full(int fd, void *buf, size_t len, off_t offset)
+{
+    unsigned char *p = (unsigned char *)buf;
+    int attempt = 0;
+    while (len > 0)
+    {
+        if (deadline_passed()) return -1;
+        size_t slice = len < READ_SLICE_SIZE ? len : READ_SLICE_SIZE;
+        throttle(slice);
+        ssize_t n = pread(fd, p, slice, offset);
+        if (n < 0)
+        {
+            // A stale handle does not recover on the same descriptor; the caller reopens.
+            if (errno != ESTALE && id3_io_retry(errno, attempt++)) continue;
+            return -1;
+        }
+        if (n == 0) return -1; // Unexpected end of file
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+int id3_pwrite_full(int fd, const void *buf, size_t len, off_t offset)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    int attempt = 0;
+    while (len > 0)
+    {
+        size_t slice = len < WRITE_SLICE_SIZE ? len : WRITE_SLICE_SIZE;
+        throttle(slice);
+        ssize_t n = pwrite(fd, p, slice, offset);
+        if (n < 0)
+        {
+            // After a failed write the kernel may already have dropped the dirty pages, so a
+            // repeated write that succeeds would hide lost data: EIO is final for writes.
+            if (errno != ESTALE && errno != EIO && id3_io_retry(errno, attempt++)) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+int id3_pwrite_zeros(int fd, off_t len, off_t offset)
+{
+    static const unsigned char zeros[4096];
+    while (len > 0)
+    {
+        size_t chunk = len < (off_t)sizeof(zeros) ? (size_t)len : sizeof(zeros);
+        if (id3_pwrite_full(fd, zeros, chunk, offset) != 0) return -1;
+        offset += (off_t)chunk;
+        len -= (off_t)chunk;
+    }
+    return 0;
+}
+
+int id3_copy_range(int in_fd, off_t in_off, int out_fd, off_t out_off, off_t len)
+{
+    unsigned char buffer[COPY_CHUNK_SIZE];
+    while (len > 0)
+    {
+        size_t chunk = len < (off_t)sizeof(buffer) ? (size_t)len : sizeof(buffer);
+        if (id3_pread_full(in_fd, buffer, chunk, in_off) != 0) return -1;
+        if (id3_pwrite_full(out_fd, buffer, chunk, out_off) != 0) return -1;
+        in_off += (off_t)chunk;
+        out_off += (off_t)chunk;
+        len -= (off_t)chunk;
+    }
+    return 0;
+}
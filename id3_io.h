@@ -0,0 +1,157 @@
+#ifndef ID3_IO_H
+#define ID3_IO_H
+
+#include <sys/types.h>
+#include <stddef.h>
+
+#define ID3_IO_DEFAULT_RETRY_BUDGET 1000 /**< Retries of transient errors allowed per run */
+
+/* Tag offsets and audio lengths must be able to address multi-GB files. */
+_Static_assert(sizeof(off_t) == 8, "off_t must be 64-bit; compile with -D_FILE_OFFSET_BITS=64");
+
+/**
+ * @brief Reads exactly @p len bytes from @p fd at @p offset.
+ *
+ * Uses positioned reads so the file offset of @p fd is never moved, and
+ * restarts on short reads and EINTR. Transient errors other than ESTALE are
+ * retried (see id3_io_retry()). Large reads are split into slices, and
+ * each slice is a cancellation point for the calling thread's deadline (see
+ * id3_io_set_deadline()).
+ *
+ * @param fd     Open file descriptor.
+ * @param buf    Destination buffer of at least @p len bytes.
+ * @param len    Number of bytes to read.
+ * @param offset Absolute file offset to read from.
+ * @return 0 on success, -1 on I/O error, premature end of file or an expired
+ *         deadline (errno is ETIMEDOUT).
+ */
+int id3_pread_full(int fd, void *buf, size_t len, off_t offset);
+
+/**
+ * @brief Writes exactly @p len bytes to @p fd at @p offset.
+ *
+ * Restarts on short writes, and retries transient errors other than ESTALE and
+ * EIO. A write that failed with EIO may have lost data already accepted by the
+ * kernel, so it is reported rather than repeated.
+ *
+ * @param fd     Open file descriptor.
+ * @param buf    Source buffer of @p len bytes.
+ * @param len    Number of bytes to write.
+ * @param offset Absolute file offset to write to.
+ * @return 0 on success, -1 on failure.
+ */
+int id3_pwrite_full(int fd, const void *buf, size_t len, off_t offset);
+
+/**
+ * @brief Writes @p len zero bytes to @p fd at @p offset.
+ *
+ * @param fd     Open file descriptor.
+ * @param len    Number of zero bytes to write.
+ * @param offset Absolute file offset to write to.
+ * @return 0 on success, -1 on failure.
+ */
+int id3_pwrite_zeros(int fd, off_t len, off_t offset);
+
+/**
+ * @brief Copies @p len bytes between two descriptors using positioned I/O.
+ *
+ * The copy stops with ETIMEDOUT once the calling thread's deadline has passed.
+ *
+ * @param in_fd   Source descriptor.
+ * @param in_off  Offset in the source to start copying from.
+ * @param out_fd  Destination descriptor.
+ * @param out_off Offset in the destination to start writing at.
+ * @param len     Number of bytes to copy.
+ * @return 0 on success, -1 on failure.
+ */
+int id3_copy_range(int in_fd, off_t in_off, int out_fd, off_t out_off, off_t len);
+
+/**
+ * @brief Moves the calling thread to the idle I/O scheduling class.
+ *
+ * Its disk I/O is then only served when no other process wants the disk.
+ * Threads started afterwards inherit the class, so call this before any
+ * worker is started. Linux only, and only honoured by I/O schedulers that
+ * support priorities (BFQ, CFQ).
+ *
+ * @return 0 on success, -1 if the class could not be set.
+ */
+int id3_io_set_idle_priority(void);
+
+/**
+ * @brief Limits the combined read and write rate of all threads.
+ *
+ * Every positioned read and write takes its size from one token bucket,
+ * which is refilled at the given rate and holds at most a quarter second's
+ * worth of bytes, so the limit also holds over short intervals.
+ *
+ * @param bytes_per_sec Limit in bytes per second, or 0 for no limit.
+ */
+void id3_io_set_rate_limit(long long bytes_per_sec);
+
+/**
+ * @brief Returns non-zero if an errno value may go away when the call is repeated.
+ *
+ * EIO, ESTALE and EAGAIN are what network filesystems report for a server
+ * that is briefly unreachable or has just failed over; EINTR is an interrupted call.
+ * EIO is only retried for reads and opens (see id3_pwrite_full()).
+ *
+ * @param err errno value.
+ * @return Non-zero if the error is transient.
+ */
+int id3_io_transient(int err);
+
+/**
+ * @brief Decides whether a failed call is retried, and waits before the retry.
+ *
+ * Transient errors are retried up to a fixed number of times per call, with
+ * exponential backoff and jitter. Every retry except after EINTR takes one
+ * unit of a budget shared by the whole run. Once the budget is used up, errors
+ * are final, so a mount that stays down fails fast.
+ *
+ * @param err     errno of the failed call.
+ * @param attempt Number of retries already made for this call.
+ * @return Non-zero if the call should be repeated (errno is preserved), 0 if the error is final.
+ */
+int id3_io_retry(int err, int attempt);
+
+/**
+ * @brief Sets the number of retries allowed for the rest of the run.
+ *
+ * @param retries Retry budget; 0 makes every error final.
+ */
+void id3_io_set_retry_budget(long retries);
+
+/**
+ * @brief Returns the number of retries made so far in this run.
+ */
+long id3_io_retries_used(void);
+
+/**
+ * @brief Opens a file like open(2), retrying transient errors.
+ *
+ * @param path  File to open.
+ * @param flags open(2) flags.
+ * @param mode  Permissions of a created file.
+ * @return File descriptor, or -1 with errno set.
+ */
+int id3_open(const char *path, int flags, mode_t mode);
+
+/**
+ * @brief Sets a deadline for the I/O of the calling thread.
+ *
+ * Once the deadline has passed, reads fail with ETIMEDOUT. Writes are never
+ * cancelled, so a write that has started always completes and a file is
+ * never left half-written; work still stops at its next read.
+ *
+ * @param ms Milliseconds from now, or 0 to clear the deadline.
+ */
+void id3_io_set_deadline(long ms);
+
+/**
+ * @brief Returns non-zero if an I/O call of the calling thread was cancelled
+ *        by its deadline since the deadline was last set.
+ */
+int id3_io_deadline_hit(void);
+
+#endif // ID3_IO_H
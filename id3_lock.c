@@ -0,0 +1,118 @@
+/**
+ * @file id3_lock.c
+ * @brief Advisory file locks and change detection for concurrent edits.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "id3_lock.h"
+#include "id3_io.h"
+#include "id3_parser.h"
+
+#define LOCK_MAX_REOPENS 16 /**< Times a lock is retaken after the file was replaced */
+
+static Id3LockMode lock_mode = ID3_LOCK_EXCLUSIVE;
+
+void id3_lock_set_mode(Id3LockMode mode)
+{
+    lock_mode = mode;
+}
+
+Id3LockMode id3_lock_mode(void)
+{
+    return lock_mode;
+}
+
+/**
+ * @brief Waits for an exclusive lock on @p fd; returns 0 on success.
+ */
+static int lock_fd(int fd, int writable)
+{
+    int ret;
+    if (writable)
+    {
+        struct flock fl;
+        memset(&fl, 0, sizeof(fl));
+        fl.l_type = F_WRLCK;
+        fl.l_whence = SEEK_SET;
+        do ret = fcntl(fd, F_OFD_SETLKW, &fl); while (ret != 0 && errno == EINTR);
+        if (ret == 0 || errno != EINVAL) return ret;
+        // Kernels before 3.15 have no OFD locks.
+    }
+    do ret = flock(fd, LOCK_EX); while (ret != 0 && errno == EINTR);
+    return ret;
+}
+
+int id3_lock_file(const char *filename)
+{
+    for (int attempt = 0; attempt < LOCK_MAX_REOPENS; attempt++)
+    {
+        int writable = 1;
+        int fd = id3_open(filename, O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            writable = 0;
+            fd = id3_open(filename, O_RDONLY | O_CLOEXEC, 0);
+        }
+        if (fd < 0) return -1;
+
+        if (lock_fd(fd, writable) != 0)
+        {
+            if (errno == ENOLCK || errno == EOPNOTSUPP || errno == ENOSYS) return fd;
+            close(fd);
+            return -1;
+        }
+
+        // While we waited, the holder may have renamed a new file over this one.
+        struct stat locked, current;
+        if (fstat(fd, &locked) == 0 && stat(filename, &current) == 0 &&
+            locked.st_dev == current.st_dev && locked.st_ino == current.st_ino)
+        {
+            return fd;
+        }
+        close(fd);
+    }
+    return -1;
+}
+
+void id3_unlock_file(int handle)
+{
+    // Closing the descriptor releases both OFD and flock() locks.
+    if (handle >= 0) close(handle);
+}
+
+int id3_file_unchanged(int handle, const Id3FileStamp *stamp)
+{
+    struct stat st;
+    if (fstat(handle, &st) != 0 ||
+        (unsigned long long)st.st_dev != stamp->dev || (unsigned long long)st.st_ino != stamp->ino ||
+        (long long)st.st_size != stamp->size ||
+        (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec != stamp->mtime_ns)
+    {
+        return 0;
+    }
+
+    // Coarse timestamps can hide a change made within the same tick, so compare the tag too.
+    unsigned char header[ID3_HEADER_SIZE];
+    Id3Header hdr;
+    if (id3_pread_full(handle, header, sizeof(header), 0) != 0 ||
+        id3_parse_header(header, sizeof(header), &hdr) != ID3_PARSE_OK ||
+        (off_t)ID3_HEADER_SIZE + hdr.tag_size > st.st_size)
+    {
+        return 0;
+    }
+    unsigned char *body = (unsigned char *)malloc(hdr.tag_size ? hdr.tag_size : 1);
+    if (!body) return 0;
+    int same = id3_pread_full(handle, body, hdr.tag_size, ID3_HEADER_SIZE) == 0 &&
+               id3_hash64(body, hdr.tag_size, id3_hash64(header, sizeof(header), ID3_HASH64_SEED)) == stamp->tag_hash;
+    free(body);
+    return same;
+}
@@ -0,0 +1,61 @@
+#ifndef ID3_LOCK_H
+#define ID3_LOCK_H
+
+#include "id3_utils.h"
+
+/**
+ * @brief How read-modify-write edits are protected against other processes.
+ */
+typedef enum 
+{
+    ID3_LOCK_EXCLUSIVE = 0, /**< Hold a lock on the file from read to write (default) */
+    ID3_LOCK_OPTIMISTIC,    /**< Read unlocked; lock, check nothing changed and write; retry on conflict */
+    ID3_LOCK_NONE           /**< No locking */
+} Id3LockMode;
+
+/**
+ * @brief Selects the locking mode used by all later edits.
+ *
+ * @param mode Locking mode.
+ */
+void id3_lock_set_mode(Id3LockMode mode);
+
+/**
+ * @brief Returns the current locking mode.
+ *
+ * @return Locking mode set with id3_lock_set_mode().
+ */
+Id3LockMode id3_lock_mode(void);
+
+/**
+ * @brief Takes an exclusive advisory lock on a file, waiting for other holders.
+ *
+ * An open-file-description (OFD) lock is used, which other processes and other
+ * threads of this process both respect and which NFS forwards to the server;
+ * files that cannot be opened for writing, and kernels without OFD locks, fall
+ * back to flock(). Because edits may replace a file by renaming a new one over
+ * it, the lock is retaken if the path no longer names the locked file. On file
+ * systems without lock support the file is returned unlocked.
+ *
+ * @param filename File to lock.
+ * @return Lock handle (a file descriptor of the file), or -1 on failure.
+ */
+int id3_lock_file(const char *filename);
+
+/**
+ * @brief Releases a lock taken with id3_lock_file().
+ *
+ * @param handle Lock handle (negative values are ignored).
+ */
+void id3_unlock_file(int handle);
+
+/**
+ * @brief Checks that a locked file still has the size, time and tag it had when read.
+ *
+ * @param handle Lock handle of the file.
+ * @param stamp  Stamp recorded when the tag was read.
+ * @return Non-zero if the file is unchanged.
+ */
+int id3_file_unchanged(int handle, const Id3FileStamp *stamp);
+
+#endif // ID3_LOCK_H
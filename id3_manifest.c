@@ -0,0 +1,178 @@
+/**
+ * @file id3_manifest.c
+ * @brief Loading of bulk-edit manifests, grouped by file.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_manifest.h"
+#include "id3_csv.h"
+#include "error_handling.h"
+
+/**
+ * @brief FNV-1a hash of a path.
+ */
+static size_t hash_path(const char *path)
+{
+    size_t h = (size_t)14695981039346656037ULL;
+    for (; *path; path++)
+    {
+        h ^= (unsigned char)*path;
+        h *= (size_t)1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Doubles the hash index and re-inserts every entry.
+ */
+static int grow_index(Id3Manifest *manifest)
+{
+    size_t cap = manifest->index_cap ? manifest->index_cap * 2 : 1024;
+    size_t *index = (size_t *)calloc(cap, sizeof(size_t));
+    if (!index) return -1;
+    for (size_t i = 0; i < manifest->count; i++)
+    {
+        size_t slot = hash_path(manifest->edits[i].path) & (cap - 1);
+        while (index[slot]) slot = (slot + 1) & (cap - 1);
+        index[slot] = i + 1;
+    }
+    free(manifest->index);
+    manifest->index = index;
+    manifest->index_cap = cap;
+    return 0;
+}
+
+/**
+ * @brief Returns the edit entry for a path, creating it if the path is new.
+ */
+static Id3ManifestEdit *find_or_add(Id3Manifest *manifest, const char *path)
+{
+    // Keep the hash index at most half full.
+    if (2 * (manifest->count + 1) > manifest->index_cap && grow_index(manifest) != 0) return NULL;
+
+    size_t slot = hash_path(path) & (manifest->index_cap - 1);
+    while (manifest->index[slot])
+    {
+        Id3ManifestEdit *edit = &manifest->edits[manifest->index[slot] - 1];
+        if (strcmp(edit->path, path) == 0) return edit;
+        slot = (slot + 1) & (manifest->index_cap - 1);
+    }
+
+    if (manifest->count == manifest->cap)
+    {
+        size_t cap = manifest->cap ? manifest->cap * 2 : 256;
+        Id3ManifestEdit *edits = (Id3ManifestEdit *)realloc(manifest->edits, cap * sizeof(*edits));
+        if (!edits) return NULL;
+        manifest->edits = edits;
+        manifest->cap = cap;
+    }
+    Id3ManifestEdit *edit = &manifest->edits[manifest->count];
+    edit->path = strdup(path);
+    edit->values = create_tag_data();
+    edit->set_mask = 0;
+    if (!edit->path || !edit->values)
+    {
+        free(edit->path);
+        free_tag_data(edit->values);
+        return NULL;
+    }
+    manifest->index[slot] = ++manifest->count;
+    return edit;
+}
+
+int id3_manifest_load(const char *filename, Id3Manifest *manifest)
+{
+    memset(manifest, 0, sizeof(*manifest));
+
+    Id3CsvReader reader;
+    if (id3_csv_open(&reader, filename, 0) != 0)
+    {
+        display_error("Cannot open manifest file.");
+        return -1;
+    }
+
+    // Map header columns to fields: -1 for the path column, -2 for "no column".
+    int path_col = -1;
+    int columns[64];
+    size_t ncolumns = 0;
+    if (id3_csv_next(&reader) != 1 || reader.ncells > sizeof(columns) / sizeof(columns[0]))
+    {
+        display_error("Manifest has no usable header row.");
+        id3_csv_close(&reader);
+        return -1;
+    }
+    ncolumns = reader.ncells;
+    for (size_t i = 0; i < ncolumns; i++)
+    {
+        const char *name = id3_csv_cell(&reader, i);
+        columns[i] = tag_field_from_name(name);
+        if (strcmp(name, "path") == 0 && path_col < 0)
+        {
+            path_col = (int)i;
+        }
+        else if (columns[i] < 0)
+        {
+            fprintf(stderr, "Error: Unknown manifest column '%s'.\n", name);
+            id3_csv_close(&reader);
+            return -1;
+        }
+    }
+    if (path_col < 0)
+    {
+        display_error("Manifest header has no 'path' column.");
+        id3_csv_close(&reader);
+        return -1;
+    }
+
+    int status;
+    while ((status = id3_csv_next(&reader)) == 1)
+    {
+        const char *path = id3_csv_cell(&reader, (size_t)path_col);
+        if (!*path) continue;
+        manifest->rows++;
+
+        Id3ManifestEdit *edit = find_or_add(manifest, path);
+        if (!edit)
+        {
+            status = -1;
+            break;
+        }
+        for (size_t i = 0; i < ncolumns; i++)
+        {
+            const char *value = id3_csv_cell(&reader, i);
+            if ((int)i == path_col || !*value) continue;
+            if (tag_set(edit->values, (TagField)columns[i], value) != 0)
+            {
+                status = -1;
+                break;
+            }
+            edit->set_mask |= 1u << columns[i];
+        }
+        if (status < 0) break;
+    }
+    if (status < 0)
+    {
+        fprintf(stderr, "Error: Malformed manifest near line %lu.\n", reader.line);
+        id3_csv_close(&reader);
+        id3_manifest_free(manifest);
+        return -1;
+    }
+    id3_csv_close(&reader);
+    return 0;
+}
+
+void id3_manifest_free(Id3Manifest *manifest)
+{
+    for (size_t i = 0; i < manifest->count; i++)
+    {
+        free(manifest->edits[i].path);
+        free_tag_data(manifest->edits[i].values);
+    }
+    free(manifest->edits);
+    free(manifest->index);
+    memset(manifest, 0, sizeof(*manifest));
+}
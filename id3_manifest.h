@@ -0,0 +1,52 @@
+#ifndef ID3_MANIFEST_H
+#define ID3_MANIFEST_H
+
+#include <stddef.h>
+#include "id3_utils.h"
+
+/**
+ * @brief All edits requested for one file, merged from every manifest row naming it.
+ */
+typedef struct 
+{
+    char *path;            /**< Path of the MP3 file */
+    TagData *values;       /**< New values; only fields in set_mask are meaningful */
+    unsigned int set_mask; /**< Bit (1u << TagField) for every field to change */
+} Id3ManifestEdit;
+
+/**
+ * @brief Edits loaded from a CSV/TSV manifest, grouped so each file appears once.
+ */
+typedef struct 
+{
+    Id3ManifestEdit *edits; /**< One entry per distinct path, in first-seen order */
+    size_t count;           /**< Number of entries in edits */
+    size_t cap;             /**< Capacity of edits */
+    size_t *index;          /**< Open-addressing hash of path -> edit index + 1 */
+    size_t index_cap;       /**< Number of hash slots (power of two) */
+    size_t rows;            /**< Number of data rows read */
+} Id3Manifest;
+
+/**
+ * @brief Loads a manifest file.
+ *
+ * The first row is a header naming the columns: one column must be "path"
+ * and every other column must be a field name such as "title" or "artist".
+ * Each following row gives a path and new values; empty cells leave the field
+ * unchanged. Rows are read one at a time, and rows for a path that was already
+ * seen are merged into its existing entry, later values winning.
+ *
+ * @param filename Manifest to read (comma- or tab-separated, "-" for stdin).
+ * @param manifest Manifest to fill in.
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_manifest_load(const char *filename, Id3Manifest *manifest);
+
+/**
+ * @brief Frees everything held by a manifest.
+ *
+ * @param manifest Manifest to free.
+ */
+void id3_manifest_free(Id3Manifest *manifest);
+
+#endif // ID3_MANIFEST_H
@@ -0,0 +1,154 @@
+/**
+ * @file id3_mpeg.c
+ * @brief MPEG audio frame header parsing for duration estimates.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "id3_mpeg.h"
+#include "id3_io.h"
+#include "id3_utils.h"
+
+#define MPEG_PROBE_SIZE 8192 /**< Bytes after the tag searched for the first frame */
+
+/**
+ * @brief Bitrates in kbit/s by [MPEG-1 or not][layer - 1][index].
+ */
+static const unsigned short bitrates[2][3][15] = 
+{
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+    },
+    {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+    },
+};
+
+/**
+ * @brief Sample rates in Hz by [version bits][index]; version 1 is reserved.
+ */
+static const unsigned int sample_rates[4][3] = 
+{
+    { 11025, 12000, 8000 },  // MPEG-2.5
+    { 0, 0, 0 },             // reserved
+    { 22050, 24000, 16000 }, // MPEG-2
+    { 44100, 48000, 32000 }, // MPEG-1
+};
+
+/**
+ * @brief Fields of a decoded frame header.
+ */
+typedef struct 
+{
+    int mpeg1;                /**< Non-zero for MPEG-1 */
+    int layer;                /**< 1, 2 or 3 */
+    unsigned int bitrate;     /**< kbit/s */
+    unsigned int sample_rate; /**< Hz */
+    unsigned int samples;     /**< Samples per frame */
+    int mono;                 /**< Non-zero for single-channel audio */
+    size_t length;            /**< Frame length in bytes, header included */
+} MpegFrame;
+
+/**
+ * @brief Decodes a 4-byte frame header; returns 0 if it is valid.
+ */
+static int decode_frame(const unsigned char *p, MpegFrame *f)
+{
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return -1;
+    int version = (p[1] >> 3) & 3;
+    int layer_bits = (p[1] >> 1) & 3;
+    int bitrate_index = p[2] >> 4;
+    int rate_index = (p[2] >> 2) & 3;
+    if (version == 1 || layer_bits == 0 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+    {
+        return -1; // Reserved or free-format values
+    }
+    f->mpeg1 = version == 3;
+    f->layer = 4 - layer_bits;
+    f->bitrate = bitrates[f->mpeg1 ? 0 : 1][f->layer - 1][bitrate_index];
+    f->sample_rate = sample_rates[version][rate_index];
+    f->samples = f->layer == 1 ? 384 : (f->layer == 3 && !f->mpeg1) ? 576 : 1152;
+    f->mono = (p[3] >> 6) == 3;
+    int padding = (p[2] >> 1) & 1;
+    if (f->layer == 1) f->length = (12 * f->bitrate * 1000 / f->sample_rate + padding) * 4;
+    else f->length = f->samples / 8 * f->bitrate * 1000 / f->sample_rate + padding;
+    return 0;
+}
+
+/**
+ * @brief Returns non-zero if a valid frame header at @p pos is followed by another one.
+ *
+ * Sync bytes also occur by chance in audio data, so a header only counts when the
+ * next frame starts where it says (or the buffer ends first).
+ */
+static int frame_at(const unsigned char *buf, size_t len, size_t pos, MpegFrame *f)
+{
+    MpegFrame next;
+    if (decode_frame(buf + pos, f) != 0) return 0;
+    if (pos + f->length + 4 > len) return 1;
+    return decode_frame(buf + pos + f->length, &next) == 0;
+}
+
+int id3_mpeg_duration(const unsigned char *buf, size_t len, unsigned long long audio_bytes)
+{
+    MpegFrame f;
+    size_t pos = 0;
+    while (pos + 4 <= len && !frame_at(buf, len, pos, &f)) pos++;
+    if (pos + 4 > len) return -1;
+    const unsigned char *frame = buf + pos;
+    size_t avail = len - pos;
+
+    // A Xing/Info header sits after the side information of the first frame.
+    size_t xing = f.mpeg1 ? (f.mono ? 21 : 36) : (f.mono ? 13 : 21);
+    unsigned int frames = 0;
+    if (xing + 12 <= avail &&
+        (memcmp(frame + xing, "Xing", 4) == 0 || memcmp(frame + xing, "Info", 4) == 0) &&
+        (frame[xing + 7] & 1))
+    {
+        frames = id3_be32_decode(frame + xing + 8);
+    }
+    else if (36 + 18 <= avail && memcmp(frame + 36, "VBRI", 4) == 0)
+    {
+        frames = id3_be32_decode(frame + 36 + 14);
+    }
+    if (frames > 0)
+    {
+        return (int)((unsigned long long)frames * f.samples / f.sample_rate);
+    }
+
+    // Constant bitrate: every byte of audio plays for the same time.
+    unsigned long long bytes = audio_bytes > pos ? audio_bytes - pos : 0;
+    return (int)(bytes * 8 / (f.bitrate * 1000ULL));
+}
+
+int id3_file_duration(const char *filename)
+{
+    int fd = id3_open(filename, O_RDONLY, 0);
+    if (fd < 0) return -1;
+    struct stat st;
+    unsigned char buf[MPEG_PROBE_SIZE];
+    int duration = -1;
+    if (fstat(fd, &st) == 0 && id3_pread_full(fd, buf, ID3_HEADER_SIZE, 0) == 0)
+    {
+        // The audio starts after the ID3v2 tag, if there is one.
+        off_t start = memcmp(buf, "ID3", 3) == 0 ? ID3_HEADER_SIZE + (off_t)id3_syncsafe_decode(&buf[6]) : 0;
+        if (start < st.st_size)
+        {
+            size_t len = st.st_size - start < MPEG_PROBE_SIZE ? (size_t)(st.st_size - start) : MPEG_PROBE_SIZE;
+            if (id3_pread_full(fd, buf, len, start) == 0)
+            {
+                duration = id3_mpeg_duration(buf, len, (unsigned long long)(st.st_size - start));
+            }
+        }
+    }
+    close(fd);
+    return duration;
+}
@@ -0,0 +1,28 @@
+#ifndef ID3_MPEG_H
+#define ID3_MPEG_H
+
+#include <stddef.h>
+
+/**
+ * @brief Estimates the playing time of the audio in a buffer of MPEG frames.
+ *
+ * The first valid MPEG audio frame header is located in @p buf. If that frame
+ * carries a Xing/Info or VBRI header with a frame count, the duration is exact;
+ * otherwise the stream is assumed to be constant bitrate.
+ *
+ * @param buf         Bytes starting where the audio begins.
+ * @param len         Number of bytes in @p buf.
+ * @param audio_bytes Total length of the audio in the file.
+ * @return Duration in seconds, or -1 if no frame header was found.
+ */
+int id3_mpeg_duration(const unsigned char *buf, size_t len, unsigned long long audio_bytes);
+
+/**
+ * @brief Estimates the playing time of an MP3 file.
+ *
+ * @param filename The MP3 file.
+ * @return Duration in seconds, or -1 if it cannot be determined.
+ */
+int id3_file_duration(const char *filename);
+
+#endif // ID3_MPEG_H
@@ -0,0 +1,510 @@
+/**
+ * @file id3_normalize.c
+ * @brief Text normalization passes for tag values.
+ *
+ * Composition covers a Latin base letter followed by one combining mark, which is
+ * what decomposed (NFD) text from macOS file names and many taggers contains. Other
+ * Unicode sequences are left as they are.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "id3_normalize.h"
+#include "id3_batch.h"
+#include "id3_writer.h"
+#include "error_handling.h"
+
+/**
+ * @brief Canonical compositions of an ASCII letter and a combining mark, sorted by (mark, base).
+ */
+static const struct 
+{
+    char base;
+    unsigned short mark;
+    unsigned short composed;
+} compositions[] = 
+{
+    { 'A', 0x0300, 0x00C0 },
+    { 'E', 0x0300, 0x00C8 },
+    { 'I', 0x0300, 0x00CC },
+    { 'O', 0x0300, 0x00D2 },
+    { 'U', 0x0300, 0x00D9 },
+    { 'a', 0x0300, 0x00E0 },
+    { 'e', 0x0300, 0x00E8 },
+    { 'i', 0x0300, 0x00EC },
+    { 'o', 0x0300, 0x00F2 },
+    { 'u', 0x0300, 0x00F9 },
+    { 'A', 0x0301, 0x00C1 },
+    { 'C', 0x0301, 0x0106 },
+    { 'E', 0x0301, 0x00C9 },
+    { 'I', 0x0301, 0x00CD },
+    { 'L', 0x0301, 0x0139 },
+    { 'N', 0x0301, 0x0143 },
+    { 'O', 0x0301, 0x00D3 },
+    { 'R', 0x0301, 0x0154 },
+    { 'S', 0x0301, 0x015A },
+    { 'U', 0x0301, 0x00DA },
+    { 'Y', 0x0301, 0x00DD },
+    { 'Z', 0x0301, 0x0179 },
+    { 'a', 0x0301, 0x00E1 },
+    { 'c', 0x0301, 0x0107 },
+    { 'e', 0x0301, 0x00E9 },
+    { 'i', 0x0301, 0x00ED },
+    { 'l', 0x0301, 0x013A },
+    { 'n', 0x0301, 0x0144 },
+    { 'o', 0x0301, 0x00F3 },
+    { 'r', 0x0301, 0x0155 },
+    { 's', 0x0301, 0x015B },
+    { 'u', 0x0301, 0x00FA },
+    { 'y', 0x0301, 0x00FD },
+    { 'z', 0x0301, 0x017A },
+    { 'A', 0x0302, 0x00C2 },
+    { 'C', 0x0302, 0x0108 },
+    { 'E', 0x0302, 0x00CA },
+    { 'G', 0x0302, 0x011C },
+    { 'H', 0x0302, 0x0124 },
+    { 'I', 0x0302, 0x00CE },
+    { 'J', 0x0302, 0x0134 },
+    { 'O', 0x0302, 0x00D4 },
+    { 'S', 0x0302, 0x015C },
+    { 'U', 0x0302, 0x00DB },
+    { 'W', 0x0302, 0x0174 },
+    { 'Y', 0x0302, 0x0176 },
+    { 'a', 0x0302, 0x00E2 },
+    { 'c', 0x0302, 0x0109 },
+    { 'e', 0x0302, 0x00EA },
+    { 'g', 0x0302, 0x011D },
+    { 'h', 0x0302, 0x0125 },
+    { 'i', 0x0302, 0x00EE },
+    { 'j', 0x0302, 0x0135 },
+    { 'o', 0x0302, 0x00F4 },
+    { 's', 0x0302, 0x015D },
+    { 'u', 0x0302, 0x00FB },
+    { 'w', 0x0302, 0x0175 },
+    { 'y', 0x0302, 0x0177 },
+    { 'A', 0x0303, 0x00C3 },
+    { 'I', 0x0303, 0x0128 },
+    { 'N', 0x0303, 0x00D1 },
+    { 'O', 0x0303, 0x00D5 },
+    { 'U', 0x0303, 0x0168 },
+    { 'a', 0x0303, 0x00E3 },
+    { 'i', 0x0303, 0x0129 },
+    { 'n', 0x0303, 0x00F1 },
+    { 'o', 0x0303, 0x00F5 },
+    { 'u', 0x0303, 0x0169 },
+    { 'A', 0x0304, 0x0100 },
+    { 'E', 0x0304, 0x0112 },
+    { 'I', 0x0304, 0x012A },
+    { 'O', 0x0304, 0x014C },
+    { 'U', 0x0304, 0x016A },
+    { 'a', 0x0304, 0x0101 },
+    { 'e', 0x0304, 0x0113 },
+    { 'i', 0x0304, 0x012B },
+    { 'o', 0x0304, 0x014D },
+    { 'u', 0x0304, 0x016B },
+    { 'A', 0x0306, 0x0102 },
+    { 'E', 0x0306, 0x0114 },
+    { 'G', 0x0306, 0x011E },
+    { 'I', 0x0306, 0x012C },
+    { 'O', 0x0306, 0x014E },
+    { 'U', 0x0306, 0x016C },
+    { 'a', 0x0306, 0x0103 },
+    { 'e', 0x0306, 0x0115 },
+    { 'g', 0x0306, 0x011F },
+    { 'i', 0x0306, 0x012D },
+    { 'o', 0x0306, 0x014F },
+    { 'u', 0x0306, 0x016D },
+    { 'C', 0x0307, 0x010A },
+    { 'E', 0x0307, 0x0116 },
+    { 'G', 0x0307, 0x0120 },
+    { 'I', 0x0307, 0x0130 },
+    { 'Z', 0x0307, 0x017B },
+    { 'c', 0x0307, 0x010B },
+    { 'e', 0x0307, 0x0117 },
+    { 'g', 0x0307, 0x0121 },
+    { 'z', 0x0307, 0x017C },
+    { 'A', 0x0308, 0x00C4 },
+    { 'E', 0x0308, 0x00CB },
+    { 'I', 0x0308, 0x00CF },
+    { 'O', 0x0308, 0x00D6 },
+    { 'U', 0x0308, 0x00DC },
+    { 'Y', 0x0308, 0x0178 },
+    { 'a', 0x0308, 0x00E4 },
+    { 'e', 0x0308, 0x00EB },
+    { 'i', 0x0308, 0x00EF },
+    { 'o', 0x0308, 0x00F6 },
+    { 'u', 0x0308, 0x00FC },
+    { 'y', 0x0308, 0x00FF },
+    { 'A', 0x030A, 0x00C5 },
+    { 'U', 0x030A, 0x016E },
+    { 'a', 0x030A, 0x00E5 },
+    { 'u', 0x030A, 0x016F },
+    { 'O', 0x030B, 0x0150 },
+    { 'U', 0x030B, 0x0170 },
+    { 'o', 0x030B, 0x0151 },
+    { 'u', 0x030B, 0x0171 },
+    { 'C', 0x030C, 0x010C },
+    { 'D', 0x030C, 0x010E },
+    { 'E', 0x030C, 0x011A },
+    { 'L', 0x030C, 0x013D },
+    { 'N', 0x030C, 0x0147 },
+    { 'R', 0x030C, 0x0158 },
+    { 'S', 0x030C, 0x0160 },
+    { 'T', 0x030C, 0x0164 },
+    { 'Z', 0x030C, 0x017D },
+    { 'c', 0x030C, 0x010D },
+    { 'd', 0x030C, 0x010F },
+    { 'e', 0x030C, 0x011B },
+    { 'l', 0x030C, 0x013E },
+    { 'n', 0x030C, 0x0148 },
+    { 'r', 0x030C, 0x0159 },
+    { 's', 0x030C, 0x0161 },
+    { 't', 0x030C, 0x0165 },
+    { 'z', 0x030C, 0x017E },
+    { 'C', 0x0327, 0x00C7 },
+    { 'G', 0x0327, 0x0122 },
+    { 'K', 0x0327, 0x0136 },
+    { 'L', 0x0327, 0x013B },
+    { 'N', 0x0327, 0x0145 },
+    { 'R', 0x0327, 0x0156 },
+    { 'S', 0x0327, 0x015E },
+    { 'T', 0x0327, 0x0162 },
+    { 'c', 0x0327, 0x00E7 },
+    { 'g', 0x0327, 0x0123 },
+    { 'k', 0x0327, 0x0137 },
+    { 'l', 0x0327, 0x013C },
+    { 'n', 0x0327, 0x0146 },
+    { 'r', 0x0327, 0x0157 },
+    { 's', 0x0327, 0x015F },
+    { 't', 0x0327, 0x0163 },
+    { 'A', 0x0328, 0x0104 },
+    { 'E', 0x0328, 0x0118 },
+    { 'I', 0x0328, 0x012E },
+    { 'U', 0x0328, 0x0172 },
+    { 'a', 0x0328, 0x0105 },
+    { 'e', 0x0328, 0x0119 },
+    { 'i', 0x0328, 0x012F },
+    { 'u', 0x0328, 0x0173 },
+};
+
+/**
+ * @brief Shared state of a normalization run.
+ */
+typedef struct 
+{
+    const Id3PathList *files;
+    unsigned int ops;
+    _Atomic size_t modified;
+} NormalizeJob;
+
+/**
+ * @brief Returns non-zero if no byte of the value has its top bit set.
+ */
+static int is_ascii(const char *s, size_t len)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        if (_mm_movemask_epi8(v)) return 0;
+    }
+#else
+    for (; i + 8 <= len; i += 8)
+    {
+        unsigned long long w;
+        memcpy(&w, s + i, 8);
+        if (w & 0x8080808080808080ULL) return 0;
+    }
+#endif
+    for (; i < len; i++)
+    {
+        if ((unsigned char)s[i] & 0x80) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns the position of the first control byte (other than tab) or DEL at or
+ *        after @p i, or @p len if there is none. The value must be pure ASCII.
+ */
+static size_t find_control(const char *s, size_t i, size_t len)
+{
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(0x20), del = _mm_set1_epi8(0x7F), tab = _mm_set1_epi8('\t');
+    for (; i + 16 <= len; i += 16)
+    {
+        // ASCII bytes are non-negative, so the signed compare finds the control bytes.
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del));
+        int mask = _mm_movemask_epi8(_mm_andnot_si128(_mm_cmpeq_epi8(v, tab), bad));
+        if (mask) return i + (size_t)__builtin_ctz((unsigned int)mask);
+    }
+#endif
+    for (; i < len; i++)
+    {
+        unsigned char c = (unsigned char)s[i];
+        if ((c < 0x20 && c != '\t') || c == 0x7F) return i;
+    }
+    return len;
+}
+
+/**
+ * @brief Strips pure-ASCII input into @p out, copying the runs between control bytes in bulk.
+ */
+static size_t strip_ascii(const char *in, size_t len, char *out)
+{
+    size_t n = 0, i = 0;
+    while (i < len)
+    {
+        size_t end = find_control(in, i, len);
+        memcpy(out + n, in + i, end - i);
+        n += end - i;
+        i = end + 1;
+    }
+    return n;
+}
+
+/**
+ * @brief Looks up the composition of @p base and @p mark, or returns 0.
+ */
+static unsigned int compose(char base, unsigned int mark)
+{
+    size_t lo = 0, hi = sizeof(compositions) / sizeof(compositions[0]);
+    unsigned int key = (mark << 8) | (unsigned char)base;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        unsigned int k = ((unsigned int)compositions[mid].mark << 8) | (unsigned char)compositions[mid].base;
+        if (k == key) return compositions[mid].composed;
+        if (k < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int is_alpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static char to_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+static char to_upper(char c)
+{
+    return c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c;
+}
+
+int id3_normalize_parse(const char *spec, unsigned int *ops)
+{
+    static const struct { const char *name; unsigned int flags; } passes[] =
+    {
+        { "strip", ID3_NORM_STRIP }, { "nfc", ID3_NORM_NFC }, { "trim", ID3_NORM_TRIM },
+        { "collapse", ID3_NORM_COLLAPSE }, { "lower", ID3_NORM_LOWER },
+        { "upper", ID3_NORM_UPPER }, { "title", ID3_NORM_TITLE },
+        { "all", ID3_NORM_STRIP | ID3_NORM_NFC | ID3_NORM_TRIM | ID3_NORM_COLLAPSE },
+    };
+    *ops = 0;
+    while (*spec)
+    {
+        size_t len = strcspn(spec, ",");
+        size_t i;
+        for (i = 0; i < sizeof(passes) / sizeof(passes[0]); i++)
+        {
+            if (strlen(passes[i].name) == len && strncmp(spec, passes[i].name, len) == 0) break;
+        }
+        if (i == sizeof(passes) / sizeof(passes[0]))
+        {
+            fprintf(stderr, "Error: Unknown normalization '%.*s'.\n", (int)len, spec);
+            return -1;
+        }
+        *ops |= passes[i].flags;
+        spec += len;
+        if (*spec == ',') spec++;
+    }
+    unsigned int casing = *ops & (ID3_NORM_LOWER | ID3_NORM_UPPER | ID3_NORM_TITLE);
+    if (casing & (casing - 1))
+    {
+        display_error("Only one of lower, upper and title may be given.");
+        return -1;
+    }
+    if (*ops == 0)
+    {
+        display_error("No normalization selected.");
+        return -1;
+    }
+    return 0;
+}
+
+size_t id3_normalize_value(const char *in, size_t len, char *out, unsigned int ops)
+{
+    size_t n = 0;
+
+    // ASCII has no BOM or combining marks: stripping is a bulk copy and composition is a no-op.
+    if (is_ascii(in, len))
+    {
+        if (ops & ID3_NORM_STRIP) n = strip_ascii(in, len, out);
+        else
+        {
+            memcpy(out, in, len);
+            n = len;
+        }
+        if (!(ops & ~(ID3_NORM_STRIP | ID3_NORM_NFC))) return n;
+    }
+    else
+    {
+        // Strip and compose in one pass from in to out.
+        for (size_t i = 0; i < len; i++)
+        {
+            unsigned char c = (unsigned char)in[i];
+            if (ops & ID3_NORM_STRIP)
+            {
+                if (c < 0x20 && c != '\t') continue;
+                if (c == 0x7F) continue;
+                if (i + 2 < len && c == 0xEF && (unsigned char)in[i + 1] == 0xBB &&
+                    (unsigned char)in[i + 2] == 0xBF)
+                {
+                    i += 2;
+                    continue;
+                }
+            }
+            // Combining marks U+0300..U+036F are encoded as CC 80..CD AF.
+            if ((ops & ID3_NORM_NFC) && (c == 0xCC || c == 0xCD) && i + 1 < len && n > 0)
+            {
+                unsigned int mark = ((c & 0x1F) << 6) | ((unsigned char)in[i + 1] & 0x3F);
+                unsigned int composed = is_alpha(out[n - 1]) ? compose(out[n - 1], mark) : 0;
+                if (composed)
+                {
+                    out[n - 1] = (char)(0xC0 | (composed >> 6));
+                    out[n++] = (char)(0x80 | (composed & 0x3F));
+                    i++;
+                    continue;
+                }
+            }
+            out[n++] = (char)c;
+        }
+    }
+
+    // Whitespace passes work in place on out.
+    if (ops & (ID3_NORM_TRIM | ID3_NORM_COLLAPSE))
+    {
+        size_t start = 0;
+        if (ops & ID3_NORM_TRIM)
+        {
+            while (start < n && is_space(out[start])) start++;
+            while (n > start && is_space(out[n - 1])) n--;
+        }
+        size_t w = 0;
+        for (size_t r = start; r < n; r++)
+        {
+            if ((ops & ID3_NORM_COLLAPSE) && is_space(out[r]))
+            {
+                if (w > 0 && out[w - 1] == ' ') continue;
+                out[w++] = ' ';
+                continue;
+            }
+            out[w++] = out[r];
+        }
+        n = w;
+    }
+
+    if (ops & ID3_NORM_LOWER)
+    {
+        for (size_t i = 0; i < n; i++) out[i] = to_lower(out[i]);
+    }
+    else if (ops & ID3_NORM_UPPER)
+    {
+        for (size_t i = 0; i < n; i++) out[i] = to_upper(out[i]);
+    }
+    else if (ops & ID3_NORM_TITLE)
+    {
+        int word_start = 1;
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = word_start ? to_upper(out[i]) : to_lower(out[i]);
+            // Letters, digits, apostrophes and non-ASCII bytes continue a word.
+            word_start = !(is_alpha(out[i]) || (out[i] >= '0' && out[i] <= '9') ||
+                           out[i] == '\'' || ((unsigned char)out[i] & 0x80));
+        }
+    }
+    return n;
+}
+
+unsigned int id3_normalize_tag(TagData *data, unsigned int ops)
+{
+    unsigned int changed = 0;
+    char local[256];
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        const char *value = tag_get(data, (TagField)i);
+        if (!value) continue;
+        size_t len = tag_length(data, (TagField)i);
+        char *out = len <= sizeof(local) ? local : (char *)malloc(len);
+        if (!out) continue;
+        size_t n = id3_normalize_value(value, len, out, ops);
+        if ((n != len || memcmp(out, value, n) != 0) &&
+            tag_set_n(data, (TagField)i, out, n) == 0)
+        {
+            changed |= 1u << i;
+        }
+        if (out != local) free(out);
+    }
+    return changed;
+}
+
+/**
+ * @brief Context of the edit normalizing one file.
+ */
+typedef struct 
+{
+    unsigned int ops;
+    int changed;
+} NormalizeEdit;
+
+static int apply_normalize(TagData *data, void *ctx)
+{
+    NormalizeEdit *edit = (NormalizeEdit *)ctx;
+    edit->changed = id3_normalize_tag(data, edit->ops) != 0;
+    return 0;
+}
+
+static int normalize_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    NormalizeJob *job = (NormalizeJob *)ctx;
+    const char *path = job->files->paths[index];
+    NormalizeEdit edit;
+    edit.ops = job->ops;
+    edit.changed = 0;
+    // Only files with at least one changed value are written.
+    if (id3_edit_file_pooled(pool, path, apply_normalize, &edit) != 0)
+    {
+        fprintf(stderr, "Error: Failed to normalize %s\n", path);
+        return -1;
+    }
+    if (edit.changed) atomic_fetch_add(&job->modified, 1);
+    return 0;
+}
+
+long id3_normalize_files(const Id3PathList *files, unsigned int ops, int jobs, size_t *modified)
+{
+    NormalizeJob job;
+    job.files = files;
+    job.ops = ops;
+    atomic_init(&job.modified, 0);
+    long failures = id3_batch_run(files->count, jobs, normalize_one, &job);
+    *modified = atomic_load(&job.modified);
+    return failures;
+}
@@ -0,0 +1,63 @@
+#ifndef ID3_NORMALIZE_H
+#define ID3_NORMALIZE_H
+
+#include <stddef.h>
+#include "id3_scan.h"
+#include "id3_utils.h"
+
+#define ID3_NORM_STRIP    0x01 /**< Remove control bytes, stray encoding bytes and a UTF-8 BOM */
+#define ID3_NORM_NFC      0x02 /**< Compose Latin letter + combining mark sequences (NFC) */
+#define ID3_NORM_TRIM     0x04 /**< Remove leading and trailing whitespace */
+#define ID3_NORM_COLLAPSE 0x08 /**< Replace internal runs of whitespace with one space */
+#define ID3_NORM_LOWER    0x10 /**< Lowercase ASCII letters */
+#define ID3_NORM_UPPER    0x20 /**< Uppercase ASCII letters */
+#define ID3_NORM_TITLE    0x40 /**< Capitalize the first letter of each word, lowercase the rest */
+
+/**
+ * @brief Parses a comma-separated list of normalization passes.
+ *
+ * Recognized names are strip, nfc, trim, collapse, lower, upper and title;
+ * "all" selects strip, nfc, trim and collapse. At most one casing may be given.
+ *
+ * @param spec List such as "trim,collapse,title".
+ * @param ops  Output: bitmask of ID3_NORM_* flags.
+ * @return 0 on success, -1 if the list is invalid (an error has been displayed).
+ */
+int id3_normalize_parse(const char *spec, unsigned int *ops);
+
+/**
+ * @brief Normalizes one value.
+ *
+ * None of the passes lengthen a value, so @p out needs at most @p len bytes.
+ * Pure-ASCII input is detected with a vectorized scan; it is then copied (or
+ * stripped) in bulk runs and skips the per-byte Unicode pass.
+ *
+ * @param in  Input bytes.
+ * @param len Number of input bytes.
+ * @param out Output buffer of at least @p len bytes (may not overlap @p in).
+ * @param ops Bitmask of ID3_NORM_* passes.
+ * @return Length of the normalized value.
+ */
+size_t id3_normalize_value(const char *in, size_t len, char *out, unsigned int ops);
+
+/**
+ * @brief Normalizes every field of a tag.
+ *
+ * @param data Tag to normalize in place.
+ * @param ops  Bitmask of ID3_NORM_* passes.
+ * @return Bit (1u << TagField) for every field whose value changed.
+ */
+unsigned int id3_normalize_tag(TagData *data, unsigned int ops);
+
+/**
+ * @brief Normalizes the tags of many files, writing only files whose values change.
+ *
+ * @param files    Files to normalize.
+ * @param ops      Bitmask of ID3_NORM_* passes.
+ * @param jobs     Number of worker threads (0 selects the default).
+ * @param modified Output: number of files that were rewritten.
+ * @return Number of files that could not be processed, or -1 on setup failure.
+ */
+long id3_normalize_files(const Id3PathList *files, unsigned int ops, int jobs, size_t *modified);
+
+#endif // ID3_NORMALIZE_H
@@ -0,0 +1,115 @@
+/**
+ * @file id3_parser.c
+ * @brief Bounded, allocation-safe parser for ID3v2.3/2.4 tags held in memory.
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include "id3_parser.h"
+
+#define ID3_FLAG_UNSYNCHRONISATION 0x80
+#define ID3_FLAG_EXTENDED_HEADER 0x40
+
+/**
+ * @brief Returns non-zero if the four bytes form a valid frame ID ([A-Z0-9]{4}).
+ */
+static int is_valid_frame_id(const unsigned char *id)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (!((id[i] >= 'A' && id[i] <= 'Z') || (id[i] >= '0' && id[i] <= '9')))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+Id3ParseStatus id3_parse_header(const unsigned char *buf, size_t len, Id3Header *hdr)
+{
+    if (len < ID3_HEADER_SIZE || memcmp(buf, "ID3", 3) != 0)
+    {
+        return ID3_PARSE_NO_TAG;
+    }
+    // Only v2.3 and v2.4 share the 10-byte frame header layout handled here.
+    if ((buf[3] != 3 && buf[3] != 4) || buf[4] == 0xFF)
+    {
+        return ID3_PARSE_BAD_HEADER;
+    }
+    // Sync-safe size bytes never have their top bit set.
+    if ((buf[6] | buf[7] | buf[8] | buf[9]) & 0x80)
+    {
+        return ID3_PARSE_BAD_HEADER;
+    }
+    hdr->major = buf[3];
+    hdr->revision = buf[4];
+    hdr->flags = buf[5];
+    hdr->tag_size = id3_syncsafe_decode(&buf[6]);
+    return ID3_PARSE_OK;
+}
+
+Id3ParseStatus id3_parse_frames(const Id3Header *hdr, const unsigned char *body, size_t len, TagData *data)
+{
+    if (len > hdr->tag_size) len = hdr->tag_size;
+    size_t pos = 0;
+
+    // Skip the extended header if present; its size is untrusted like any other.
+    if (hdr->flags & ID3_FLAG_EXTENDED_HEADER)
+    {
+        if (len < 4) return ID3_PARSE_TRUNCATED;
+        size_t ext = hdr->major == 4 ? id3_syncsafe_decode(body) : (size_t)id3_be32_decode(body) + 4;
+        if (ext > len) return ID3_PARSE_TRUNCATED;
+        pos = ext;
+    }
+
+    while (len - pos >= FRAME_HEADER_SIZE)
+    {
+        const unsigned char *frame = body + pos;
+
+        // Padding, or bytes that cannot start a frame, end the frame list.
+        if (frame[0] == 0 || !is_valid_frame_id(frame)) break;
+
+        size_t size = hdr->major == 4 ? id3_syncsafe_decode(&frame[4]) : id3_be32_decode(&frame[4]);
+
+        // The one bounds check per frame: the content must fit in what is left.
+        if (size > len - pos - FRAME_HEADER_SIZE) return ID3_PARSE_TRUNCATED;
+
+        // Known text frames keep their content up to the first NUL byte.
+        int field = tag_field_from_frame_id(frame);
+        if (field >= 0)
+        {
+            const char *content = (const char *)frame + FRAME_HEADER_SIZE;
+            size_t value_len = strnlen(content, size);
+            if (tag_set_n(data, (TagField)field, content, value_len) != 0)
+            {
+                return ID3_PARSE_NO_MEMORY;
+            }
+            // Remember where the value lies in the file, unless the bytes on disk are
+            // transformed (unsynchronised, compressed, encrypted, ...) and cannot be patched.
+            int patchable = !(hdr->flags & ID3_FLAG_UNSYNCHRONISATION) && frame[9] == 0;
+            data->frame_offset[field] = patchable ? (unsigned int)(ID3_HEADER_SIZE + pos + FRAME_HEADER_SIZE) : 0;
+            data->frame_length[field] = (unsigned int)value_len;
+        }
+        else if (memcmp(frame, "APIC", 4) == 0)
+        {
+            data->art_bytes += size;
+        }
+
+        pos += FRAME_HEADER_SIZE + size;
+    }
+    return ID3_PARSE_OK;
+}
+
+const char *id3_parse_status_string(Id3ParseStatus status)
+{
+    switch (status)
+    {
+        case ID3_PARSE_OK:         return "OK";
+        case ID3_PARSE_NO_TAG:     return "No ID3 tag found.";
+        case ID3_PARSE_BAD_HEADER: return "Unsupported or malformed ID3 header.";
+        case ID3_PARSE_TRUNCATED:  return "ID3 frame size exceeds the tag size.";
+        case ID3_PARSE_NO_MEMORY:  return "Memory allocation failed.";
+    }
+    return "Unknown parse error.";
+}
@@ -0,0 +1,67 @@
+#ifndef ID3_PARSER_H
+#define ID3_PARSER_H
+
+#include <stddef.h>
+#include "id3_utils.h"
+
+/**
+ * @brief Result codes returned by the bounded ID3 parser.
+ */
+typedef enum 
+{
+    ID3_PARSE_OK = 0,      /**< Tag parsed successfully */
+    ID3_PARSE_NO_TAG,      /**< Buffer does not start with "ID3" */
+    ID3_PARSE_BAD_HEADER,  /**< Unsupported version, invalid size bytes or flags */
+    ID3_PARSE_TRUNCATED,   /**< A length runs past the end of the available bytes */
+    ID3_PARSE_NO_MEMORY    /**< Allocation of a field value failed */
+} Id3ParseStatus;
+
+/**
+ * @brief Decoded 10-byte ID3v2 tag header.
+ */
+typedef struct 
+{
+    unsigned char major;    /**< Major version (3 or 4) */
+    unsigned char revision; /**< Revision number */
+    unsigned char flags;    /**< Header flags byte */
+    unsigned int tag_size;  /**< Size of the tag excluding the 10-byte header */
+} Id3Header;
+
+/**
+ * @brief Validates and decodes an ID3v2 tag header.
+ *
+ * @param buf Pointer to the first bytes of the file.
+ * @param len Number of bytes available in @p buf.
+ * @param hdr Output for the decoded header.
+ * @return ID3_PARSE_OK on success, or the reason the header was rejected.
+ */
+Id3ParseStatus id3_parse_header(const unsigned char *buf, size_t len, Id3Header *hdr);
+
+/**
+ * @brief Parses the frames of a tag that has been read into memory.
+ *
+ * Every length read from the input is checked against the bytes that remain in
+ * @p body with a single comparison per frame, so hostile sizes are rejected in
+ * constant time and never drive an allocation larger than the input itself.
+ * Known text frames are stored in @p data, together with the file offset of
+ * their content (assuming @p body directly follows the 10-byte header at the
+ * start of the file). The sizes of picture frames are added up in
+ * data->art_bytes; all other frames are skipped.
+ *
+ * @param hdr  Header previously returned by id3_parse_header().
+ * @param body Tag bytes following the header (hdr->tag_size bytes or fewer).
+ * @param len  Number of bytes available in @p body.
+ * @param data TagData structure receiving the decoded fields.
+ * @return ID3_PARSE_OK on success, or the reason the tag was rejected.
+ */
+Id3ParseStatus id3_parse_frames(const Id3Header *hdr, const unsigned char *body, size_t len, TagData *data);
+
+/**
+ * @brief Returns a human-readable description of a parse status.
+ *
+ * @param status Status returned by one of the parser functions.
+ * @return Static string describing @p status.
+ */
+const char *id3_parse_status_string(Id3ParseStatus status);
+
+#endif // ID3_PARSER_H
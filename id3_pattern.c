@@ -0,0 +1,171 @@
+/**
+ * @file id3_pattern.c
+ * @brief Compiled filename patterns for deriving tags from paths and paths from tags.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_pattern.h"
+#include "error_handling.h"
+
+/**
+ * @brief Appends a token to a pattern being compiled.
+ */
+static int add_token(Id3Pattern *out, int field, const char *text, size_t len)
+{
+    Id3PatternToken *tokens = (Id3PatternToken *)realloc(out->tokens, (out->count + 1) * sizeof(*tokens));
+    if (!tokens) return -1;
+    out->tokens = tokens;
+    Id3PatternToken *t = &out->tokens[out->count++];
+    t->field = field;
+    t->text = NULL;
+    t->len = len;
+    if (field < 0)
+    {
+        t->text = (char *)malloc(len + 1);
+        if (!t->text) return -1;
+        memcpy(t->text, text, len);
+        t->text[len] = '\0';
+    }
+    return 0;
+}
+
+int id3_pattern_compile(const char *pattern, Id3Pattern *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->components = 1;
+    const char *p = pattern;
+    while (*p)
+    {
+        if (*p != '%')
+        {
+            size_t len = strcspn(p, "%");
+            for (size_t i = 0; i < len; i++)
+            {
+                if (p[i] == '/') out->components++;
+            }
+            if (add_token(out, -1, p, len) != 0) goto fail_alloc;
+            p += len;
+            continue;
+        }
+        const char *end = strchr(p + 1, '%');
+        char name[32];
+        size_t len = end ? (size_t)(end - p - 1) : 0;
+        if (!end || len == 0 || len >= sizeof(name))
+        {
+            display_error("Unterminated or empty placeholder in pattern.");
+            goto fail;
+        }
+        memcpy(name, p + 1, len);
+        name[len] = '\0';
+        int field = tag_field_from_name(name);
+        if (field < 0)
+        {
+            fprintf(stderr, "Error: Unknown field '%s' in pattern.\n", name);
+            goto fail;
+        }
+        if (out->count > 0 && out->tokens[out->count - 1].field >= 0)
+        {
+            display_error("Placeholders in a pattern must be separated by literal text.");
+            goto fail;
+        }
+        if (add_token(out, field, NULL, 0) != 0) goto fail_alloc;
+        p = end + 1;
+    }
+    return 0;
+
+fail_alloc:
+    display_error("Memory allocation failed.");
+fail:
+    id3_pattern_free(out);
+    return -1;
+}
+
+int id3_pattern_match(const Id3Pattern *pattern, const char *path, TagData *values, unsigned int *mask)
+{
+    // Start at the path component the pattern's first component lines up with.
+    const char *s = path + strlen(path);
+    int slashes = 0;
+    while (s > path && slashes < pattern->components)
+    {
+        if (s[-1] == '/') slashes++;
+        if (slashes < pattern->components) s--;
+    }
+    const char *end = path + strlen(path);
+
+    *mask = 0;
+    for (size_t i = 0; i < pattern->count; i++)
+    {
+        const Id3PatternToken *t = &pattern->tokens[i];
+        if (t->field < 0)
+        {
+            if ((size_t)(end - s) < t->len || memcmp(s, t->text, t->len) != 0) return -1;
+            s += t->len;
+            continue;
+        }
+        // A placeholder runs up to the next literal: its last occurrence if that literal
+        // ends the pattern, otherwise its first one. Values never span a '/'.
+        const char *value_end;
+        if (i + 1 == pattern->count)
+        {
+            value_end = end;
+        }
+        else
+        {
+            const Id3PatternToken *next = &pattern->tokens[i + 1];
+            if (i + 2 == pattern->count)
+            {
+                value_end = end - next->len;
+                if (value_end < s || memcmp(value_end, next->text, next->len) != 0) return -1;
+            }
+            else
+            {
+                value_end = NULL;
+                for (const char *q = s; (size_t)(end - q) >= next->len; q++)
+                {
+                    if (memcmp(q, next->text, next->len) == 0) { value_end = q; break; }
+                    if (*q == '/') break;
+                }
+                if (!value_end) return -1;
+            }
+        }
+        if (value_end == s || memchr(s, '/', (size_t)(value_end - s))) return -1;
+        if (tag_set_n(values, (TagField)t->field, s, (size_t)(value_end - s)) != 0) return -1;
+        *mask |= 1u << t->field;
+        s = value_end;
+    }
+    return s == end ? 0 : -1;
+}
+
+int id3_pattern_format(const Id3Pattern *pattern, const TagData *data, char *out, size_t size)
+{
+    size_t o = 0;
+    for (size_t i = 0; i < pattern->count; i++)
+    {
+        const Id3PatternToken *t = &pattern->tokens[i];
+        const char *text = t->field < 0 ? t->text : tag_get(data, (TagField)t->field);
+        size_t len = t->field < 0 ? t->len : tag_length(data, (TagField)t->field);
+        if (!text || len == 0 || o + len >= size) return -1;
+        for (size_t k = 0; k < len; k++)
+        {
+            char c = text[k];
+            if (t->field >= 0 && (c == '/' || (unsigned char)c < 0x20)) c = '_';
+            out[o++] = c;
+        }
+        // A value of "." or ".." would change which directory the result lands in.
+        if (t->field >= 0 && len <= 2 && strspn(out + o - len, ".") == len) out[o - 1] = '_';
+    }
+    out[o] = '\0';
+    return 0;
+}
+
+void id3_pattern_free(Id3Pattern *pattern)
+{
+    for (size_t i = 0; i < pattern->count; i++)
+    {
+        free(pattern->tokens[i].text);
+    }
+    free(pattern->tokens);
+    memset(pattern, 0, sizeof(*pattern));
+}
@@ -0,0 +1,72 @@
+#ifndef ID3_PATTERN_H
+#define ID3_PATTERN_H
+
+#include <stddef.h>
+#include "id3_utils.h"
+
+/**
+ * @brief One piece of a compiled pattern: literal text or a field placeholder.
+ */
+typedef struct 
+{
+    int field;        /**< TagField for a %field% placeholder, or -1 for literal text */
+    char *text;       /**< Literal text (NULL for placeholders) */
+    size_t len;       /**< Length of text */
+} Id3PatternToken;
+
+/**
+ * @brief A filename pattern such as "%artist%/%album%/%track% - %title%.mp3".
+ *
+ * Patterns are compiled once and then matched or expanded for every file.
+ * Two placeholders may not be adjacent, so each placeholder's value is
+ * delimited by the literal that follows it and matching never backtracks.
+ */
+typedef struct 
+{
+    Id3PatternToken *tokens; /**< Tokens in pattern order */
+    size_t count;            /**< Number of tokens */
+    int components;          /**< Number of path components the pattern spans */
+} Id3Pattern;
+
+/**
+ * @brief Compiles a pattern.
+ *
+ * @param pattern Pattern text; placeholders are field names between '%' signs.
+ * @param out     Compiled pattern.
+ * @return 0 on success, -1 if the pattern is invalid (an error has been displayed).
+ */
+int id3_pattern_compile(const char *pattern, Id3Pattern *out);
+
+/**
+ * @brief Extracts field values from the trailing components of a path.
+ *
+ * @param pattern Compiled pattern.
+ * @param path    Path to match; only its last pattern->components components are used.
+ * @param values  TagData receiving the extracted values.
+ * @param mask    Output: bit (1u << TagField) for every field extracted.
+ * @return 0 if the path matches, -1 otherwise.
+ */
+int id3_pattern_match(const Id3Pattern *pattern, const char *path, TagData *values, unsigned int *mask);
+
+/**
+ * @brief Expands a pattern with the values of a tag.
+ *
+ * Characters that cannot appear in a path component ('/' and control characters)
+ * are replaced with '_' in substituted values.
+ *
+ * @param pattern Compiled pattern.
+ * @param data    Tag supplying the values.
+ * @param out     Output buffer.
+ * @param size    Size of @p out.
+ * @return 0 on success, -1 if a field is unset or the result does not fit.
+ */
+int id3_pattern_format(const Id3Pattern *pattern, const TagData *data, char *out, size_t size);
+
+/**
+ * @brief Frees a compiled pattern.
+ *
+ * @param pattern Pattern to free.
+ */
+void id3_pattern_free(Id3Pattern *pattern);
+
+#endif // ID3_PATTERN_H
@@ -0,0 +1,374 @@
+/**
+ * @file id3_playlist.c
+ * @brief Tag queries and extended M3U playlist generation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "id3_playlist.h"
+#include "id3_batch.h"
+#include "id3_index.h"
+#include "id3_mpeg.h"
+#include "id3_reader.h"
+#include "error_handling.h"
+
+#define PLAYLIST_CHUNK 1024 /**< Files read in parallel before their entries are written */
+
+/**
+ * @brief State of one chunk of a playlist scan.
+ */
+typedef struct 
+{
+    const Id3Query *query;    /**< Query files must match */
+    const Id3PathList *files; /**< All files being scanned */
+    size_t first;             /**< Index of the chunk's first file */
+    TagData **slots;          /**< Tags of matching files of the chunk */
+    int *matched;             /**< Whether each file of the chunk matched */
+} PlaylistChunk;
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * @brief Parses a number covering all of @p s; returns non-zero on success.
+ */
+static int parse_number(const char *s, double *out)
+{
+    char *end;
+    if (!*s) return 0;
+    *out = strtod(s, &end);
+    return *end == '\0';
+}
+
+/**
+ * @brief Case-insensitive (ASCII) substring search.
+ */
+static int contains_nocase(const char *haystack, const char *needle)
+{
+    size_t n = strlen(needle);
+    for (; *haystack; haystack++)
+    {
+        if (strncasecmp(haystack, needle, n) == 0) return 1;
+    }
+    return n == 0;
+}
+
+/**
+ * @brief Appends one predicate to a query.
+ */
+static int add_predicate(Id3Query *query, int field, Id3QueryOp op, const char *value, size_t len)
+{
+    Id3Predicate *preds = (Id3Predicate *)realloc(query->preds, (query->count + 1) * sizeof(Id3Predicate));
+    if (!preds) return -1;
+    query->preds = preds;
+    Id3Predicate *p = &preds[query->count];
+    p->value = (char *)malloc(len + 1);
+    if (!p->value) return -1;
+    memcpy(p->value, value, len);
+    p->value[len] = '\0';
+    p->field = field;
+    p->op = op;
+    p->numeric = parse_number(p->value, &p->number);
+    query->count++;
+    return 0;
+}
+
+int id3_query_compile(const char *text, Id3Query *query)
+{
+    static const struct { const char *text; Id3QueryOp op; } ops[] =
+    {
+        { "!=", ID3_QUERY_NE }, { "<=", ID3_QUERY_LE }, { ">=", ID3_QUERY_GE },
+        { "=", ID3_QUERY_EQ }, { "~", ID3_QUERY_MATCH }, { "<", ID3_QUERY_LT }, { ">", ID3_QUERY_GT },
+    };
+    const char *p = text;
+    char *value = (char *)malloc(strlen(text) + 1);
+    query->preds = NULL;
+    query->count = 0;
+    if (!value)
+    {
+        display_error("Memory allocation failed.");
+        return -1;
+    }
+
+    while (is_space(*p)) p++;
+    while (*p)
+    {
+        // Field name
+        char name[32];
+        size_t n = 0;
+        while ((*p >= 'a' && *p <= 'z') || *p == '_')
+        {
+            if (n + 1 < sizeof(name)) name[n++] = *p;
+            p++;
+        }
+        name[n] = '\0';
+        int field = strcmp(name, "duration") == 0 ? ID3_QUERY_DURATION : tag_field_from_name(name);
+        if (field < 0)
+        {
+            fprintf(stderr, "Error: Unknown query field '%s'.\n", name);
+            goto fail;
+        }
+
+        // Operator
+        while (is_space(*p)) p++;
+        size_t k;
+        for (k = 0; k < sizeof(ops) / sizeof(ops[0]); k++)
+        {
+            if (strncmp(p, ops[k].text, strlen(ops[k].text)) == 0) break;
+        }
+        if (k == sizeof(ops) / sizeof(ops[0]))
+        {
+            fprintf(stderr, "Error: Expected an operator after '%s' in query.\n", name);
+            goto fail;
+        }
+        p += strlen(ops[k].text);
+
+        // Value: a double-quoted string (with \" and \\ escapes) or a bare word
+        while (is_space(*p)) p++;
+        size_t len = 0;
+        if (*p == '"')
+        {
+            for (p++; *p && *p != '"'; p++)
+            {
+                if (*p == '\\' && (p[1] == '"' || p[1] == '\\')) p++;
+                value[len++] = *p;
+            }
+            if (*p != '"')
+            {
+                display_error("Unterminated string in query.");
+                goto fail;
+            }
+            p++;
+        }
+        else
+        {
+            while (*p && !is_space(*p)) value[len++] = *p++;
+            if (len == 0)
+            {
+                fprintf(stderr, "Error: Expected a value after '%s' in query.\n", name);
+                goto fail;
+            }
+        }
+        if (add_predicate(query, field, ops[k].op, value, len) != 0)
+        {
+            display_error("Memory allocation failed.");
+            goto fail;
+        }
+        if (field == ID3_QUERY_DURATION && (ops[k].op == ID3_QUERY_MATCH || !query->preds[query->count - 1].numeric))
+        {
+            display_error("Duration must be compared with a number of seconds.");
+            goto fail;
+        }
+
+        // Conjunction
+        while (is_space(*p)) p++;
+        if (!*p) break;
+        if (strncmp(p, "&&", 2) == 0) p += 2;
+        else if (strncasecmp(p, "and", 3) == 0 && is_space(p[3])) p += 3;
+        else
+        {
+            fprintf(stderr, "Error: Expected 'and' in query at \"%s\".\n", p);
+            goto fail;
+        }
+        while (is_space(*p)) p++;
+    }
+    free(value);
+    return 0;
+
+fail:
+    free(value);
+    id3_query_free(query);
+    return -1;
+}
+
+/**
+ * @brief Tests one predicate.
+ */
+static int predicate_match(const Id3Predicate *p, const TagData *data)
+{
+    int cmp;
+    if (p->field == ID3_QUERY_DURATION)
+    {
+        if (data->duration < 0) return p->op == ID3_QUERY_NE;
+        cmp = data->duration < p->number ? -1 : data->duration > p->number;
+    }
+    else
+    {
+        const char *v = tag_get(data, (TagField)p->field);
+        if (!v) v = "";
+        if (p->op == ID3_QUERY_EQ) return strcasecmp(v, p->value) == 0;
+        if (p->op == ID3_QUERY_NE) return strcasecmp(v, p->value) != 0;
+        if (p->op == ID3_QUERY_MATCH) return contains_nocase(v, p->value);
+        // Ordering is numeric when both sides start with a number, e.g. year "1999-05-01".
+        char *end;
+        double number = strtod(v, &end);
+        if (p->numeric && end != v) cmp = number < p->number ? -1 : number > p->number;
+        else cmp = strcmp(v, p->value);
+    }
+    switch (p->op)
+    {
+        case ID3_QUERY_EQ: return cmp == 0;
+        case ID3_QUERY_NE: return cmp != 0;
+        case ID3_QUERY_LT: return cmp < 0;
+        case ID3_QUERY_LE: return cmp <= 0;
+        case ID3_QUERY_GT: return cmp > 0;
+        case ID3_QUERY_GE: return cmp >= 0;
+        default:           return 0;
+    }
+}
+
+int id3_query_match(const Id3Query *query, const TagData *data)
+{
+    for (size_t i = 0; i < query->count; i++)
+    {
+        if (!predicate_match(&query->preds[i], data)) return 0;
+    }
+    return 1;
+}
+
+void id3_query_free(Id3Query *query)
+{
+    for (size_t i = 0; i < query->count; i++)
+    {
+        free(query->preds[i].value);
+    }
+    free(query->preds);
+    query->preds = NULL;
+    query->count = 0;
+}
+
+/**
+ * @brief Writes the #EXTINF line and path of one playlist entry.
+ */
+static void write_entry(FILE *out, const char *path, const TagData *data)
+{
+    const char *artist = tag_get(data, TAG_ARTIST);
+    const char *title = tag_get(data, TAG_TITLE);
+    if (!title)
+    {
+        const char *slash = strrchr(path, '/');
+        title = slash ? slash + 1 : path;
+    }
+    fprintf(out, "#EXTINF:%d,", data->duration);
+    // Line breaks in a value would end the directive early.
+    for (const char *s = artist; s && *s; s++) putc(*s == '\n' || *s == '\r' ? ' ' : *s, out);
+    if (artist) fputs(" - ", out);
+    for (const char *s = title; *s; s++) putc(*s == '\n' || *s == '\r' ? ' ' : *s, out);
+    fprintf(out, "\n%s\n", path);
+}
+
+static int playlist_read_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    PlaylistChunk *chunk = (PlaylistChunk *)ctx;
+    const char *path = chunk->files->paths[chunk->first + index];
+    TagData *data = read_id3_tags_pooled(pool, path);
+    chunk->matched[index] = 0;
+    if (!data)
+    {
+        fprintf(stderr, "Error: Cannot read tags of %s\n", path);
+        return -1;
+    }
+    data->duration = id3_file_duration(path);
+    int ret = 0;
+    if (id3_query_match(chunk->query, data))
+    {
+        // Pooled TagData belongs to this worker, so keep a copy in the chunk's slot.
+        ret = copy_tag_data(chunk->slots[index], data);
+        chunk->matched[index] = ret == 0;
+    }
+    if (pool) id3_pool_release_tag(pool, data);
+    else free_tag_data(data);
+    return ret;
+}
+
+/**
+ * @brief Scans files chunk by chunk and writes the matching ones in path order.
+ */
+static long scan_files(FILE *out, const Id3Query *query, const Id3PathList *files, int jobs,
+                       size_t *entries)
+{
+    PlaylistChunk chunk;
+    chunk.query = query;
+    chunk.files = files;
+    chunk.slots = (TagData **)calloc(PLAYLIST_CHUNK, sizeof(TagData *));
+    chunk.matched = (int *)calloc(PLAYLIST_CHUNK, sizeof(int));
+    long failures = chunk.slots && chunk.matched ? 0 : -1;
+    for (size_t i = 0; failures == 0 && i < PLAYLIST_CHUNK; i++)
+    {
+        chunk.slots[i] = create_tag_data();
+        if (!chunk.slots[i]) failures = -1;
+    }
+
+    for (size_t first = 0; failures >= 0 && first < files->count; first += PLAYLIST_CHUNK)
+    {
+        size_t n = files->count - first < PLAYLIST_CHUNK ? files->count - first : PLAYLIST_CHUNK;
+        chunk.first = first;
+        long f = id3_batch_run(n, jobs, playlist_read_one, &chunk);
+        if (f < 0)
+        {
+            failures = -1;
+            break;
+        }
+        failures += f;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!chunk.matched[i]) continue;
+            write_entry(out, files->paths[first + i], chunk.slots[i]);
+            (*entries)++;
+        }
+    }
+
+    for (size_t i = 0; chunk.slots && i < PLAYLIST_CHUNK; i++)
+    {
+        free_tag_data(chunk.slots[i]);
+    }
+    free(chunk.slots);
+    free(chunk.matched);
+    return failures;
+}
+
+/**
+ * @brief Evaluates the query against every row of an index.
+ */
+static long scan_index(FILE *out, const Id3Query *query, const char *index, size_t *entries)
+{
+    Id3IndexReader reader;
+    if (id3_index_open(&reader, index) != 0) return -1;
+    int status;
+    while ((status = id3_index_next(&reader)) == 1)
+    {
+        if (!id3_query_match(query, reader.record)) continue;
+        write_entry(out, reader.path, reader.record);
+        (*entries)++;
+    }
+    id3_index_close(&reader);
+    return status == 0 ? 0 : -1;
+}
+
+long id3_playlist_build(const char *out_path, const Id3Query *query, const Id3PathList *files,
+                        const char *index, int jobs, size_t *entries)
+{
+    FILE *out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!out)
+    {
+        display_error("Cannot create playlist file.");
+        return -1;
+    }
+    *entries = 0;
+    fputs("#EXTM3U\n", out);
+    long failures = index ? scan_index(out, query, index, entries)
+                          : scan_files(out, query, files, jobs, entries);
+    if (ferror(out)) failures = -1;
+    if (out == stdout) fflush(out);
+    else if (fclose(out) != 0) failures = -1;
+    if (failures < 0)
+    {
+        display_error("Failed to write playlist.");
+        return -1;
+    }
+    return failures;
+}
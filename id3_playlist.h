@@ -0,0 +1,93 @@
+#ifndef ID3_PLAYLIST_H
+#define ID3_PLAYLIST_H
+
+#include <stddef.h>
+#include "id3_scan.h"
+#include "id3_utils.h"
+
+#define ID3_QUERY_DURATION TAG_FIELD_COUNT /**< Pseudo-field: playing time in seconds */
+
+/**
+ * @brief Comparison made by one predicate.
+ */
+typedef enum 
+{
+    ID3_QUERY_EQ,    /**< "=": equal, ignoring ASCII case */
+    ID3_QUERY_NE,    /**< "!=": not equal, ignoring ASCII case */
+    ID3_QUERY_MATCH, /**< "~": contains, ignoring ASCII case */
+    ID3_QUERY_LT,    /**< "<" */
+    ID3_QUERY_LE,    /**< "<=" */
+    ID3_QUERY_GT,    /**< ">" */
+    ID3_QUERY_GE     /**< ">=" */
+} Id3QueryOp;
+
+/**
+ * @brief One "field op value" test.
+ */
+typedef struct 
+{
+    int field;         /**< TagField, or ID3_QUERY_DURATION */
+    Id3QueryOp op;     /**< Comparison */
+    char *value;       /**< Value to compare with */
+    int numeric;       /**< Non-zero if @c value is a number */
+    double number;     /**< Numeric value when @c numeric is set */
+} Id3Predicate;
+
+/**
+ * @brief A compiled query: every predicate must hold.
+ */
+typedef struct 
+{
+    Id3Predicate *preds;  /**< Predicates, all of which must match */
+    size_t count;         /**< Number of predicates */
+} Id3Query;
+
+/**
+ * @brief Compiles a query such as: genre = Rock and year >= 1990 and artist ~ "the b".
+ *
+ * Predicates are "field op value" joined by "and" or "&&"; fields are tag field
+ * names or "duration"; values containing spaces are double-quoted. Ordering
+ * comparisons are numeric when both sides start with a number and byte-wise
+ * otherwise. Unset fields compare as empty strings. An empty query matches
+ * every file.
+ *
+ * @param text  Query text.
+ * @param query Output query; free it with id3_query_free().
+ * @return 0 on success, -1 if the query is invalid (an error has been displayed).
+ */
+int id3_query_compile(const char *text, Id3Query *query);
+
+/**
+ * @brief Tests a tag against a query.
+ *
+ * @param query Compiled query.
+ * @param data  Tag to test; data->duration is used by duration predicates.
+ * @return Non-zero if every predicate holds.
+ */
+int id3_query_match(const Id3Query *query, const TagData *data);
+
+/**
+ * @brief Frees a compiled query.
+ *
+ * @param query Query to free.
+ */
+void id3_query_free(Id3Query *query);
+
+/**
+ * @brief Writes an extended M3U playlist of the files matching a query.
+ *
+ * With an index, the index alone is read and no MP3 file is opened. Otherwise
+ * the files are read in parallel, in fixed-size chunks written in path order.
+ *
+ * @param out_path Playlist to create ("-" for standard output).
+ * @param query    Compiled query.
+ * @param files    Files to scan, sorted by path; ignored when @p index is given.
+ * @param index    Index written by --index, or NULL to scan @p files.
+ * @param jobs     Number of worker threads (0 selects the default).
+ * @param entries  Output: number of playlist entries written.
+ * @return Number of files that could not be read, or -1 if the playlist could not be written.
+ */
+long id3_playlist_build(const char *out_path, const Id3Query *query, const Id3PathList *files,
+                        const char *index, int jobs, size_t *entries);
+
+#endif // ID3_PLAYLIST_H
@@ -0,0 +1,102 @@
+/**
+ * @file id3_pool.c
+ * @brief Reusable per-worker buffers and TagData objects for batch processing.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "id3_pool.h"
+
+#define POOL_MIN_BUFFER   4096 /**< Buffers never shrink below this size */
+#define POOL_WINDOW_SIZE  256  /**< Requests per high-water-mark window */
+
+/**
+ * @brief Grows @p buf to hold @p size bytes, rounding up to limit reallocations.
+ */
+static unsigned char *grow_buffer(unsigned char **buf, size_t *cap, size_t size)
+{
+    if (size <= *cap && *buf) return *buf;
+    size_t new_cap = *cap ? *cap : POOL_MIN_BUFFER;
+    while (new_cap < size) new_cap *= 2;
+    unsigned char *p = (unsigned char *)realloc(*buf, new_cap);
+    if (!p) return NULL;
+    *buf = p;
+    *cap = new_cap;
+    return p;
+}
+
+/**
+ * @brief Tracks the largest recent request and shrinks buffers that outgrew it.
+ *
+ * Once per window, a buffer more than four times larger than anything requested
+ * during that window is cut back, so one huge tag does not pin memory forever.
+ */
+static void note_request(Id3Pool *pool, size_t size)
+{
+    if (size > pool->recent_max) pool->recent_max = size;
+    if (++pool->window < POOL_WINDOW_SIZE) return;
+
+    size_t target = POOL_MIN_BUFFER;
+    while (target < pool->recent_max) target *= 2;
+    if (pool->io_cap > 4 * target)
+    {
+        unsigned char *p = (unsigned char *)realloc(pool->io_buf, target);
+        if (p) { pool->io_buf = p; pool->io_cap = target; }
+    }
+    if (pool->ser_cap > 4 * target)
+    {
+        unsigned char *p = (unsigned char *)realloc(pool->ser_buf, target);
+        if (p) { pool->ser_buf = p; pool->ser_cap = target; }
+    }
+    pool->recent_max = 0;
+    pool->window = 0;
+}
+
+Id3Pool *id3_pool_create(void)
+{
+    return (Id3Pool *)calloc(1, sizeof(Id3Pool));
+}
+
+void id3_pool_destroy(Id3Pool *pool)
+{
+    if (!pool) return;
+    free(pool->io_buf);
+    free(pool->ser_buf);
+    for (size_t i = 0; i < pool->free_count; i++)
+    {
+        free_tag_data(pool->free_tags[i]);
+    }
+    free(pool);
+}
+
+unsigned char *id3_pool_io_buffer(Id3Pool *pool, size_t size)
+{
+    note_request(pool, size);
+    return grow_buffer(&pool->io_buf, &pool->io_cap, size);
+}
+
+unsigned char *id3_pool_serializer_buffer(Id3Pool *pool, size_t size)
+{
+    return grow_buffer(&pool->ser_buf, &pool->ser_cap, size);
+}
+
+TagData *id3_pool_acquire_tag(Id3Pool *pool)
+{
+    if (pool->free_count > 0)
+    {
+        return pool->free_tags[--pool->free_count];
+    }
+    return create_tag_data();
+}
+
+void id3_pool_release_tag(Id3Pool *pool, TagData *data)
+{
+    if (!data) return;
+    if (pool->free_count == ID3_POOL_MAX_FREE_TAGS)
+    {
+        free_tag_data(data);
+        return;
+    }
+    clear_tag_data(data);
+    pool->free_tags[pool->free_count++] = data;
+}
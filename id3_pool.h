@@ -0,0 +1,77 @@
+#ifndef ID3_POOL_H
+#define ID3_POOL_H
+
+#include <stddef.h>
+#include "id3_utils.h"
+
+#define ID3_POOL_MAX_FREE_TAGS 16 /**< Recycled TagData objects kept per pool */
+
+/**
+ * @brief Per-worker cache of buffers and TagData objects reused across files.
+ *
+ * A pool is not thread-safe; each worker thread owns its own. Buffers grow to the
+ * largest tag seen recently and are shrunk again when a long run of smaller tags
+ * shows the extra capacity is no longer needed.
+ */
+typedef struct 
+{
+    unsigned char *io_buf;      /**< Buffer the raw tag is read into */
+    size_t io_cap;              /**< Capacity of io_buf */
+    unsigned char *ser_buf;     /**< Buffer new tags are serialized into */
+    size_t ser_cap;             /**< Capacity of ser_buf */
+    size_t recent_max;          /**< Largest request seen in the current window */
+    unsigned int window;        /**< Requests seen in the current window */
+    TagData *free_tags[ID3_POOL_MAX_FREE_TAGS]; /**< Recycled TagData objects */
+    size_t free_count;          /**< Number of entries in free_tags */
+    int worker;                 /**< Index of the batch worker that owns the pool, or 0 */
+} Id3Pool;
+
+/**
+ * @brief Creates an empty pool.
+ *
+ * @return Pointer to the new pool, or NULL if allocation fails.
+ */
+Id3Pool *id3_pool_create(void);
+
+/**
+ * @brief Frees a pool together with every buffer and TagData it holds.
+ *
+ * @param pool Pool to destroy (may be NULL).
+ */
+void id3_pool_destroy(Id3Pool *pool);
+
+/**
+ * @brief Returns the pool's I/O buffer, grown to at least @p size bytes.
+ *
+ * @param pool Pool owning the buffer.
+ * @param size Number of bytes required.
+ * @return Pointer to the buffer, or NULL if it could not be grown.
+ */
+unsigned char *id3_pool_io_buffer(Id3Pool *pool, size_t size);
+
+/**
+ * @brief Returns the pool's serializer buffer, grown to at least @p size bytes.
+ *
+ * @param pool Pool owning the buffer.
+ * @param size Number of bytes required.
+ * @return Pointer to the buffer, or NULL if it could not be grown.
+ */
+unsigned char *id3_pool_serializer_buffer(Id3Pool *pool, size_t size);
+
+/**
+ * @brief Hands out a cleared TagData, recycling a released one when available.
+ *
+ * @param pool Pool to take the TagData from.
+ * @return Pointer to an empty TagData, or NULL if allocation fails.
+ */
+TagData *id3_pool_acquire_tag(Id3Pool *pool);
+
+/**
+ * @brief Returns a TagData obtained from id3_pool_acquire_tag() to the pool.
+ *
+ * @param pool Pool the TagData is returned to.
+ * @param data TagData to recycle (may be NULL).
+ */
+void id3_pool_release_tag(Id3Pool *pool, TagData *data);
+
+#endif // ID3_POOL_H
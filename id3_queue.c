@@ -0,0 +1,242 @@
+/**
+ * @file id3_queue.c
+ * @brief Work queue shared by worker processes through lease files in a directory.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "id3_queue.h"
+#include "error_handling.h"
+
+#define QUEUE_PATH_MAX 4096   /**< Longest path of a file in the queue directory */
+
+/**
+ * @brief State of the chunk this worker is processing.
+ */
+typedef struct
+{
+    Id3Queue *queue;
+    size_t first;               /**< Job index of the chunk's first item */
+    Id3BatchFn fn;              /**< Caller's item function */
+    void *ctx;                  /**< Caller's context */
+    char lease_path[QUEUE_PATH_MAX]; /**< Lease held on the chunk */
+    time_t renewed;             /**< When the lease was last renewed */
+    pthread_mutex_t lock;       /**< Guards renewed */
+} QueueChunk;
+
+/**
+ * @brief Atomically creates @p path holding @p content.
+ *
+ * The content is written to a private file that is then hard-linked to its
+ * final name. link() fails if the name exists, also over NFS, where O_EXCL
+ * has historically been unreliable, and the file is complete once visible.
+ *
+ * @return 0 if the file was created, 1 if it already existed, -1 on error.
+ */
+static int publish_file(const char *path, const char *content)
+{
+    char host[64] = "localhost";
+    char tmp[QUEUE_PATH_MAX];
+    gethostname(host, sizeof(host) - 1);
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp.%s.%ld", path, host, (long)getpid()) >= (int)sizeof(tmp)) return -1;
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    size_t len = strlen(content);
+    int ret = write(fd, content, len) == (ssize_t)len ? 0 : -1;
+    if (close(fd) != 0) ret = -1;
+    if (ret == 0 && link(tmp, path) != 0) ret = errno == EEXIST ? 1 : -1;
+    unlink(tmp);
+    return ret;
+}
+
+static int chunk_path(const Id3Queue *queue, char *out, size_t k, const char *suffix, unsigned int gen)
+{
+    int n = suffix ? snprintf(out, QUEUE_PATH_MAX, "%s/%zu.%s", queue->dir, k, suffix)
+                   : snprintf(out, QUEUE_PATH_MAX, "%s/%zu.lease.%u", queue->dir, k, gen);
+    return n > 0 && n < QUEUE_PATH_MAX ? 0 : -1;
+}
+
+static int chunk_done(const Id3Queue *queue, size_t k)
+{
+    char path[QUEUE_PATH_MAX];
+    return chunk_path(queue, path, k, "done", 0) == 0 && access(path, F_OK) == 0;
+}
+
+/**
+ * @brief Tries to take the lease on chunk @p k.
+ *
+ * Leases are numbered by generation. The chunk is free if it has no lease, or
+ * if its newest lease has not been renewed for longer than the lease length;
+ * the claim creates the next generation, which only one worker can do.
+ *
+ * @return 1 if the lease was taken (its path is stored in @p lease_path),
+ *         0 if another worker holds it, -1 on error.
+ */
+static int claim_chunk(const Id3Queue *queue, size_t k, char *lease_path)
+{
+    unsigned int gen = 0;
+    struct stat st;
+    time_t newest = 0;
+    int held = 0;
+    for (;; gen++)
+    {
+        if (chunk_path(queue, lease_path, k, NULL, gen) != 0) return -1;
+        if (stat(lease_path, &st) != 0) break;
+        newest = st.st_mtime;
+        held = 1;
+    }
+    if (held && time(NULL) <= newest + (time_t)queue->lease) return 0;
+
+    char owner[128] = "localhost";
+    gethostname(owner, 64);
+    snprintf(owner + strlen(owner), sizeof(owner) - strlen(owner), " %ld\n", (long)getpid());
+    int ret = publish_file(lease_path, owner);
+    if (ret != 0) return ret > 0 ? 0 : -1;
+
+    // The chunk may have been finished between the check and the claim.
+    return chunk_done(queue, k) ? 0 : 1;
+}
+
+/**
+ * @brief Runs one item of a claimed chunk and renews the lease when it is a third used up.
+ */
+static int queue_item(Id3Pool *pool, size_t index, void *ctx)
+{
+    QueueChunk *chunk = (QueueChunk *)ctx;
+    int ret = chunk->fn(pool, chunk->first + index, chunk->ctx);
+
+    time_t now = time(NULL);
+    pthread_mutex_lock(&chunk->lock);
+    if (now >= chunk->renewed + (time_t)(chunk->queue->lease / 3))
+    {
+        // A lease taken over meanwhile is not reclaimed; both workers' edits are the same.
+        utimensat(AT_FDCWD, chunk->lease_path, NULL, 0);
+        chunk->renewed = now;
+    }
+    pthread_mutex_unlock(&chunk->lock);
+    return ret;
+}
+
+int id3_queue_open(Id3Queue *queue, const char *dir, size_t count, size_t chunk, unsigned int lease)
+{
+    memset(queue, 0, sizeof(*queue));
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        display_error("Cannot create queue directory.");
+        return -1;
+    }
+    queue->dir = strdup(dir);
+    if (!queue->dir)
+    {
+        display_error("Memory allocation failed.");
+        return -1;
+    }
+
+    // The first worker describes the job; the others adopt its chunk size and lease.
+    char path[QUEUE_PATH_MAX];
+    char job[96];
+    snprintf(path, sizeof(path), "%s/job", dir);
+    snprintf(job, sizeof(job), "%zu %zu %u\n", count,
+             chunk ? chunk : (size_t)ID3_QUEUE_DEFAULT_CHUNK, lease ? lease : ID3_QUEUE_DEFAULT_LEASE);
+    int ret = publish_file(path, job);
+    FILE *fp = ret >= 0 ? fopen(path, "r") : NULL;
+    size_t job_count = 0;
+    if (!fp || fscanf(fp, "%zu %zu %u", &job_count, &queue->chunk, &queue->lease) != 3 || queue->chunk == 0)
+    {
+        if (fp) fclose(fp);
+        id3_queue_close(queue);
+        display_error("Cannot read or create the queue's job description.");
+        return -1;
+    }
+    fclose(fp);
+    if (job_count != count)
+    {
+        fprintf(stderr, "Error: Queue %s holds a job of %zu items, not %zu\n", dir, job_count, count);
+        id3_queue_close(queue);
+        return -1;
+    }
+    queue->count = count;
+    queue->nchunks = (count + queue->chunk - 1) / queue->chunk;
+    return 0;
+}
+
+long id3_queue_run(Id3Queue *queue, int jobs, Id3BatchFn fn, void *ctx, size_t *processed)
+{
+    QueueChunk chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    chunk.queue = queue;
+    chunk.fn = fn;
+    chunk.ctx = ctx;
+    pthread_mutex_init(&chunk.lock, NULL);
+
+    long failures = 0;
+    size_t mine = 0;
+    size_t cursor = 0;
+    int busy = 0;   // Chunks seen leased by others in this pass
+    for (;;)
+    {
+        if (cursor == queue->nchunks)
+        {
+            // End of a pass: stop if no chunk is left, else wait for leases to expire.
+            if (!busy) break;
+            busy = 0;
+            cursor = 0;
+            sleep(queue->lease < 4 ? 1 : queue->lease / 4);
+            continue;
+        }
+        size_t k = cursor++;
+        if (chunk_done(queue, k)) continue;
+        int claimed = claim_chunk(queue, k, chunk.lease_path);
+        if (claimed < 0)
+        {
+            display_error("Cannot create lease file in queue directory.");
+            failures = -1;
+            break;
+        }
+        if (claimed == 0)
+        {
+            busy = 1;
+            continue;
+        }
+
+        chunk.first = k * queue->chunk;
+        chunk.renewed = time(NULL);
+        size_t n = queue->count - chunk.first < queue->chunk ? queue->count - chunk.first : queue->chunk;
+        long failed = id3_batch_run(n, jobs, queue_item, &chunk);
+        if (failed < 0)
+        {
+            // Leave the lease to expire so that another worker redoes the chunk.
+            failures = -1;
+            break;
+        }
+        failures += failed;
+        mine++;
+
+        char done_path[QUEUE_PATH_MAX];
+        if (chunk_path(queue, done_path, k, "done", 0) != 0 || publish_file(done_path, "") < 0)
+        {
+            display_error("Cannot mark queue chunk as done.");
+            failures = -1;
+            break;
+        }
+    }
+    pthread_mutex_destroy(&chunk.lock);
+    if (processed) *processed = mine;
+    return failures;
+}
+
+void id3_queue_close(Id3Queue *queue)
+{
+    free(queue->dir);
+    memset(queue, 0, sizeof(*queue));
+}
@@ -0,0 +1,71 @@
+#ifndef ID3_QUEUE_H
+#define ID3_QUEUE_H
+
+#include <stddef.h>
+#include "id3_batch.h"
+
+#define ID3_QUEUE_DEFAULT_CHUNK 256 /**< Items per chunk when none is requested */
+#define ID3_QUEUE_DEFAULT_LEASE 60  /**< Lease length in seconds when none is requested */
+
+/**
+ * @brief A job shared by any number of worker processes through a directory.
+ *
+ * The job's items are split into fixed-size chunks. A worker claims a chunk by
+ * creating a lease file in the directory; creation is atomic, so exactly one
+ * worker wins each lease. The lease expires unless its holder renews it, after
+ * which another worker may take the chunk over by creating the lease's next
+ * generation. A finished chunk gets a ".done" marker. Workers can therefore
+ * join or leave at any time, and chunks held by a worker that died are redone.
+ *
+ * All workers must load the same job (same items in the same order); the item
+ * count is recorded in the directory and checked by every worker.
+ */
+typedef struct
+{
+    char *dir;             /**< Queue directory */
+    size_t count;          /**< Items in the job */
+    size_t chunk;          /**< Items per chunk */
+    size_t nchunks;        /**< Number of chunks */
+    unsigned int lease;    /**< Seconds a lease lasts without renewal */
+} Id3Queue;
+
+/**
+ * @brief Opens a queue directory, creating it and its job description if needed.
+ *
+ * The chunk size and lease length of the worker that created the queue are
+ * used by all workers.
+ *
+ * @param queue Queue to initialize.
+ * @param dir   Directory shared by the workers.
+ * @param count Number of items in the job.
+ * @param chunk Items per chunk (0 selects ID3_QUEUE_DEFAULT_CHUNK).
+ * @param lease Lease length in seconds (0 selects ID3_QUEUE_DEFAULT_LEASE).
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_queue_open(Id3Queue *queue, const char *dir, size_t count, size_t chunk, unsigned int lease);
+
+/**
+ * @brief Claims and processes chunks until every chunk of the job is done.
+ *
+ * Each claimed chunk is run with id3_batch_run(); @p fn receives the index of
+ * the item within the whole job. The lease is renewed while the chunk runs.
+ * When all remaining chunks are leased by live workers, this worker waits and
+ * takes over any lease that expires.
+ *
+ * @param queue     Open queue.
+ * @param jobs      Worker threads per chunk (values below 1 select the default).
+ * @param fn        Function run for each item.
+ * @param ctx       Context passed to @p fn.
+ * @param processed If not NULL, receives the number of chunks this worker processed.
+ * @return Number of items for which @p fn failed, or -1 on failure.
+ */
+long id3_queue_run(Id3Queue *queue, int jobs, Id3BatchFn fn, void *ctx, size_t *processed);
+
+/**
+ * @brief Frees a queue; the directory is left for the other workers.
+ *
+ * @param queue Queue to free.
+ */
+void id3_queue_close(Id3Queue *queue);
+
+#endif // ID3_QUEUE_H
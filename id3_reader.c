@@ -3,24 +3,36 @@
  * @brief Implementation of functions for reading ID3 tags from MP3 files.
  */
 
+ #define _GNU_SOURCE
+ #define _FILE_OFFSET_BITS 64
+
+ #include <errno.h>
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/stat.h>
  #include "id3_reader.h"
+ #include "id3_io.h"
+ #include "id3_parser.h"
  #include "error_handling.h"
  
- #define FRAME_HEADER_SIZE 10
- 
  /**
   * @brief Reads the ID3 tags from an MP3 file by parsing the actual ID3v2 frames.
   *
-  * This implementation reads the ID3 header, calculates the tag size, and then iterates
-  * through each frame to extract the frame content for known frames.
+  * This implementation reads and validates the ID3 header, checks that the declared tag
+  * fits in the file, reads the whole tag with a single positioned read and hands it to
+  * the bounded parser, which extracts the content of known frames.
   *
+  * When a pool is given, the tag is read into the pool's I/O buffer and the TagData is
+  * taken from the pool, so steady-state batch reads do not allocate per file.
+  *
+  * @param pool Per-worker pool to draw buffers from, or NULL to allocate per call.
   * @param filename The name of the MP3 file.
   * @return Pointer to a TagData structure with tag data, or NULL on failure.
   */
- TagData* read_id3_tags(const char *filename) 
+ TagData* read_id3_tags_pooled(Id3Pool *pool, const char *filename) 
  {
      if (!check_id3_tag_presence(filename)) 
      {
@@ -28,119 +40,116 @@
         return NULL;
      }
      
-     // Open file in Read binary mode
-     FILE *fp = fopen(filename, "rb");
-     if (!fp) 
-     {
-        display_error("Cannot open file for reading.");
-        return NULL;
-     }
-     
-     // Read the ID3 header (first 10 bytes)
-     unsigned char header[10];
-     if (fread(header, 1, 10, fp) != 10) 
+     // Open file for positioned reads; offsets are 64-bit so multi-GB files work.
+     // A handle that went stale (e.g. after an NFS server failover) is reopened.
+     struct stat st;
+     unsigned char header[ID3_HEADER_SIZE];
+     Id3Header hdr;
+     Id3ParseStatus status;
+     unsigned char *body;
+     int read_status;
+     for (int attempt = 0;; attempt++) 
      {
-        display_error("Failed to read ID3 header.");
-        fclose(fp);
-        return NULL;
+         int fd = id3_open(filename, O_RDONLY, 0);
+         if (fd < 0) 
+         {
+            display_error("Cannot open file for reading.");
+            return NULL;
+         }
+         if (fstat(fd, &st) != 0 || id3_pread_full(fd, header, sizeof(header), 0) != 0) 
+         {
+             int err = errno;
+             close(fd);
+             if (err == ESTALE && id3_io_retry(err, attempt)) continue;
+             display_error("Failed to read ID3 header.");
+             return NULL;
+         }
+         
+         // Validate the header before trusting any size in it.
+         status = id3_parse_header(header, sizeof(header), &hdr);
+         if (status != ID3_PARSE_OK) 
+         {
+             display_error(id3_parse_status_string(status));
+             close(fd);
+             return NULL;
+         }
+         
+         // The declared tag must fit inside the file, which bounds the allocation below
+         // by the number of bytes actually present.
+         if ((off_t)ID3_HEADER_SIZE + hdr.tag_size > st.st_size) 
+         {
+             display_error("ID3 tag extends past the end of the file.");
+             close(fd);
+             return NULL;
+         }
+         
+         size_t body_size = hdr.tag_size ? hdr.tag_size : 1;
+         body = pool ? id3_pool_io_buffer(pool, body_size)
+                     : (unsigned char *)malloc(body_size);
+         if (!body) 
+         {
+             display_error("Memory allocation failed.");
+             close(fd);
+             return NULL;
+         }
+         read_status = id3_pread_full(fd, body, hdr.tag_size, ID3_HEADER_SIZE);
+         int err = errno;
+         close(fd);
+         if (read_status == 0 || err != ESTALE || !id3_io_retry(err, attempt)) break;
+         if (!pool) free(body);
      }
      
-     // Verify that the header starts with "ID3"
-     if (memcmp(header, "ID3", 3) != 0) 
+     // Create a TagData structure
+     TagData *data = NULL;
+     if (read_status == 0) 
      {
-         display_error("No ID3 tag found.");
-         fclose(fp);
-         return NULL;
+         data = pool ? id3_pool_acquire_tag(pool) : create_tag_data();
      }
-     
-     // Calculate tag size (sync-safe integer in bytes 6-9)
-     int tagSize = ((header[6] & 0x7F) << 21) |
-                   ((header[7] & 0x7F) << 14) |
-                   ((header[8] & 0x7F) << 7)  |
-                    (header[9] & 0x7F);
-     
-     // Create a TagData structure
-     TagData *data = create_tag_data();
      if (!data) 
      {
-         display_error("Memory allocation failed.");
-         fclose(fp);
+         display_error(read_status == 0 ? "Memory allocation failed." : "Failed to read ID3 tag.");
+         if (!pool) free(body);
          return NULL;
      }
 
      // For simplicity, store the version as read from the header.
-     char verStr[10];
-     snprintf(verStr, sizeof(verStr), "ID3v2.%d.%d", header[3], header[4]);
-     data->version = strdup(verStr);
+     char verStr[16];
+     snprintf(verStr, sizeof(verStr), "ID3v2.%d.%d", hdr.major, hdr.revision);
+     tag_set_version(data, verStr);
      
-     // Iterate over frames within the tag size.
-     long tagEnd = ftell(fp) + tagSize;
-     while (ftell(fp) < tagEnd) 
+     // Remember which file and which tag bytes the values came from.
+     data->source.dev = (unsigned long long)st.st_dev;
+     data->source.ino = (unsigned long long)st.st_ino;
+     data->source.size = (long long)st.st_size;
+     data->source.mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+     data->source.tag_hash = id3_hash64(body, hdr.tag_size, id3_hash64(header, sizeof(header), ID3_HASH64_SEED));
+     
+     status = id3_parse_frames(&hdr, body, hdr.tag_size, data);
+     if (!pool) free(body);
+     if (status != ID3_PARSE_OK) 
      {
-         char frameId[5] = {0};
-         unsigned char sizeBytes[4];
-         unsigned char flags[2];
-         if (fread(frameId, 1, 4, fp) != 4) break;
-         if (fread(sizeBytes, 1, 4, fp) != 4) break;
-         if (fread(flags, 1, 2, fp) != 2) break;
-         
-         // If the frame ID is empty (all zeroes), we've reached the end.
-         if (frameId[0] == 0)
-             break;
-         
-         int frameSize = (sizeBytes[0] << 24) |
-                         (sizeBytes[1] << 16) |
-                         (sizeBytes[2] << 8)  |
-                         (sizeBytes[3]);
-         
-         // Allocate a buffer for frame content
-         char *content = (char *)malloc(frameSize + 1);
-         if (!content) break;
-         if (fread(content, 1, frameSize, fp) != (size_t)frameSize) {
-             free(content);
-             break;
-         }
-         content[frameSize] = '\0';
-         
-         // Based on the frame ID, assign content to the proper field.
-         if (strcmp(frameId, "TIT2") == 0) 
-         {
-             free(data->title);
-             data->title = strdup(content);
-         } 
-         else if (strcmp(frameId, "TPE1") == 0) 
-         {
-             free(data->artist);
-             data->artist = strdup(content);
-         } 
-         else if (strcmp(frameId, "TALB") == 0) 
-         {
-             free(data->album);
-             data->album = strdup(content);
-         } 
-         else if (strcmp(frameId, "TYER") == 0) 
-         {
-             free(data->year);
-             data->year = strdup(content);
-         } 
-         else if (strcmp(frameId, "COMM") == 0) 
-         {
-             free(data->comment);
-             data->comment = strdup(content);
-         } 
-         else if (strcmp(frameId, "TCON") == 0) 
-         {
-             free(data->genre);
-             data->genre = strdup(content);
-         }
-         
-         free(content);
+         display_error(id3_parse_status_string(status));
+         if (pool) id3_pool_release_tag(pool, data);
+         else free_tag_data(data);
+         return NULL;
      }
      
-     fclose(fp);
+     // Values as read are the baseline for dirty tracking.
+     tag_mark_clean(data);
      return data;
  }
  
+ /**
+  * @brief Reads the ID3 tags from an MP3 file without a buffer pool.
+  *
+  * @param filename The name of the MP3 file.
+  * @return Pointer to a TagData structure with tag data, or NULL on failure.
+  */
+ TagData* read_id3_tags(const char *filename) 
+ {
+     return read_id3_tags_pooled(NULL, filename);
+ }
+ 
  /**
   * @brief Displays the metadata contained in a TagData structure.
   *
@@ -153,13 +162,15 @@
          printf("No tag data available.\n");
          return;
      }
-     printf("Version: %s\n", data->version ? data->version : "N/A");
-     printf("Title:   %s\n", data->title   ? data->title   : "N/A");
-     printf("Artist:  %s\n", data->artist  ? data->artist  : "N/A");
-     printf("Album:   %s\n", data->album   ? data->album   : "N/A");
-     printf("Year:    %s\n", data->year    ? data->year    : "N/A");
-     printf("Comment: %s\n", data->comment ? data->comment : "N/A");
-     printf("Genre:   %s\n", data->genre   ? data->genre   : "N/A");
+     printf("Version: %s\n", data->version[0] ? data->version : "N/A");
+     for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+     {
+         // Labels are the capitalized field names padded to a common width.
+         const char *name = tag_field_name((TagField)i);
+         const char *value = tag_get(data, (TagField)i);
+         printf("%c%s:%*s%s\n", name[0] - 'a' + 'A', name + 1, (int)(8 - strlen(name)), "",
+                value ? value : "N/A");
+     }
  }
  
  /**
@@ -174,14 +185,7 @@
      {
          display_metadata(data);
          /* Free allocated memory */
-         free(data->version);
-         free(data->title);
-         free(data->artist);
-         free(data->album);
-         free(data->year);
-         free(data->comment);
-         free(data->genre);
-         free(data);
+         free_tag_data(data);
      }
  }
  
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define ID3_READER_H
 
 #include "id3_utils.h"
+#include "id3_pool.h"
 
 /**
  * @brief Reads ID3 metadata tags from an MP3 file.
@@ -16,6 +17,20 @@
  */
 TagData* read_id3_tags(const char *filename);
 
+/**
+ * @brief Reads ID3 metadata tags from an MP3 file using a per-worker pool.
+ *
+ * Behaves like read_id3_tags(), but reads through the pool's I/O buffer and
+ * takes the TagData from the pool. Pass the result back with
+ * id3_pool_release_tag() instead of freeing it.
+ *
+ * @param pool Pool owned by the calling worker, or NULL to allocate per call.
+ * @param filename The name of the MP3 file to read.
+ * @return A pointer to a TagData structure containing the metadata,
+ *         or NULL if an error occurs.
+ */
+TagData* read_id3_tags_pooled(Id3Pool *pool, const char *filename);
+
 /**
  * @brief Displays the metadata stored in a TagData structure.
  *
@@ -0,0 +1,162 @@
+/**
+ * @file id3_scan.c
+ * @brief Recursive discovery of MP3 files in a library.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "id3_scan.h"
+#include "id3_checkpoint.h"
+#include "id3_utils.h"
+#include "error_handling.h"
+
+static unsigned int shard_index = 0; /**< Shard processed by this run */
+static unsigned int shard_count = 1; /**< Number of shards */
+
+int id3_scan_set_shard(const char *spec)
+{
+    unsigned int index, count;
+    char extra;
+    if (sscanf(spec, "%u/%u%c", &index, &count, &extra) != 2 || count == 0 || index >= count)
+    {
+        return -1;
+    }
+    shard_index = index;
+    shard_count = count;
+    return 0;
+}
+
+/**
+ * @brief Returns non-zero if @p key hashes to this run's shard.
+ */
+static int in_shard(const char *key)
+{
+    return shard_count == 1 || id3_hash64(key, strlen(key), ID3_HASH64_SEED) % shard_count == shard_index;
+}
+
+int id3_path_selected(const char *path)
+{
+    return in_shard(path) && !id3_checkpoint_contains(path);
+}
+
+int id3_path_list_add(Id3PathList *list, const char *path)
+{
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 256;
+        char **paths = (char **)realloc(list->paths, cap * sizeof(char *));
+        if (!paths) return -1;
+        list->paths = paths;
+        list->cap = cap;
+    }
+    char *copy = strdup(path);
+    if (!copy) return -1;
+    list->paths[list->count++] = copy;
+    return 0;
+}
+
+void id3_path_list_free(Id3PathList *list)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->cap = 0;
+}
+
+/**
+ * @brief Adds every MP3 file below a directory to the list.
+ */
+static int scan_directory(const char *dir, Id3PathList *list)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        fprintf(stderr, "Error: Cannot open directory %s\n", dir);
+        return 0; // Unreadable directories are reported and skipped
+    }
+    int ret = 0;
+    struct dirent *entry;
+    while (ret == 0 && (entry = readdir(d)) != NULL)
+    {
+        if (entry->d_name[0] == '.') continue; // Skips ".", ".." and hidden files
+
+        size_t len = strlen(dir) + strlen(entry->d_name) + 2;
+        char *path = (char *)malloc(len);
+        if (!path)
+        {
+            ret = -1;
+            break;
+        }
+        snprintf(path, len, "%s/%s", dir, entry->d_name);
+
+        int is_dir = entry->d_type == DT_DIR;
+        int is_file = entry->d_type == DT_REG;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+        {
+            struct stat st;
+            if (stat(path, &st) == 0)
+            {
+                is_dir = S_ISDIR(st.st_mode);
+                is_file = S_ISREG(st.st_mode);
+            }
+        }
+        if (is_dir) ret = scan_directory(path, list);
+        else if (is_file && check_id3_tag_presence(path)) ret = id3_path_list_add(list, path);
+        free(path);
+    }
+    closedir(d);
+    return ret;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int id3_scan_paths(char *const inputs[], int count, Id3PathList *list)
+{
+    for (int i = 0; i < count; i++)
+    {
+        struct stat st;
+        int ret;
+        size_t first = list->count, root_len = 0;
+        if (stat(inputs[i], &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            // Avoid a doubled slash in the generated paths.
+            size_t len = strlen(inputs[i]);
+            char *dir = strdup(inputs[i]);
+            if (!dir) return -1;
+            while (len > 1 && dir[len - 1] == '/') dir[--len] = '\0';
+            ret = scan_directory(dir, list);
+            free(dir);
+            root_len = len == 1 && inputs[i][0] == '/' ? 1 : len + 1;
+        }
+        else
+        {
+            ret = id3_path_list_add(list, inputs[i]);
+        }
+        if (ret != 0) return -1;
+
+        // Drop the paths other shards, or earlier runs, take care of. Files found below a
+        // directory are assigned a shard by their path relative to it, so hosts that mount
+        // the library at different places still split it the same way.
+        size_t kept = first;
+        for (size_t j = first; j < list->count; j++)
+        {
+            const char *path = list->paths[j];
+            if (in_shard(path + root_len) && !id3_checkpoint_contains(path)) list->paths[kept++] = list->paths[j];
+            else free(list->paths[j]);
+        }
+        list->count = kept;
+    }
+    qsort(list->paths, list->count, sizeof(char *), compare_paths);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#ifndef ID3_SCAN_H
+#define ID3_SCAN_H
+
+#include <stddef.h>
+
+/**
+ * @brief Growable list of file paths.
+ */
+typedef struct 
+{
+    char **paths;  /**< Paths, each separately allocated */
+    size_t count;  /**< Number of paths */
+    size_t cap;    /**< Capacity of paths */
+} Id3PathList;
+
+/**
+ * @brief Collects MP3 files from a mix of file and directory arguments.
+ *
+ * Files are taken as given; directories are walked recursively and every
+ * file with an .mp3 extension is added. The result is sorted by path so
+ * repeated scans of the same library produce the same order. Paths outside
+ * the selected shard, or already listed in the checkpoint log, are left out
+ * (see id3_path_selected()); files found below a directory argument are given
+ * their shard by their path relative to that directory.
+ *
+ * @param inputs Files and directories to scan.
+ * @param count  Number of entries in @p inputs.
+ * @param list   List to append to; initialize with all fields zero.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int id3_scan_paths(char *const inputs[], int count, Id3PathList *list);
+
+/**
+ * @brief Appends a copy of a path to a list.
+ *
+ * @param list List to append to.
+ * @param path Path to copy.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int id3_path_list_add(Id3PathList *list, const char *path);
+
+/**
+ * @brief Frees every path in a list and the list storage.
+ *
+ * @param list List to free.
+ */
+void id3_path_list_free(Id3PathList *list);
+
+/**
+ * @brief Restricts all later scans to one shard of the library.
+ *
+ * A path belongs to shard id3_hash64(path) mod N, which depends only on the
+ * path string, so N processes or hosts given the same inputs take disjoint
+ * slices that together cover every file, without coordinating. Files found by
+ * id3_scan_paths() below a directory are hashed by their path relative to it,
+ * so each host may name the library's root its own way; any other path, such
+ * as a file argument or a manifest path, is hashed as given and must be spelled
+ * the same way by every worker.
+ *
+ * @param spec Shard as "i/N" with 0 <= i < N.
+ * @return 0 on success, -1 if @p spec is invalid.
+ */
+int id3_scan_set_shard(const char *spec);
+
+/**
+ * @brief Returns non-zero if a path is part of this run's work.
+ *
+ * A path is selected when it lies in the shard set with id3_scan_set_shard()
+ * (all paths if none was set) and is not listed in the open checkpoint log.
+ *
+ * @param path Path to test.
+ * @return Non-zero if the path should be processed.
+ */
+int id3_path_selected(const char *path);
+
+#endif // ID3_SCAN_H
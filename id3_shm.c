@@ -0,0 +1,337 @@
+/**
+ * @file id3_shm.c
+ * @brief Library indexes published as position-independent shared-memory segments.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "id3_shm.h"
+#include "id3_index.h"
+#include "id3_intern.h"
+#include "id3_io.h"
+#include "error_handling.h"
+
+#define SHM_PATH_MAX 512 /**< Longest path of a segment file */
+
+/**
+ * @brief A segment being built in memory.
+ */
+typedef struct
+{
+    Id3ShmRecord *records;      /**< Records; string members are offsets into strings */
+    size_t count;               /**< Records used */
+    size_t cap;                 /**< Records allocated */
+    char *strings;              /**< String area, starting with one NUL so offset 0 is unset */
+    size_t strings_len;         /**< Bytes used */
+    size_t strings_cap;         /**< Bytes allocated */
+    Id3InternTable *values;     /**< Distinct field values */
+    uint64_t *value_offsets;    /**< String offset of each interned value, by intern ID */
+    size_t value_cap;           /**< Entries allocated in value_offsets */
+} ShmBuilder;
+
+static int segment_path(char *out, const char *name)
+{
+    if (!*name || strchr(name, '/')) return -1;
+    int n = snprintf(out, SHM_PATH_MAX, "%s/%s", ID3_SHM_DIR, name);
+    return n > 0 && n < SHM_PATH_MAX ? 0 : -1;
+}
+
+/**
+ * @brief Appends a string to the string area; returns its offset there, or 0 on failure.
+ *
+ * The area starts with a NUL no string uses, so no string is ever stored at offset 0.
+ */
+static uint64_t add_string(ShmBuilder *b, const char *s, size_t len)
+{
+    size_t used = b->strings_len ? b->strings_len : 1;
+    if (used + len + 1 > b->strings_cap)
+    {
+        size_t cap = b->strings_cap ? b->strings_cap : 1 << 16;
+        while (cap < used + len + 1) cap *= 2;
+        char *p = (char *)realloc(b->strings, cap);
+        if (!p) return 0;
+        b->strings = p;
+        b->strings_cap = cap;
+    }
+    if (b->strings_len == 0)
+    {
+        b->strings[0] = '\0';
+        b->strings_len = 1;
+    }
+    uint64_t offset = b->strings_len;
+    memcpy(b->strings + offset, s, len);
+    b->strings[offset + len] = '\0';
+    b->strings_len += len + 1;
+    return offset;
+}
+
+/**
+ * @brief Stores a field value once per distinct value; returns its offset, or 0 on failure.
+ */
+static uint64_t add_value(ShmBuilder *b, const char *s)
+{
+    size_t len = strlen(s);
+    unsigned int id = id3_intern(b->values, s, len);
+    if (id == ID3_INTERN_NONE) return add_string(b, s, len); // Table full: store a copy
+    if (id >= b->value_cap)
+    {
+        size_t cap = b->value_cap ? b->value_cap : 1024;
+        while (cap <= id) cap *= 2;
+        uint64_t *p = (uint64_t *)realloc(b->value_offsets, cap * sizeof(uint64_t));
+        if (!p) return 0;
+        memset(p + b->value_cap, 0, (cap - b->value_cap) * sizeof(uint64_t));
+        b->value_offsets = p;
+        b->value_cap = cap;
+    }
+    if (b->value_offsets[id] == 0) b->value_offsets[id] = add_string(b, s, len);
+    return b->value_offsets[id];
+}
+
+/**
+ * @brief Adds one index row; returns 0 on success, -1 on allocation failure.
+ */
+static int add_record(ShmBuilder *b, const char *path, const TagData *data)
+{
+    if (b->count == b->cap)
+    {
+        size_t cap = b->cap ? b->cap * 2 : 1024;
+        Id3ShmRecord *p = (Id3ShmRecord *)realloc(b->records, cap * sizeof(Id3ShmRecord));
+        if (!p) return -1;
+        b->records = p;
+        b->cap = cap;
+    }
+    Id3ShmRecord *r = &b->records[b->count];
+    memset(r, 0, sizeof(*r));
+    if (!(r->path = add_string(b, path, strlen(path)))) return -1;
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        const char *value = tag_get(data, (TagField)i);
+        if (value && !(r->fields[i] = add_value(b, value))) return -1;
+    }
+    if (data->version[0] && !(r->version = add_value(b, data->version))) return -1;
+    r->art_bytes = data->art_bytes;
+    r->duration = data->duration;
+    b->count++;
+    return 0;
+}
+
+static void free_builder(ShmBuilder *b)
+{
+    free(b->records);
+    free(b->strings);
+    free(b->value_offsets);
+    id3_intern_destroy(b->values);
+}
+
+/**
+ * @brief Reads the epoch of the segment currently published under a path, or 0 if none.
+ */
+static uint64_t current_epoch(const char *path)
+{
+    Id3ShmHeader header;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    int ok = id3_pread_full(fd, &header, sizeof(header), 0) == 0 &&
+             memcmp(header.magic, ID3_SHM_MAGIC, sizeof(ID3_SHM_MAGIC)) == 0;
+    close(fd);
+    return ok ? header.epoch : 0;
+}
+
+/**
+ * @brief Writes a built segment to a new file and renames it over @p path.
+ */
+static int write_segment(const ShmBuilder *b, const char *path, uint64_t epoch)
+{
+    size_t records_off = (sizeof(Id3ShmHeader) + 63) & ~(size_t)63;
+    size_t strings_off = records_off + b->count * sizeof(Id3ShmRecord);
+    size_t size = strings_off + b->strings_len;
+
+    char temp[SHM_PATH_MAX + 16];
+    snprintf(temp, sizeof(temp), "%s.tmpXXXXXX", path);
+    int fd = mkstemp(temp);
+    if (fd < 0) return -1;
+    unsigned char *base = ftruncate(fd, (off_t)size) == 0 && fchmod(fd, 0644) == 0
+                          ? (unsigned char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        unlink(temp);
+        return -1;
+    }
+
+    Id3ShmHeader *header = (Id3ShmHeader *)base;
+    memcpy(header->magic, ID3_SHM_MAGIC, sizeof(ID3_SHM_MAGIC));
+    header->header_size = sizeof(Id3ShmHeader);
+    header->record_size = sizeof(Id3ShmRecord);
+    header->epoch = epoch;
+    header->size = size;
+    header->count = b->count;
+    header->records = records_off;
+
+    // String offsets were relative to the string area; make them relative to the segment.
+    Id3ShmRecord *records = (Id3ShmRecord *)(base + records_off);
+    for (size_t i = 0; i < b->count; i++)
+    {
+        Id3ShmRecord r = b->records[i];
+        r.path += strings_off;
+        for (int f = 0; f < TAG_FIELD_COUNT; f++)
+        {
+            if (r.fields[f]) r.fields[f] += strings_off;
+        }
+        if (r.version) r.version += strings_off;
+        records[i] = r;
+    }
+    memcpy(base + strings_off, b->strings, b->strings_len);
+    munmap(base, size);
+
+    if (rename(temp, path) != 0)
+    {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+long id3_shm_publish(const char *name, const char *index, uint64_t *epoch)
+{
+    char path[SHM_PATH_MAX];
+    if (segment_path(path, name) != 0)
+    {
+        display_error("Invalid segment name.");
+        return -1;
+    }
+
+    ShmBuilder b;
+    memset(&b, 0, sizeof(b));
+    b.values = id3_intern_create(0);
+    Id3IndexReader reader;
+    if (!b.values || id3_index_open(&reader, index) != 0)
+    {
+        free_builder(&b);
+        display_error("Cannot start building the shared segment.");
+        return -1;
+    }
+    // The index is sorted by path, which is the order lookups binary-search in.
+    int status;
+    while ((status = id3_index_next(&reader)) == 1)
+    {
+        if (add_record(&b, reader.path, reader.record) != 0)
+        {
+            status = -1;
+            break;
+        }
+    }
+    id3_index_close(&reader);
+
+    uint64_t next_epoch = current_epoch(path) + 1;
+    if (status != 0 || write_segment(&b, path, next_epoch) != 0)
+    {
+        free_builder(&b);
+        display_error("Failed to publish shared segment.");
+        return -1;
+    }
+    long count = (long)b.count;
+    free_builder(&b);
+    if (epoch) *epoch = next_epoch;
+    return count;
+}
+
+/**
+ * @brief Maps the segment open on @p fd and checks its layout.
+ */
+static int map_segment(Id3ShmView *view, int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Id3ShmHeader)) return -1;
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) return -1;
+
+    const Id3ShmHeader *header = (const Id3ShmHeader *)base;
+    if (memcmp(header->magic, ID3_SHM_MAGIC, sizeof(ID3_SHM_MAGIC)) != 0 ||
+        header->header_size != sizeof(Id3ShmHeader) || header->record_size != sizeof(Id3ShmRecord) ||
+        header->size != (uint64_t)st.st_size || header->records > header->size ||
+        header->count > (header->size - header->records) / sizeof(Id3ShmRecord) ||
+        (header->count > 0 && ((const unsigned char *)base)[st.st_size - 1] != '\0'))
+    {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+    view->base = (const unsigned char *)base;
+    view->size = (size_t)st.st_size;
+    view->header = header;
+    view->records = (const Id3ShmRecord *)(view->base + header->records);
+    return 0;
+}
+
+int id3_shm_open(Id3ShmView *view, const char *name)
+{
+    char path[SHM_PATH_MAX];
+    memset(view, 0, sizeof(*view));
+    if (segment_path(path, name) != 0) return -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    int ret = map_segment(view, fd);
+    close(fd);
+    return ret;
+}
+
+int id3_shm_refresh(Id3ShmView *view, const char *name)
+{
+    char path[SHM_PATH_MAX];
+    if (segment_path(path, name) != 0) return -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    Id3ShmHeader header;
+    if (id3_pread_full(fd, &header, sizeof(header), 0) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (header.epoch == view->header->epoch)
+    {
+        close(fd);
+        return 0;
+    }
+    Id3ShmView fresh;
+    int ret = map_segment(&fresh, fd);
+    close(fd);
+    if (ret != 0) return -1;
+    id3_shm_close(view);
+    *view = fresh;
+    return 1;
+}
+
+const char *id3_shm_string(const Id3ShmView *view, uint64_t offset)
+{
+    return offset && offset < view->size ? (const char *)(view->base + offset) : NULL;
+}
+
+const Id3ShmRecord *id3_shm_find(const Id3ShmView *view, const char *path)
+{
+    size_t lo = 0, hi = view->header->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        const char *key = id3_shm_string(view, view->records[mid].path);
+        if (!key) return NULL; // Damaged segment
+        int cmp = strcmp(key, path);
+        if (cmp == 0) return &view->records[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+void id3_shm_close(Id3ShmView *view)
+{
+    if (view->base) munmap((void *)view->base, view->size);
+    memset(view, 0, sizeof(*view));
+}
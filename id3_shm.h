@@ -0,0 +1,113 @@
+#ifndef ID3_SHM_H
+#define ID3_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "id3_utils.h"
+
+#define ID3_SHM_MAGIC   "ID3SHM1" /**< First bytes of a segment (NUL-terminated) */
+#define ID3_SHM_DIR     "/dev/shm" /**< Where named segments live */
+
+/**
+ * @brief Header at offset 0 of a shared library segment.
+ *
+ * A segment contains no pointers: every reference is a byte offset from the
+ * start of the segment, so it can be mapped at any address by any process.
+ */
+typedef struct
+{
+    char magic[8];          /**< ID3_SHM_MAGIC */
+    uint32_t header_size;   /**< sizeof(Id3ShmHeader), for layout checks */
+    uint32_t record_size;   /**< sizeof(Id3ShmRecord), for layout checks */
+    uint64_t epoch;         /**< Incremented by every publish under the same name */
+    uint64_t size;          /**< Total size of the segment in bytes */
+    uint64_t count;         /**< Number of records */
+    uint64_t records;       /**< Offset of the records, sorted by path */
+} Id3ShmHeader;
+
+/**
+ * @brief One file of the library; string members are offsets, 0 meaning unset.
+ */
+typedef struct
+{
+    uint64_t path;                     /**< Offset of the NUL-terminated path */
+    uint64_t fields[TAG_FIELD_COUNT];  /**< Offsets of the field values, indexed by TagField */
+    uint64_t version;                  /**< Offset of the tag version string */
+    uint64_t art_bytes;                /**< Total size of embedded pictures */
+    int64_t duration;                  /**< Playing time in seconds, or -1 if unknown */
+} Id3ShmRecord;
+
+/**
+ * @brief A read-only mapping of a published segment.
+ */
+typedef struct
+{
+    const unsigned char *base;         /**< Start of the mapping */
+    size_t size;                       /**< Size of the mapping */
+    const Id3ShmHeader *header;        /**< Segment header */
+    const Id3ShmRecord *records;       /**< Records, sorted by path */
+} Id3ShmView;
+
+/**
+ * @brief Publishes a library index as a named shared-memory segment.
+ *
+ * The segment is built in a temporary file under ID3_SHM_DIR and renamed over
+ * @p name, so consumers see either the old or the new segment, never a mix.
+ * Mappings of the old segment stay valid until they are closed. Equal field
+ * values (genres, artists, ...) are stored once.
+ *
+ * @param name  Segment name (no '/').
+ * @param index Index written by --index ("-" for standard input).
+ * @param epoch If not NULL, receives the epoch of the new segment.
+ * @return Number of records published, or -1 on failure (an error has been displayed).
+ */
+long id3_shm_publish(const char *name, const char *index, uint64_t *epoch);
+
+/**
+ * @brief Maps a published segment read-only.
+ *
+ * @param view View to initialize.
+ * @param name Segment name.
+ * @return 0 on success, -1 if the segment is missing or invalid.
+ */
+int id3_shm_open(Id3ShmView *view, const char *name);
+
+/**
+ * @brief Switches a view to the newest segment if one was published since it was opened.
+ *
+ * Only the new segment's header is read unless its epoch differs. Strings and
+ * records taken from the old mapping become invalid when this returns 1.
+ *
+ * @param view Open view.
+ * @param name Segment name.
+ * @return 1 if the view now maps a newer segment, 0 if it was current, -1 on failure.
+ */
+int id3_shm_refresh(Id3ShmView *view, const char *name);
+
+/**
+ * @brief Finds the record of a path by binary search.
+ *
+ * @param view Open view.
+ * @param path Path as written in the index.
+ * @return Record in the mapping, or NULL if the path is not in the library (or the
+ *         segment is damaged).
+ */
+const Id3ShmRecord *id3_shm_find(const Id3ShmView *view, const char *path);
+
+/**
+ * @brief Returns the string at an offset of the segment.
+ *
+ * @param view   Open view.
+ * @param offset Offset from a record.
+ * @return String in the mapping, or NULL for offset 0 or an offset outside the segment.
+ */
+const char *id3_shm_string(const Id3ShmView *view, uint64_t offset);
+
+/**
+ * @brief Unmaps a view.
+ *
+ * @param view View to close.
+ */
+void id3_shm_close(Id3ShmView *view);
+
+#endif // ID3_SHM_H
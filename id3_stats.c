@@ -0,0 +1,384 @@
+/**
+ * @file id3_stats.c
+ * @brief Library statistics computed as a parallel reduction.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "id3_stats.h"
+#include "id3_batch.h"
+#include "id3_csv.h"
+#include "id3_index.h"
+#include "id3_reader.h"
+#include "error_handling.h"
+
+/**
+ * @brief State of one statistics scan.
+ */
+typedef struct 
+{
+    Id3Stats *stats;            /**< Statistics being computed */
+    const Id3PathList *files;   /**< Files to read */
+    Id3StatsCounts *partials;   /**< One set of counts per worker, plus one shared */
+    int workers;                /**< Number of workers; partials[workers] is shared */
+    pthread_mutex_t lock;       /**< Guards the shared counts */
+} StatsJob;
+
+/**
+ * @brief One line of a grouped listing.
+ */
+typedef struct 
+{
+    const char *name;
+    size_t count;
+} StatsRow;
+
+static const char *group_titles[ID3_STATS_GROUPS] = { "Genres", "Years", "Artists", "Tag versions" };
+static const char *group_keys[ID3_STATS_GROUPS] = { "genre", "year", "artist", "version" };
+
+/**
+ * @brief Returns the value a tag has for a group, or NULL if it has none.
+ */
+static const char *group_value(const TagData *data, Id3StatsGroup group, size_t *len)
+{
+    const char *value;
+    switch (group)
+    {
+        case ID3_STATS_GENRE:  value = tag_get(data, TAG_GENRE); break;
+        case ID3_STATS_YEAR:   value = tag_get(data, TAG_YEAR); break;
+        case ID3_STATS_ARTIST: value = tag_get(data, TAG_ARTIST); break;
+        default:               value = data->version[0] ? data->version : NULL; break;
+    }
+    if (value) *len = strlen(value);
+    return value;
+}
+
+/**
+ * @brief Grows a counts array so that index @p id is valid; new entries are zero.
+ */
+static int grow_counts(Id3StatsCounts *c, int group, size_t need)
+{
+    if (need <= c->caps[group]) return 0;
+    size_t cap = c->caps[group] ? c->caps[group] : 64;
+    while (cap < need) cap *= 2;
+    size_t *counts = (size_t *)realloc(c->counts[group], cap * sizeof(size_t));
+    if (!counts) return -1;
+    memset(counts + c->caps[group], 0, (cap - c->caps[group]) * sizeof(size_t));
+    c->counts[group] = counts;
+    c->caps[group] = cap;
+    return 0;
+}
+
+/**
+ * @brief Adds one tag to a set of counts.
+ */
+static int counts_add(Id3StatsCounts *c, Id3InternTable *const names[], const TagData *data)
+{
+    c->files++;
+    c->art_bytes += data->art_bytes;
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        if (!tag_get(data, (TagField)i)) c->missing[i]++;
+    }
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        size_t len;
+        const char *value = group_value(data, (Id3StatsGroup)g, &len);
+        if (!value) continue;
+        // Lookups of values seen before are lock-free; only new values take the table lock.
+        unsigned int id = id3_intern(names[g], value, len);
+        if (id == ID3_INTERN_NONE) continue; // Table full: the value is not grouped
+        if (grow_counts(c, g, (size_t)id + 1) != 0) return -1;
+        c->counts[g][id]++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds one set of counts into another.
+ */
+static int counts_merge(Id3StatsCounts *dst, const Id3StatsCounts *src)
+{
+    dst->files += src->files;
+    dst->art_bytes += src->art_bytes;
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        dst->missing[i] += src->missing[i];
+    }
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        if (grow_counts(dst, g, src->caps[g]) != 0) return -1;
+        for (size_t id = 0; id < src->caps[g]; id++)
+        {
+            dst->counts[g][id] += src->counts[g][id];
+        }
+    }
+    return 0;
+}
+
+static void counts_free(Id3StatsCounts *c)
+{
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        free(c->counts[g]);
+    }
+    memset(c, 0, sizeof(*c));
+}
+
+int id3_stats_init(Id3Stats *stats, unsigned int capacity)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        stats->names[g] = id3_intern_create(capacity);
+        if (!stats->names[g])
+        {
+            id3_stats_free(stats);
+            display_error("Memory allocation failed.");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int stats_read_one(Id3Pool *pool, size_t index, void *ctx)
+{
+    StatsJob *job = (StatsJob *)ctx;
+    const char *path = job->files->paths[index];
+    TagData *data = read_id3_tags_pooled(pool, path);
+    if (!data)
+    {
+        fprintf(stderr, "Error: Cannot read tags of %s\n", path);
+        return -1;
+    }
+    int ret;
+    if (pool)
+    {
+        // Each worker owns its counts, so no lock is needed.
+        ret = counts_add(&job->partials[pool->worker], job->stats->names, data);
+        id3_pool_release_tag(pool, data);
+    }
+    else
+    {
+        pthread_mutex_lock(&job->lock);
+        ret = counts_add(&job->partials[job->workers], job->stats->names, data);
+        pthread_mutex_unlock(&job->lock);
+        free_tag_data(data);
+    }
+    return ret;
+}
+
+long id3_stats_scan(Id3Stats *stats, const Id3PathList *files, int jobs)
+{
+    StatsJob job;
+    job.stats = stats;
+    job.files = files;
+    job.workers = id3_batch_workers(files->count, jobs);
+    job.partials = (Id3StatsCounts *)calloc((size_t)job.workers + 1, sizeof(Id3StatsCounts));
+    if (!job.partials) return -1;
+    pthread_mutex_init(&job.lock, NULL);
+
+    long failures = id3_batch_run(files->count, job.workers, stats_read_one, &job);
+
+    // Reduce the per-worker counts into the total.
+    for (int i = 0; i <= job.workers; i++)
+    {
+        if (failures >= 0 && counts_merge(&stats->total, &job.partials[i]) != 0) failures = -1;
+        counts_free(&job.partials[i]);
+    }
+    free(job.partials);
+    pthread_mutex_destroy(&job.lock);
+    return failures;
+}
+
+int id3_stats_index(Id3Stats *stats, const char *filename)
+{
+    Id3IndexReader reader;
+    if (id3_index_open(&reader, filename) != 0) return -1;
+    int status;
+    while ((status = id3_index_next(&reader)) == 1)
+    {
+        if (counts_add(&stats->total, stats->names, reader.record) != 0)
+        {
+            status = -1;
+            break;
+        }
+    }
+    id3_index_close(&reader);
+    if (status != 0)
+    {
+        display_error("Failed to read index.");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes one row of a saved statistics file.
+ */
+static void save_row(FILE *out, const char *group, const char *value, unsigned long long count)
+{
+    id3_csv_write_cell(out, group, '\t');
+    fputc('\t', out);
+    id3_csv_write_cell(out, value, '\t');
+    fprintf(out, "\t%llu\n", count);
+}
+
+int id3_stats_save(const Id3Stats *stats, const char *filename)
+{
+    FILE *out = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "w");
+    if (!out)
+    {
+        display_error("Failed to create statistics file.");
+        return -1;
+    }
+    const Id3StatsCounts *c = &stats->total;
+    fprintf(out, "group\tvalue\tcount\n");
+    save_row(out, "files", "", c->files);
+    save_row(out, "art_bytes", "", c->art_bytes);
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        save_row(out, "missing", tag_field_name((TagField)i), c->missing[i]);
+    }
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        for (size_t id = 0; id < c->caps[g]; id++)
+        {
+            if (c->counts[g][id] == 0) continue;
+            save_row(out, group_keys[g], id3_intern_string(stats->names[g], (unsigned int)id), c->counts[g][id]);
+        }
+    }
+    int ret = ferror(out) ? -1 : 0;
+    if (out == stdout) fflush(out);
+    else if (fclose(out) != 0) ret = -1;
+    if (ret != 0) display_error("Failed to write statistics file.");
+    return ret;
+}
+
+/**
+ * @brief Adds one row of a saved statistics file into the totals.
+ */
+static int load_row(Id3Stats *stats, const char *group, const char *value, unsigned long long count)
+{
+    Id3StatsCounts *c = &stats->total;
+    if (strcmp(group, "files") == 0)
+    {
+        c->files += (size_t)count;
+        return 0;
+    }
+    if (strcmp(group, "art_bytes") == 0)
+    {
+        c->art_bytes += count;
+        return 0;
+    }
+    if (strcmp(group, "missing") == 0)
+    {
+        int field = tag_field_from_name(value);
+        if (field < 0) return -1;
+        c->missing[field] += (size_t)count;
+        return 0;
+    }
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        if (strcmp(group, group_keys[g]) != 0) continue;
+        unsigned int id = id3_intern(stats->names[g], value, strlen(value));
+        if (id == ID3_INTERN_NONE) return 0; // Table full: the value is not grouped
+        if (grow_counts(c, g, (size_t)id + 1) != 0) return -1;
+        c->counts[g][id] += (size_t)count;
+        return 0;
+    }
+    return -1;
+}
+
+int id3_stats_load(Id3Stats *stats, const char *filename)
+{
+    Id3CsvReader reader;
+    if (id3_csv_open(&reader, filename, '\t') != 0)
+    {
+        display_error("Failed to open statistics file.");
+        return -1;
+    }
+    int status = id3_csv_next(&reader);
+    if (status == 1 && strcmp(id3_csv_cell(&reader, 0), "group") != 0) status = -1;
+    while (status == 1 && (status = id3_csv_next(&reader)) == 1)
+    {
+        char *end;
+        const char *cell = id3_csv_cell(&reader, 2);
+        unsigned long long count = strtoull(cell, &end, 10);
+        if (!*cell || *end || load_row(stats, id3_csv_cell(&reader, 0), id3_csv_cell(&reader, 1), count) != 0)
+        {
+            fprintf(stderr, "Error: Invalid statistics row at %s:%lu\n", filename, reader.line);
+            status = -1;
+        }
+    }
+    id3_csv_close(&reader);
+    if (status != 0)
+    {
+        display_error("Failed to read statistics file.");
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_rows(const void *a, const void *b)
+{
+    const StatsRow *ra = (const StatsRow *)a;
+    const StatsRow *rb = (const StatsRow *)b;
+    if (ra->count != rb->count) return ra->count > rb->count ? -1 : 1;
+    return strcmp(ra->name, rb->name);
+}
+
+/**
+ * @brief Prints one group, most frequent values first.
+ */
+static void print_group(FILE *out, const Id3Stats *stats, int group, size_t top)
+{
+    const Id3StatsCounts *c = &stats->total;
+    size_t n = 0;
+    StatsRow *rows = (StatsRow *)malloc((c->caps[group] ? c->caps[group] : 1) * sizeof(StatsRow));
+    if (!rows) return;
+    for (size_t id = 0; id < c->caps[group]; id++)
+    {
+        if (c->counts[group][id] == 0) continue;
+        rows[n].name = id3_intern_string(stats->names[group], (unsigned int)id);
+        rows[n].count = c->counts[group][id];
+        n++;
+    }
+    qsort(rows, n, sizeof(StatsRow), compare_rows);
+
+    fprintf(out, "%s (%zu distinct):\n", group_titles[group], n);
+    size_t shown = top && top < n ? top : n;
+    for (size_t i = 0; i < shown; i++)
+    {
+        fprintf(out, "  %-32s %zu\n", rows[i].name, rows[i].count);
+    }
+    if (shown < n) fprintf(out, "  ... %zu more\n", n - shown);
+    free(rows);
+}
+
+void id3_stats_print(FILE *out, const Id3Stats *stats, size_t top)
+{
+    const Id3StatsCounts *c = &stats->total;
+    fprintf(out, "Files:          %zu\n", c->files);
+    fprintf(out, "Embedded art:   %llu bytes\n", c->art_bytes);
+    print_group(out, stats, ID3_STATS_VERSION, 0);
+    fprintf(out, "Missing fields:\n");
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        fprintf(out, "  %-32s %zu\n", tag_field_name((TagField)i), c->missing[i]);
+    }
+    print_group(out, stats, ID3_STATS_GENRE, top);
+    print_group(out, stats, ID3_STATS_YEAR, top);
+    print_group(out, stats, ID3_STATS_ARTIST, top);
+}
+
+void id3_stats_free(Id3Stats *stats)
+{
+    for (int g = 0; g < ID3_STATS_GROUPS; g++)
+    {
+        id3_intern_destroy(stats->names[g]);
+    }
+    counts_free(&stats->total);
+    memset(stats, 0, sizeof(*stats));
+}
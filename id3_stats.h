@@ -0,0 +1,112 @@
+#ifndef ID3_STATS_H
+#define ID3_STATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "id3_intern.h"
+#include "id3_scan.h"
+#include "id3_utils.h"
+
+/**
+ * @brief Values a library is grouped by.
+ */
+typedef enum 
+{
+    ID3_STATS_GENRE = 0, /**< Genre field */
+    ID3_STATS_YEAR,      /**< Year field */
+    ID3_STATS_ARTIST,    /**< Artist field */
+    ID3_STATS_VERSION,   /**< Tag version, e.g. "ID3v2.3.0" */
+    ID3_STATS_GROUPS
+} Id3StatsGroup;
+
+/**
+ * @brief Counters over a set of tags.
+ *
+ * Grouped counts are indexed by the ID a value has in the group's intern table.
+ * Each worker fills its own Id3StatsCounts, and the partial counts are added
+ * together once all files have been read.
+ */
+typedef struct 
+{
+    size_t files;                          /**< Tags counted */
+    size_t missing[TAG_FIELD_COUNT];       /**< Tags without each field */
+    unsigned long long art_bytes;          /**< Total size of embedded pictures */
+    size_t *counts[ID3_STATS_GROUPS];      /**< Per-group counts indexed by intern ID */
+    size_t caps[ID3_STATS_GROUPS];         /**< Capacity of each counts array */
+} Id3StatsCounts;
+
+/**
+ * @brief Statistics of a library: the merged counts and the names they refer to.
+ */
+typedef struct 
+{
+    Id3InternTable *names[ID3_STATS_GROUPS]; /**< Distinct values of each group */
+    Id3StatsCounts total;                    /**< Counts over the whole library */
+} Id3Stats;
+
+/**
+ * @brief Initializes empty statistics.
+ *
+ * @param stats    Statistics to initialize.
+ * @param capacity Most distinct values per group (0 selects the intern default).
+ * @return 0 on success, -1 on allocation failure.
+ */
+int id3_stats_init(Id3Stats *stats, unsigned int capacity);
+
+/**
+ * @brief Reads every file in parallel and adds its tag to the statistics.
+ *
+ * @param stats Initialized statistics.
+ * @param files Files to read.
+ * @param jobs  Number of worker threads (0 selects the default).
+ * @return Number of files that could not be read, or -1 on setup failure.
+ */
+long id3_stats_scan(Id3Stats *stats, const Id3PathList *files, int jobs);
+
+/**
+ * @brief Adds every row of a library index to the statistics.
+ *
+ * @param stats    Initialized statistics.
+ * @param filename Index written by --index ("-" for standard input).
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_stats_index(Id3Stats *stats, const char *filename);
+
+/**
+ * @brief Saves the statistics as a tab-separated "group, value, count" file.
+ *
+ * Saved files of disjoint parts of a library, e.g. one per shard, can be
+ * added together with id3_stats_load().
+ *
+ * @param stats    Statistics to save.
+ * @param filename File to create ("-" for standard output).
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_stats_save(const Id3Stats *stats, const char *filename);
+
+/**
+ * @brief Adds a file written by id3_stats_save() to the statistics.
+ *
+ * @param stats    Initialized statistics.
+ * @param filename Saved statistics ("-" for standard input).
+ * @return 0 on success, -1 on failure (an error has been displayed).
+ */
+int id3_stats_load(Id3Stats *stats, const char *filename);
+
+/**
+ * @brief Prints a report of the statistics.
+ *
+ * @param out   Stream to print to.
+ * @param stats Statistics to report.
+ * @param top   Most values to list per group, by descending count (0 lists all).
+ */
+void id3_stats_print(FILE *out, const Id3Stats *stats, size_t top);
+
+/**
+ * @brief Frees the counts and intern tables of statistics.
+ *
+ * @param stats Statistics to free.
+ */
+void id3_stats_free(Id3Stats *stats);
+
+#endif // ID3_STATS_H
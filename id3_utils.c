@@ -1,13 +1,35 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 #include "id3_utils.h"
 
+/**
+ * @brief Field names and frame IDs, indexed by TagField.
+ */
+static const struct 
+{
+    const char *name;
+    const char *frame_id;
+} tag_fields[TAG_FIELD_COUNT] = 
+{
+    { "title",   "TIT2" },
+    { "artist",  "TPE1" },
+    { "album",   "TALB" },
+    { "year",    "TYER" },
+    { "comment", "COMM" },
+    { "genre",   "TCON" },
+    { "track",   "TRCK" },
+};
+
 /**
  * @brief Allocates and initializes a new TagData structure.
  *
  * This function dynamically allocates memory for a TagData structure
- * and initializes all string pointers to NULL. The caller is responsible
- * for filling in the fields and freeing the allocated memory using free_tag_data().
+ * and marks every field as unset. The arena is allocated lazily the first
+ * time a long value is stored. The caller is responsible for freeing the
+ * structure using free_tag_data().
  *
  * @return A pointer to the newly allocated TagData structure, or NULL if allocation fails.
  */
@@ -16,24 +38,77 @@ TagData* create_tag_data()
     TagData *data = (TagData *)malloc(sizeof(TagData));
     if (data) 
     {
-        data->version = NULL;
-        data->title = NULL;
-        data->artist = NULL;
-        data->album = NULL;
-        data->year = NULL;
-        data->comment = NULL;
-        data->genre = NULL;
-        // Initialize other fields as needed
+        data->arena = NULL;
+        data->arena_cap = 0;
+        clear_tag_data(data);
     }
     return data;
 }
 
+/**
+ * @brief Resets a TagData structure to an empty state.
+ *
+ * Every field is marked unset and the arena is emptied, but its capacity is
+ * kept so the structure can be recycled without further allocation.
+ *
+ * @param data Pointer to the TagData structure to be cleared.
+ */
+void clear_tag_data(TagData *data) 
+{
+    if (data) 
+    {
+        data->version[0] = '\0';
+        for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+        {
+            data->fields[i].len = TAG_VALUE_UNSET;
+        }
+        data->arena_len = 0;
+        data->dirty = 0;
+        data->art_bytes = 0;
+        data->duration = -1;
+        memset(&data->source, 0, sizeof(data->source));
+        memset(data->frame_offset, 0, sizeof(data->frame_offset));
+        memset(data->frame_length, 0, sizeof(data->frame_length));
+    }
+}
+
+/**
+ * @brief Copies one TagData structure into another.
+ *
+ * Inline values are copied as they are, and the used part of the source arena
+ * is copied in one block so spilled values keep their offsets.
+ *
+ * @param dst Destination TagData.
+ * @param src Source TagData.
+ * @return 0 on success, -1 if the destination arena could not be grown.
+ */
+int copy_tag_data(TagData *dst, const TagData *src) 
+{
+    if (src->arena_len > dst->arena_cap) 
+    {
+        char *arena = (char *)realloc(dst->arena, src->arena_len);
+        if (!arena) return -1;
+        dst->arena = arena;
+        dst->arena_cap = src->arena_len;
+    }
+    memcpy(dst->version, src->version, sizeof(dst->version));
+    memcpy(dst->fields, src->fields, sizeof(dst->fields));
+    if (src->arena_len) memcpy(dst->arena, src->arena, src->arena_len);
+    dst->arena_len = src->arena_len;
+    dst->dirty = src->dirty;
+    dst->art_bytes = src->art_bytes;
+    dst->duration = src->duration;
+    dst->source = src->source;
+    memcpy(dst->frame_offset, src->frame_offset, sizeof(dst->frame_offset));
+    memcpy(dst->frame_length, src->frame_length, sizeof(dst->frame_length));
+    return 0;
+}
+
 /**
  * @brief Frees memory allocated for a TagData structure.
  *
- * This function deallocates all dynamically allocated memory within
- * a TagData structure, including each individual string field. Finally,
- * it frees the TagData structure itself.
+ * This function deallocates the arena holding long field values and
+ * then the TagData structure itself.
  *
  * @param data Pointer to the TagData structure to be freed.
  */
@@ -41,14 +116,205 @@ void free_tag_data(TagData *data)
 {
     if (data) 
     {
-        free(data->version);
-        free(data->title);
-        free(data->artist);
-        free(data->album);
-        free(data->year);
-        free(data->comment);
-        free(data->genre);
-        // Free other fields as needed
+        free(data->arena);
         free(data);
     }
 }
+
+const char *tag_get(const TagData *data, TagField field)
+{
+    const TagValue *v = &data->fields[field];
+    if (v->len == TAG_VALUE_UNSET) return NULL;
+    if (v->len == TAG_VALUE_SPILLED) return data->arena + v->u.spill.offset;
+    return v->u.text;
+}
+
+size_t tag_length(const TagData *data, TagField field)
+{
+    const TagValue *v = &data->fields[field];
+    if (v->len == TAG_VALUE_UNSET) return 0;
+    if (v->len == TAG_VALUE_SPILLED) return v->u.spill.length;
+    return v->len;
+}
+
+int tag_set(TagData *data, TagField field, const char *value)
+{
+    if (!value) 
+    {
+        if (data->fields[field].len != TAG_VALUE_UNSET) data->dirty |= 1u << field;
+        data->fields[field].len = TAG_VALUE_UNSET;
+        return 0;
+    }
+    return tag_set_n(data, field, value, strlen(value));
+}
+
+int tag_set_n(TagData *data, TagField field, const char *value, size_t len)
+{
+    TagValue *v = &data->fields[field];
+    const char *old = tag_get(data, field);
+    if (old && tag_length(data, field) == len && memcmp(old, value, len) == 0) 
+    {
+        return 0; // Unchanged, so not dirty
+    }
+    if (len <= TAG_INLINE_MAX) 
+    {
+        memmove(v->u.text, value, len);
+        v->u.text[len] = '\0';
+        v->len = (unsigned char)len;
+        data->dirty |= 1u << field;
+        return 0;
+    }
+    if (len > ID3_MAX_TAG_SIZE) return -1;
+
+    // Reuse the field's arena space when the new value fits; memmove because the
+    // value may be a part of the old one.
+    if (v->len == TAG_VALUE_SPILLED && v->u.spill.capacity >= len) 
+    {
+        char *slot = data->arena + v->u.spill.offset;
+        memmove(slot, value, len);
+        slot[len] = '\0';
+        v->u.spill.length = (unsigned int)len;
+        data->dirty |= 1u << field;
+        return 0;
+    }
+
+    // Otherwise append it; space held by a replaced value is reclaimed when the
+    // TagData is cleared.
+    size_t need = data->arena_len + len + 1;
+    if (need > data->arena_cap) 
+    {
+        // The value may live in the arena that is about to move.
+        int inside = data->arena && value >= data->arena && value < data->arena + data->arena_cap;
+        size_t value_offset = inside ? (size_t)(value - data->arena) : 0;
+        size_t cap = data->arena_cap ? data->arena_cap : 256;
+        while (cap < need) cap *= 2;
+        char *arena = (char *)realloc(data->arena, cap);
+        if (!arena) return -1;
+        data->arena = arena;
+        data->arena_cap = cap;
+        if (inside) value = arena + value_offset;
+    }
+    memcpy(data->arena + data->arena_len, value, len);
+    data->arena[data->arena_len + len] = '\0';
+    v->u.spill.offset = (unsigned int)data->arena_len;
+    v->u.spill.length = (unsigned int)len;
+    v->u.spill.capacity = (unsigned int)len;
+    v->len = TAG_VALUE_SPILLED;
+    data->arena_len = need;
+    data->dirty |= 1u << field;
+    return 0;
+}
+
+void tag_mark_clean(TagData *data)
+{
+    data->dirty = 0;
+}
+
+void tag_set_version(TagData *data, const char *version)
+{
+    snprintf(data->version, sizeof(data->version), "%s", version);
+}
+
+unsigned int tag_diff_mask(const TagData *a, const TagData *b)
+{
+    unsigned int mask = 0;
+    for (int i = 0; i < TAG_FIELD_COUNT; i++)
+    {
+        const char *va = tag_get(a, (TagField)i);
+        const char *vb = tag_get(b, (TagField)i);
+        if (!va && !vb) continue;
+        if (!va || !vb || tag_length(a, (TagField)i) != tag_length(b, (TagField)i) ||
+            memcmp(va, vb, tag_length(a, (TagField)i)) != 0)
+        {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+const char *tag_field_name(TagField field)
+{
+    return tag_fields[field].name;
+}
+
+const char *tag_field_frame_id(TagField field)
+{
+    return tag_fields[field].frame_id;
+}
+
+int tag_field_from_name(const char *name)
+{
+    for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+    {
+        if (strcmp(name, tag_fields[i].name) == 0) return i;
+    }
+    return -1;
+}
+
+int tag_field_from_frame_id(const unsigned char *frame_id)
+{
+    for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+    {
+        if (memcmp(frame_id, tag_fields[i].frame_id, 4) == 0) return i;
+    }
+    return -1;
+}
+
+unsigned int id3_syncsafe_decode(const unsigned char bytes[4])
+{
+    return ((unsigned int)(bytes[0] & 0x7F) << 21) |
+           ((unsigned int)(bytes[1] & 0x7F) << 14) |
+           ((unsigned int)(bytes[2] & 0x7F) << 7)  |
+            (unsigned int)(bytes[3] & 0x7F);
+}
+
+void id3_syncsafe_encode(unsigned int value, unsigned char bytes[4])
+{
+    bytes[0] = (value >> 21) & 0x7F;
+    bytes[1] = (value >> 14) & 0x7F;
+    bytes[2] = (value >> 7) & 0x7F;
+    bytes[3] = value & 0x7F;
+}
+
+unsigned int id3_be32_decode(const unsigned char bytes[4])
+{
+    return ((unsigned int)bytes[0] << 24) |
+           ((unsigned int)bytes[1] << 16) |
+           ((unsigned int)bytes[2] << 8)  |
+            (unsigned int)bytes[3];
+}
+
+unsigned long long id3_hash64(const void *data, size_t len, unsigned long long seed)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    unsigned long long h = seed;
+    // FNV-1a over little-endian 64-bit words, then over the remaining bytes.
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        unsigned long long w = 0;
+        for (int i = 7; i >= 0; i--) w = (w << 8) | p[i];
+        h = (h ^ w) * 0x100000001B3ULL;
+        h ^= h >> 29;
+    }
+    for (; len > 0; p++, len--)
+    {
+        h = (h ^ *p) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+unsigned int id3_random(void)
+{
+    static _Thread_local unsigned int state;
+    if (state == 0)
+    {
+        // The address of the state differs between threads; the clock between runs.
+        unsigned long long seed = (unsigned long long)(uintptr_t)&state ^ (unsigned long long)time(NULL) ^ (unsigned long long)clock();
+        state = (unsigned int)(seed ^ (seed >> 32)) | 1u;
+    }
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
@@ -3,19 +3,90 @@
 
 #include <stdlib.h>
 
+#define ID3_HEADER_SIZE       10         /**< Size of the "ID3" tag header */
+#define FRAME_HEADER_SIZE     10         /**< Size of an ID3v2.3 frame header */
+#define ID3_MAX_TAG_SIZE      0x0FFFFFFF /**< Largest size a 28-bit sync-safe integer can hold */
+
+#define TAG_INLINE_MAX        31         /**< Longest value stored inline, excluding the NUL */
+#define TAG_VALUE_UNSET       0xFF       /**< TagValue.len marker: field has no value */
+#define TAG_VALUE_SPILLED     0xFE       /**< TagValue.len marker: value lives in the arena */
+
+/**
+ * @brief Text fields held in a TagData structure.
+ */
+typedef enum 
+{
+    TAG_TITLE = 0, /**< Title of the song (TIT2) */
+    TAG_ARTIST,    /**< Artist of the song (TPE1) */
+    TAG_ALBUM,     /**< Album name (TALB) */
+    TAG_YEAR,      /**< Year of release (TYER) */
+    TAG_COMMENT,   /**< Comment (COMM) */
+    TAG_GENRE,     /**< Genre (TCON) */
+    TAG_TRACK,     /**< Track number, optionally "n/total" (TRCK) */
+    // Add other fields as needed
+    TAG_FIELD_COUNT
+} TagField;
+
+/**
+ * @brief A single field value, stored inline when short.
+ *
+ * Values of up to TAG_INLINE_MAX bytes are kept NUL-terminated in @c u.text with
+ * their length in @c len. Longer values are appended to the owning TagData's arena
+ * and referenced by offset, so moving or recycling the TagData never leaves
+ * dangling pointers. A later value that fits in the space already reserved for
+ * the field reuses it.
+ */
+typedef struct 
+{
+    union 
+    {
+        char text[TAG_INLINE_MAX + 1]; /**< Inline NUL-terminated value */
+        struct 
+        {
+            unsigned int offset;       /**< Offset of the value in the arena */
+            unsigned int length;       /**< Length of the value in bytes */
+            unsigned int capacity;     /**< Bytes reserved at offset, excluding the NUL */
+        } spill;
+    } u;
+    unsigned char len;                 /**< Inline length, TAG_VALUE_UNSET or TAG_VALUE_SPILLED */
+} TagValue;
+
+/**
+ * @brief Identity of the file a tag was read from, used to detect concurrent changes.
+ */
+typedef struct 
+{
+    unsigned long long dev;            /**< Device of the file */
+    unsigned long long ino;            /**< Inode of the file */
+    long long size;                    /**< File size in bytes */
+    long long mtime_ns;                /**< Modification time in nanoseconds */
+    unsigned long long tag_hash;       /**< id3_hash64() of the raw tag, header included */
+} Id3FileStamp;
+
 /**
  * @brief Structure to hold ID3 tag data.
+ *
+ * Fields are read and written through tag_get() and tag_set(). The arena only
+ * grows when a value does not fit inline and keeps its capacity when the
+ * structure is cleared, so a recycled TagData normally needs no allocation.
+ *
+ * tag_set() marks a field dirty only when its value actually changes. For tags
+ * read from a file, the reader records where each field's frame content lies so
+ * a changed value of the same length can be patched in place.
  */
 typedef struct 
 {
-    char *version; /**< Version of the ID3 tag */
-    char *title;   /**< Title of the song */
-    char *artist;  /**< Artist of the song */
-    char *album;   /**< Album name */
-    char *year;    /**< Year of release */
-    char *comment; /**< Comment */
-    char *genre;   /**< Genre */
-    // Add other fields as needed
+    char version[16];                  /**< Version of the ID3 tag */
+    TagValue fields[TAG_FIELD_COUNT];  /**< Field values indexed by TagField */
+    char *arena;                       /**< Storage for values longer than TAG_INLINE_MAX */
+    size_t arena_len;                  /**< Bytes of the arena in use */
+    size_t arena_cap;                  /**< Capacity of the arena */
+    unsigned int dirty;                /**< Bit (1u << TagField) per field changed since it was read */
+    unsigned int frame_offset[TAG_FIELD_COUNT]; /**< File offset of the field's frame content, 0 if unknown */
+    unsigned int frame_length[TAG_FIELD_COUNT]; /**< Length of the value the frame held when read */
+    size_t art_bytes;                  /**< Total size of embedded picture (APIC) frames */
+    int duration;                      /**< Playing time in seconds, or -1 if not known */
+    Id3FileStamp source;               /**< File the tag was read from (all zero if none) */
 } TagData;
 
 /**
@@ -25,4 +96,179 @@ typedef struct
  */
 TagData* create_tag_data();
 
+/**
+ * @brief Resets every field of a TagData structure to unset.
+ *
+ * The structure and its arena stay allocated so they can be reused.
+ *
+ * @param data Pointer to the TagData structure to clear (may be NULL).
+ */
+void clear_tag_data(TagData *data);
+
+/**
+ * @brief Copies every field and the version of one TagData into another.
+ *
+ * The destination's arena is reused and only grows when it is too small.
+ *
+ * @param dst Destination TagData; its previous contents are replaced.
+ * @param src Source TagData.
+ * @return 0 on success, -1 if the destination arena could not be grown.
+ */
+int copy_tag_data(TagData *dst, const TagData *src);
+
+/**
+ * @brief Frees a TagData structure and its arena.
+ *
+ * @param data Pointer to the TagData structure to free (may be NULL).
+ */
+void free_tag_data(TagData *data);
+
+/**
+ * @brief Returns the value of a field.
+ *
+ * @param data  TagData to read from.
+ * @param field Field to look up.
+ * @return NUL-terminated value owned by @p data, or NULL if the field is unset.
+ */
+const char *tag_get(const TagData *data, TagField field);
+
+/**
+ * @brief Returns the length in bytes of a field value (0 if unset).
+ *
+ * @param data  TagData to read from.
+ * @param field Field to look up.
+ * @return Length of the value, excluding the terminating NUL.
+ */
+size_t tag_length(const TagData *data, TagField field);
+
+/**
+ * @brief Sets a field to a NUL-terminated value, or unsets it when @p value is NULL.
+ *
+ * The field is marked dirty unless the new value equals the current one.
+ *
+ * @param data  TagData to modify.
+ * @param field Field to set.
+ * @param value New value, copied into @p data.
+ * @return 0 on success, -1 if the arena could not be grown.
+ */
+int tag_set(TagData *data, TagField field, const char *value);
+
+/**
+ * @brief Sets a field to the first @p len bytes of @p value.
+ *
+ * @p value may point into @p data itself, e.g. at the value of another field.
+ *
+ * @param data  TagData to modify.
+ * @param field Field to set.
+ * @param value Bytes of the new value; need not be NUL-terminated.
+ * @param len   Number of bytes to copy.
+ * @return 0 on success, -1 if the arena could not be grown or @p len is too large.
+ */
+int tag_set_n(TagData *data, TagField field, const char *value, size_t len);
+
+/**
+ * @brief Forgets all changes, e.g. once a tag has been read or written.
+ *
+ * @param data TagData whose dirty mask is cleared.
+ */
+void tag_mark_clean(TagData *data);
+
+/**
+ * @brief Sets the version string reported for the tag (truncated to fit).
+ *
+ * @param data    TagData to modify.
+ * @param version Version text such as "ID3v2.3.0".
+ */
+void tag_set_version(TagData *data, const char *version);
+
+/**
+ * @brief Compares two tags field by field.
+ *
+ * @param a First tag.
+ * @param b Second tag.
+ * @return Bit (1u << TagField) for every field whose value differs (set vs unset counts).
+ */
+unsigned int tag_diff_mask(const TagData *a, const TagData *b);
+
+/**
+ * @brief Returns the command-line name of a field, e.g. "title".
+ *
+ * @param field Field to name.
+ * @return Static lowercase name.
+ */
+const char *tag_field_name(TagField field);
+
+/**
+ * @brief Returns the 4-character ID3v2.3 frame ID a field is stored in, e.g. "TIT2".
+ *
+ * @param field Field to look up.
+ * @return Static frame ID string.
+ */
+const char *tag_field_frame_id(TagField field);
+
+/**
+ * @brief Looks up a field by its command-line name.
+ *
+ * @param name Field name such as "artist".
+ * @return The matching TagField, or -1 if @p name is not a known field.
+ */
+int tag_field_from_name(const char *name);
+
+/**
+ * @brief Looks up a field by the frame ID it is stored in.
+ *
+ * @param frame_id Four bytes of a frame header.
+ * @return The matching TagField, or -1 if the frame is not a known text field.
+ */
+int tag_field_from_frame_id(const unsigned char *frame_id);
+
+/**
+ * @brief Decodes a 28-bit sync-safe integer (7 bits per byte) as used by the tag header.
+ *
+ * @param bytes Four encoded bytes.
+ * @return The decoded value.
+ */
+unsigned int id3_syncsafe_decode(const unsigned char bytes[4]);
+
+/**
+ * @brief Encodes a value of at most ID3_MAX_TAG_SIZE as a 28-bit sync-safe integer.
+ *
+ * @param value Value to encode.
+ * @param bytes Destination for the four encoded bytes.
+ */
+void id3_syncsafe_encode(unsigned int value, unsigned char bytes[4]);
+
+/**
+ * @brief Decodes a 32-bit big-endian integer as used by ID3v2.3 frame sizes.
+ *
+ * @param bytes Four encoded bytes.
+ * @return The decoded value.
+ */
+unsigned int id3_be32_decode(const unsigned char bytes[4]);
+
+/**
+ * @brief Hashes a byte string, eight bytes at a time.
+ *
+ * The result does not depend on the host's byte order, so it can be stored and
+ * compared across machines.
+ *
+ * @param data Bytes to hash.
+ * @param len  Number of bytes.
+ * @param seed Initial value, or the result of a previous call to continue a hash.
+ * @return 64-bit hash.
+ */
+unsigned long long id3_hash64(const void *data, size_t len, unsigned long long seed);
+
+#define ID3_HASH64_SEED 0xCBF29CE484222325ULL /**< Initial value for id3_hash64() */
+
+/**
+ * @brief Returns a pseudo-random number for backoff jitter.
+ *
+ * Each thread has its own xorshift generator, seeded on first use, so threads
+ * neither contend on shared state nor draw the same sequence as rand() would.
+ *
+ * @return A pseudo-random 32-bit value.
+ */
+unsigned int id3_random(void);
+
 #endif // ID3_UTILS_H
@@ -3,134 +3,718 @@
  * @brief Implementation of functions for writing and editing ID3 tags in MP3 files.
  */
 
+ #define _GNU_SOURCE
+ #define _FILE_OFFSET_BITS 64
+
+ #include <errno.h>
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/ioctl.h>
+ #include <sys/stat.h>
+ #include <sys/statvfs.h>
+ #include <linux/fiemap.h>
+ #include <linux/fs.h>
  #include "id3_writer.h"
+ #include "id3_batch.h"
+ #include "id3_io.h"
+ #include "id3_lock.h"
+ #include "id3_checkpoint.h"
  #include "id3_reader.h"
+ #include "id3_parser.h"
+ #include "id3_scan.h"
  #include "id3_utils.h"
  #include "error_handling.h"
  
+ #define EDIT_MAX_ATTEMPTS 8 /**< Optimistic edits tried before giving up */
+ #define EDIT_CONFLICT     1 /**< The file changed between reading and writing */
+ #define FIEMAP_BATCH     32 /**< Extents requested per FS_IOC_FIEMAP call */
+ 
  /**
-  * @brief Writes a single ID3 frame (e.g., TIT2 for title) to the given file.
+  * @brief Serializes a single ID3 frame (e.g., TIT2 for title) into a buffer.
   *
   * This function writes a 10-byte frame header (4 bytes for frame ID, 4 bytes for content size,
   * 2 bytes for flags) followed by the content.
   *
-  * @param fp Pointer to the file where the frame should be written.
+  * @param out Destination buffer with room for the frame, or NULL to only measure it.
   * @param frame_id 4-character ID for the frame (e.g., "TIT2").
   * @param content The text content for the frame.
+  * @param content_size Length of the content in bytes.
+  * @return Number of bytes the frame occupies (0 if content is NULL).
+  */
+ size_t id3_serialize_frame(unsigned char *out, const char *frame_id, const char *content,
+                               size_t content_size) 
+ {
+     if (!content) return 0;  // Skip if content is NULL
+     if (out) 
+     {
+         // Frame header: ID (4 bytes), size (4 bytes), flags (2 bytes; here set to 0)
+         memcpy(out, frame_id, 4);
+         out[4] = (content_size >> 24) & 0xFF;
+         out[5] = (content_size >> 16) & 0xFF;
+         out[6] = (content_size >> 8) & 0xFF;
+         out[7] = content_size & 0xFF;
+         out[8] = 0;
+         out[9] = 0;
+         // Copy the frame content.
+         memcpy(out + FRAME_HEADER_SIZE, content, content_size);
+     }
+     return FRAME_HEADER_SIZE + content_size;
+ }
+ 
+ /**
+  * @brief Serializes all frames of a TagData structure.
+  *
+  * @param out Destination buffer, or NULL to only measure the frames.
+  * @param data TagData whose fields are serialized.
+  * @return Total size of the serialized frames.
+  */
+ size_t id3_serialize_frames(unsigned char *out, const TagData *data) 
+ {
+     // Fields are mapped to frame IDs by tag_field_frame_id().
+     size_t pos = 0;
+     for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+     {
+         pos += id3_serialize_frame(out ? out + pos : NULL, tag_field_frame_id((TagField)i),
+                                tag_get(data, (TagField)i), tag_length(data, (TagField)i));
+     }
+     return pos;
+ }
+ 
+ /**
+  * @brief Creates a uniquely named temporary file in the same directory as @p filename.
+  *
+  * Keeping the temporary file next to the target lets rename() replace the target
+  * atomically, and the unique name lets several files be rewritten in parallel.
+  *
+  * @param filename The file the temporary file will replace.
+  * @param temp_path Output buffer receiving the temporary file's path.
+  * @param size Size of @p temp_path.
+  * @return Descriptor of the new file, or -1 on failure.
+  */
+ static int create_temp_beside(const char *filename, char *temp_path, size_t size) 
+ {
+     const char *slash = strrchr(filename, '/');
+     int dir_len = slash ? (int)(slash - filename + 1) : 0;
+     const char *base = slash ? slash + 1 : filename;
+     if (snprintf(temp_path, size, "%.*s.%s.tmpXXXXXX", dir_len, filename, base) >= (int)size) 
+     {
+         return -1;
+     }
+     return mkstemp(temp_path);
+ }
+ 
+ /**
+  * @brief Returns non-zero if any extent of a file is shared with another file.
+  *
+  * Reflinked copies and deduplicated files share extents; rewriting such a file into a
+  * new one would give it private copies of all its blocks. Filesystems without FIEMAP
+  * report no sharing.
+  *
+  * @param fd Descriptor of the file.
+  * @return Non-zero if a shared extent was found.
+  */
+ static int has_shared_extents(int fd) 
+ {
+     struct fiemap *map = (struct fiemap *)malloc(sizeof(struct fiemap) + FIEMAP_BATCH * sizeof(struct fiemap_extent));
+     if (!map) return 0;
+     int shared = 0;
+     __u64 start = 0;
+     for (;;) 
+     {
+         memset(map, 0, sizeof(struct fiemap));
+         map->fm_start = start;
+         map->fm_length = FIEMAP_MAX_OFFSET - start;
+         map->fm_extent_count = FIEMAP_BATCH;
+         if (ioctl(fd, FS_IOC_FIEMAP, map) != 0 || map->fm_mapped_extents == 0) break;
+         const struct fiemap_extent *last = &map->fm_extents[map->fm_mapped_extents - 1];
+         for (unsigned int i = 0; i < map->fm_mapped_extents && !shared; i++) 
+         {
+             shared = (map->fm_extents[i].fe_flags & FIEMAP_EXTENT_SHARED) != 0;
+         }
+         if (shared || (last->fe_flags & FIEMAP_EXTENT_LAST)) break;
+         start = last->fe_logical + last->fe_length;
+     }
+     free(map);
+     return shared;
+ }
+ 
+ /**
+  * @brief Grows the tag of a file in place by inserting whole blocks in front of it.
+  *
+  * FALLOC_FL_INSERT_RANGE shifts the file's data up without copying it, so the audio keeps
+  * its extents, including any shared with other files, and the inode and its hardlinks
+  * are unchanged. Only the blocks holding the new tag are written.
+  *
+  * @param fd Writable descriptor of the file.
+  * @param st Status of the file.
+  * @param block Complete tag block.
+  * @param len Length of @p block, larger than @p audio_start.
+  * @param audio_start Offset the audio starts at.
+  * @return 0 on success, 1 if the filesystem cannot insert ranges here, -1 on failure.
   */
- static void write_frame(FILE *fp, const char *frame_id, const char *content) 
+ static int insert_tag_range(int fd, const struct stat *st, const unsigned char *block, size_t len,
+                             off_t audio_start) 
  {
-     if (!content) return;  // Skip if content is NULL
-     int content_size = strlen(content);
-     unsigned char size_bytes[4];
-     size_bytes[0] = (content_size >> 24) & 0xFF;
-     size_bytes[1] = (content_size >> 16) & 0xFF;
-     size_bytes[2] = (content_size >> 8) & 0xFF;
-     size_bytes[3] = content_size & 0xFF;
-     // Write frame header: ID (4 bytes), size (4 bytes), flags (2 bytes; here set to 0)
-     fwrite(frame_id, 1, 4, fp);
-     fwrite(size_bytes, 1, 4, fp);
-     unsigned char flags[2] = {0, 0};
-     fwrite(flags, 1, 2, fp);
-     // Write the frame content.
-     fwrite(content, 1, content_size, fp);
+     // Ranges must be aligned to the filesystem block size, which st_blksize (the preferred
+     // I/O size) need not be.
+     struct statvfs vfs;
+     off_t blk = fstatvfs(fd, &vfs) == 0 && vfs.f_bsize > 0 ? (off_t)vfs.f_bsize : 4096;
+     off_t grow = ((off_t)len - audio_start + blk - 1) / blk * blk;
+     if (st->st_size == 0 || fallocate(fd, FALLOC_FL_INSERT_RANGE, 0, grow) != 0) 
+     {
+         return st->st_size == 0 || errno == EOPNOTSUPP || errno == EINVAL || errno == ENOSYS ? 1 : -1;
+     }
+     
+     // The new tag covers the inserted blocks and the old tag; what it does not fill is padding.
+     off_t total = grow + audio_start;
+     unsigned char header[ID3_HEADER_SIZE];
+     memcpy(header, block, ID3_HEADER_SIZE);
+     id3_syncsafe_encode((unsigned int)(total - ID3_HEADER_SIZE), &header[6]);
+     int ret = id3_pwrite_full(fd, header, sizeof(header), 0);
+     if (ret == 0) ret = id3_pwrite_full(fd, block + ID3_HEADER_SIZE, len - ID3_HEADER_SIZE, ID3_HEADER_SIZE);
+     if (ret == 0) ret = id3_pwrite_zeros(fd, total - (off_t)len, (off_t)len);
+     return ret == 0 ? 0 : -1;
  }
  
  /**
-  * @brief Writes the ID3 tags to an MP3 file by rewriting the file with updated frames.
+  * @brief Replaces the tag of an MP3 file with a complete tag block, using the cheapest safe strategy.
   *
-  * This function opens the original MP3 file and creates a temporary file.
-  * It copies the ID3 header (first 10 bytes), writes updated tag frames using the values
-  * from the TagData structure, then copies the remainder of the original file.
-  * Finally, it replaces the original file with the temporary file.
+  * If the file already has a tag at least as large as @p block, the block is written over
+  * it in place, its header size is set to the old tag size and the remainder is zeroed as
+  * padding, leaving the audio untouched. Otherwise a temporary file is created next to the
+  * original, the block and the audio that followed the original tag are written to it, and
+  * it is renamed over the original. All offsets are 64-bit and all I/O is positioned, so
+  * files larger than 2 GB are handled.
+  *
+  * Renaming gives the file a new inode, which would detach it from its other hardlinks and
+  * from extents it shares with reflinked or deduplicated copies. Such files are grown with
+  * insert_tag_range() instead, and hardlinked files on filesystems that cannot insert ranges
+  * have the new content copied back over the original inode. Unlike a rename, that copy is
+  * not atomic: the temporary file is synced before it and kept if it fails, and the
+  * original is synced after it.
   *
   * @param filename The name of the MP3 file to update.
-  * @param data Pointer to the TagData structure containing the new tag values.
+  * @param block Complete tag: a 10-byte ID3 header followed by its frames.
+  * @param len Length of @p block; the header's size field is ignored in favour of it.
   * @return 0 on success, non-zero on failure.
   */
- int write_id3_tags(const char *filename, const TagData *data) 
+ static int replace_tag_block(const char *filename, const unsigned char *block, size_t len) 
  {
-     if (!check_id3_tag_presence(filename)) 
+     // Open for writing if possible so the tag can be updated in place.
+     int writable = 1;
+     int fd_orig = id3_open(filename, O_RDWR, 0);
+     if (fd_orig < 0) 
      {
-         display_error("File does not appear to be an MP3 file.");
+         writable = 0;
+         fd_orig = id3_open(filename, O_RDONLY, 0);
+     }
+     if (fd_orig < 0) 
+     {
+         display_error("Cannot open original file for reading.");
          return -1;
      }
      
-     FILE *fp_orig = fopen(filename, "rb");
-     if (!fp_orig) 
+     struct stat st;
+     unsigned char header[ID3_HEADER_SIZE];
+     if (fstat(fd_orig, &st) != 0 ||
+         id3_pread_full(fd_orig, header, sizeof(header), 0) != 0) 
      {
-         display_error("Cannot open original file for reading.");
+         close(fd_orig);
+         display_error("Failed to read ID3 header.");
          return -1;
      }
      
-     FILE *fp_temp = fopen("temp.mp3", "wb+");
-     if (!fp_temp) 
+     // The audio starts right after the existing tag, or at offset 0 if there is none.
+     off_t audio_start = 0;
+     int has_tag = memcmp(header, "ID3", 3) == 0;
+     if (has_tag) 
+     {
+         audio_start = (off_t)ID3_HEADER_SIZE + id3_syncsafe_decode(&header[6]);
+         if (audio_start > st.st_size) 
+         {
+             close(fd_orig);
+             display_error("ID3 tag extends past the end of the file.");
+             return -1;
+         }
+     }
+     
+     // In place when the new block fits in the existing tag; the rest becomes padding.
+     int in_place = writable && has_tag && (off_t)len <= audio_start;
+     off_t total = in_place ? audio_start : (off_t)len;
+     memcpy(header, block, ID3_HEADER_SIZE);
+     id3_syncsafe_encode((unsigned int)(total - ID3_HEADER_SIZE), &header[6]);
+     
+     if (in_place) 
      {
-         fclose(fp_orig);
+         int ret = id3_pwrite_full(fd_orig, header, sizeof(header), 0);
+         if (ret == 0) ret = id3_pwrite_full(fd_orig, block + ID3_HEADER_SIZE, len - ID3_HEADER_SIZE, ID3_HEADER_SIZE);
+         if (ret == 0) ret = id3_pwrite_zeros(fd_orig, total - (off_t)len, (off_t)len);
+         if (close(fd_orig) != 0) ret = -1;
+         if (ret != 0) display_error("Failed to write tag in place.");
+         return ret;
+     }
+     
+     int hardlinked = writable && st.st_nlink > 1;
+     if (hardlinked || (writable && has_shared_extents(fd_orig))) 
+     {
+         int ret = insert_tag_range(fd_orig, &st, block, len, audio_start);
+         if (ret <= 0) 
+         {
+             if (close(fd_orig) != 0) ret = -1;
+             if (ret != 0) display_error("Failed to grow tag in place.");
+             return ret;
+         }
+         // Without insert ranges, extents cannot be kept; hardlinks still can.
+     }
+     
+     char temp_path[4096];
+     int fd_temp = create_temp_beside(filename, temp_path, sizeof(temp_path));
+     if (fd_temp < 0) 
+     {
+         close(fd_orig);
          display_error("Cannot open temporary file for writing.");
          return -1;
      }
      
-     // Copy the ID3 header (first 10 bytes) from the original file.
-     unsigned char header[10];
-     if (fread(header, 1, 10, fp_orig) != 10) 
+     // Keep the original permissions, then write the new tag and copy the audio.
+     int ret = fchmod(fd_temp, st.st_mode & 07777);
+     if (ret == 0) ret = id3_pwrite_full(fd_temp, header, sizeof(header), 0);
+     if (ret == 0) ret = id3_pwrite_full(fd_temp, block + ID3_HEADER_SIZE, len - ID3_HEADER_SIZE, ID3_HEADER_SIZE);
+     if (ret == 0) 
      {
-         fclose(fp_orig);
-         fclose(fp_temp);
-         display_error("Failed to read ID3 header.");
+         ret = id3_copy_range(fd_orig, audio_start, fd_temp, total, st.st_size - audio_start);
+     }
+     
+     if (ret == 0 && hardlinked) 
+     {
+         // Copy the new content over the original so every name of the file sees it. This
+         // overwrites the original in place and is not atomic, so the temporary file is made
+         // durable first: if the copy is interrupted, it still holds the complete new content.
+         // The copy must not be cut short by the file's time budget either.
+         id3_io_set_deadline(0);
+         if (fsync(fd_temp) != 0) ret = -1;
+         if (ret == 0) ret = id3_copy_range(fd_temp, 0, fd_orig, 0, total + st.st_size - audio_start);
+         if (ret == 0 && fsync(fd_orig) != 0) ret = -1;
+         if (close(fd_orig) != 0) ret = -1;
+         close(fd_temp);
+         if (ret != 0) 
+         {
+             fprintf(stderr, "Error: Failed to rewrite %s in place; its new content is kept in %s\n",
+                     filename, temp_path);
+             return -1;
+         }
+         unlink(temp_path);
+         return 0;
+     }
+     
+     close(fd_orig);
+     if (close(fd_temp) != 0) ret = -1;
+     if (ret != 0) 
+     {
+         unlink(temp_path);
+         display_error("Failed to write temporary file.");
          return -1;
      }
-     fwrite(header, 1, 10, fp_temp);
      
-     // Write new tag frames based on the TagData.
-     // You can adjust the mapping of fields to frame IDs as needed.
-     write_frame(fp_temp, "TIT2", data->title);   // Title frame
-     write_frame(fp_temp, "TPE1", data->artist);  // Artist frame
-     write_frame(fp_temp, "TALB", data->album);   // Album frame
-     write_frame(fp_temp, "TYER", data->year);    // Year frame
-     write_frame(fp_temp, "COMM", data->comment); // Comment frame
-     write_frame(fp_temp, "TCON", data->genre);   // Genre frame
+     // Atomically replace the original file with the temporary file.
+     if (rename(temp_path, filename) != 0) 
+     {
+         unlink(temp_path);
+         display_error("Failed to rename temporary file.");
+         return -1;
+     }
      
-     // Now, skip the old tag section in the original file.
-     // For this simplified example, we assume that the original tag frames end at position X.
-     // In a full implementation, you would parse the tag header to determine the tag size.
-     // Here, we'll simply seek to a fixed position (for example, after 300 bytes) for demonstration.
-     fseek(fp_orig, 300, SEEK_SET);
+     return 0;
+ }
+ 
+ /**
+  * @brief Reads the body of a file's current tag, the bytes after its 10-byte header.
+  *
+  * @param fd Descriptor of the file.
+  * @param hdr Output for the tag's header.
+  * @param body Output: the body, in @p pool's I/O buffer or malloc()ed without a pool,
+  *             or NULL if the file has no tag this writer can splice into.
+  * @return 0 on success (including when there is no tag), -1 on a read failure.
+  */
+ static int read_tag_body(Id3Pool *pool, int fd, Id3Header *hdr, unsigned char **body) 
+ {
+     unsigned char header[ID3_HEADER_SIZE];
+     *body = NULL;
+     if (id3_pread_full(fd, header, sizeof(header), 0) != 0 ||
+         id3_parse_header(header, sizeof(header), hdr) != ID3_PARSE_OK) 
+     {
+         return 0;
+     }
+     unsigned char *buf = pool ? id3_pool_io_buffer(pool, hdr->tag_size + 1)
+                               : (unsigned char *)malloc(hdr->tag_size + 1);
+     if (!buf || id3_pread_full(fd, buf, hdr->tag_size, ID3_HEADER_SIZE) != 0) 
+     {
+         if (!pool) free(buf);
+         return -1;
+     }
+     *body = buf;
+     return 0;
+ }
+ 
+ /**
+  * @brief Serializes a text frame of a known field in the layout of tag version @p major.
+  */
+ static size_t splice_frame(unsigned char *out, int major, TagField field, const TagData *data) 
+ {
+     size_t size = id3_serialize_frame(out, tag_field_frame_id(field), tag_get(data, field),
+                                       tag_length(data, field));
+     // v2.4 frame sizes are sync-safe.
+     if (out && size && major == 4) id3_syncsafe_encode((unsigned int)(size - FRAME_HEADER_SIZE), &out[4]);
+     return size;
+ }
+ 
+ /**
+  * @brief Rebuilds the frames of an existing tag with the values of a TagData structure.
+  *
+  * Frames of known fields are replaced by the current values, in their original
+  * position, or dropped if the field is no longer set; known fields the tag did not
+  * have are appended. Every other frame (pictures, comments with descriptions,
+  * private frames...) is copied verbatim. The extended header and padding are
+  * dropped. A v2.3 tag unsynchronised as a whole must be decoded first.
+  *
+  * @param out Destination buffer, or NULL to only measure the frames.
+  * @param hdr Header of the existing tag.
+  * @param body Existing frames, @p len bytes.
+  * @param len Length of @p body.
+  * @param data TagData holding the new values.
+  * @return Total size of the rebuilt frames.
+  */
+ static size_t splice_frames(unsigned char *out, const Id3Header *hdr, const unsigned char *body,
+                             size_t len, const TagData *data) 
+ {
+     size_t pos = 0, w = 0;
+     unsigned int written = 0;
+     if (hdr->flags & 0x40) 
+     {
+         size_t ext = len < 4 ? len : hdr->major == 4 ? id3_syncsafe_decode(body) : (size_t)id3_be32_decode(body) + 4;
+         pos = ext < len ? ext : len;
+     }
      
-     // Copy the remainder of the original file.
-     char buffer[1024];
-     size_t bytes;
-     while ((bytes = fread(buffer, 1, sizeof(buffer), fp_orig)) > 0) 
+     while (len - pos >= FRAME_HEADER_SIZE) 
      {
-         fwrite(buffer, 1, bytes, fp_temp);
+         const unsigned char *frame = body + pos;
+         // Padding, or bytes that cannot start a frame, end the frame list.
+         int valid = 1;
+         for (int i = 0; i < 4; i++) 
+         {
+             if (!((frame[i] >= 'A' && frame[i] <= 'Z') || (frame[i] >= '0' && frame[i] <= '9'))) valid = 0;
+         }
+         if (!valid) break;
+         size_t size = hdr->major == 4 ? id3_syncsafe_decode(&frame[4]) : id3_be32_decode(&frame[4]);
+         // A frame running past the tag ends it, as it does for the parser.
+         if (size > len - pos - FRAME_HEADER_SIZE) break;
+         int field = tag_field_from_frame_id(frame);
+         if (field < 0) 
+         {
+             if (out) memcpy(out + w, frame, FRAME_HEADER_SIZE + size);
+             w += FRAME_HEADER_SIZE + size;
+         }
+         else if (!(written & (1u << field))) 
+         {
+             w += splice_frame(out ? out + w : NULL, hdr->major, (TagField)field, data);
+             written |= 1u << field;
+         }
+         pos += FRAME_HEADER_SIZE + size;
      }
      
-     fclose(fp_orig);
-     fclose(fp_temp);
+     for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+     {
+         if (!(written & (1u << i))) w += splice_frame(out ? out + w : NULL, hdr->major, (TagField)i, data);
+     }
+     return w;
+ }
+ 
+ /**
+  * @brief Reverses the unsynchronisation of a v2.3 tag: every FF 00 becomes FF.
+  *
+  * @return The decoded length.
+  */
+ static size_t remove_unsync(unsigned char *buf, size_t len) 
+ {
+     size_t w = 0;
+     for (size_t r = 0; r < len; r++) 
+     {
+         buf[w++] = buf[r];
+         if (buf[r] == 0xFF && r + 1 < len && buf[r + 1] == 0) r++;
+     }
+     return w;
+ }
+ 
+ /**
+  * @brief Writes the ID3 tags to an MP3 file.
+  *
+  * If the file already has a v2.3 or v2.4 tag, its frames are rebuilt with
+  * splice_frames(): known fields take the values from the TagData structure and
+  * every other frame, such as attached pictures, is kept as it is. The tag keeps
+  * its version, with no header flags set. A file without a tag gets a v2.3 tag
+  * holding the known fields. The block is committed with replace_tag_block(),
+  * which updates the tag in place when it fits. With a pool, the buffers are
+  * reused across calls.
+  *
+  * @param pool Per-worker pool to draw the buffers from, or NULL.
+  * @param filename The name of the MP3 file to update.
+  * @param data Pointer to the TagData structure containing the new tag values.
+  * @return 0 on success, non-zero on failure.
+  */
+ int write_id3_tags_pooled(Id3Pool *pool, const char *filename, const TagData *data) 
+ {
+     if (!check_id3_tag_presence(filename)) 
+     {
+         display_error("File does not appear to be an MP3 file.");
+         return -1;
+     }
      
-     // Replace the original file with the temporary file.
-     if (remove(filename) != 0) 
+     int fd = id3_open(filename, O_RDONLY, 0);
+     Id3Header hdr;
+     unsigned char *body = NULL;
+     if (fd < 0 || read_tag_body(pool, fd, &hdr, &body) != 0) 
      {
-         display_error("Failed to remove original file.");
+         if (fd >= 0) close(fd);
+         display_error("Failed to read the existing tag.");
          return -1;
      }
-     if (rename("temp.mp3", filename) != 0) 
+     close(fd);
+     size_t body_len = 0;
+     if (body) 
      {
-         display_error("Failed to rename temporary file.");
+         body_len = hdr.major == 3 && (hdr.flags & 0x80) ? remove_unsync(body, hdr.tag_size) : hdr.tag_size;
+     }
+     
+     size_t frames_size = body ? splice_frames(NULL, &hdr, body, body_len, data) : id3_serialize_frames(NULL, data);
+     size_t total = ID3_HEADER_SIZE + frames_size;
+     unsigned char *buf = frames_size > ID3_MAX_TAG_SIZE ? NULL
+                        : pool ? id3_pool_serializer_buffer(pool, total)
+                               : (unsigned char *)malloc(total);
+     if (!buf) 
+     {
+         if (!pool) free(body);
+         display_error(frames_size > ID3_MAX_TAG_SIZE ? "Tag data is too large." : "Memory allocation failed.");
          return -1;
      }
+     memcpy(buf, "ID3", 3);
+     buf[3] = body ? hdr.major : 3;
+     buf[4] = 0;
+     buf[5] = 0;
+     id3_syncsafe_encode((unsigned int)frames_size, &buf[6]);
+     if (body) splice_frames(buf + ID3_HEADER_SIZE, &hdr, body, body_len, data);
+     else id3_serialize_frames(buf + ID3_HEADER_SIZE, data);
+     if (!pool) free(body);
+     
+     int ret = replace_tag_block(filename, buf, total);
+     if (!pool) free(buf);
+     return ret;
+ }
+ 
+ /**
+  * @brief Patches the changed values of a tag directly into its frames.
+  *
+  * This only applies when every dirty field still has the frame it was read from and
+  * its new value has exactly the length of the old one; each value is then written
+  * over the old bytes and nothing else in the file is touched.
+  *
+  * @param filename The MP3 file the tag was read from.
+  * @param data TagData with dirty fields.
+  * @return 0 if the values were patched, 1 if the tag cannot be patched, -1 on failure.
+  */
+ static int patch_dirty_frames(const char *filename, const TagData *data) 
+ {
+     unsigned int end = 0;
+     for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+     {
+         if (!(data->dirty & (1u << i))) continue;
+         if (!tag_get(data, (TagField)i) || data->frame_offset[i] == 0 ||
+             tag_length(data, (TagField)i) != data->frame_length[i]) 
+         {
+             return 1;
+         }
+         if (data->frame_offset[i] + data->frame_length[i] > end) 
+         {
+             end = data->frame_offset[i] + data->frame_length[i];
+         }
+     }
+     
+     int fd = id3_open(filename, O_RDWR, 0);
+     if (fd < 0) return 1;
      
+     // The frames must still lie inside the file's tag.
+     unsigned char header[ID3_HEADER_SIZE];
+     Id3Header hdr;
+     if (id3_pread_full(fd, header, sizeof(header), 0) != 0 ||
+         id3_parse_header(header, sizeof(header), &hdr) != ID3_PARSE_OK ||
+         end > ID3_HEADER_SIZE + hdr.tag_size) 
+     {
+         close(fd);
+         return 1;
+     }
+     
+     int ret = 0;
+     for (int i = 0; i < TAG_FIELD_COUNT && ret == 0; i++) 
+     {
+         if (!(data->dirty & (1u << i))) continue;
+         ret = id3_pwrite_full(fd, tag_get(data, (TagField)i), data->frame_length[i],
+                               (off_t)data->frame_offset[i]);
+     }
+     if (close(fd) != 0) ret = -1;
+     if (ret != 0) display_error("Failed to patch tag in place.");
+     return ret;
+ }
+ 
+ /**
+  * @brief Writes only what changed in a tag that was read from the same file.
+  *
+  * Nothing is written when no field is dirty. Same-length changes are patched into
+  * their frames; any other change rewrites the tag with write_id3_tags_pooled().
+  *
+  * @param pool Per-worker pool to draw the serializer buffer from, or NULL.
+  * @param filename The MP3 file @p data was read from.
+  * @param data TagData read with read_id3_tags_pooled() and then modified.
+  * @return 0 on success, non-zero on failure.
+  */
+ int update_id3_tags_pooled(Id3Pool *pool, const char *filename, const TagData *data) 
+ {
+     if (data->dirty == 0) 
+     {
+         return 0;
+     }
+     int ret = patch_dirty_frames(filename, data);
+     if (ret != 1) 
+     {
+         return ret;
+     }
+     return write_id3_tags_pooled(pool, filename, data);
+ }
+ 
+ /**
+  * @brief Replaces the tag of an MP3 file with a raw tag block.
+  *
+  * The whole tag is replaced without reading the old one, so there is nothing to
+  * check for conflicts: unless locking is off, the file is simply locked for the
+  * write, like the write of id3_edit_file_pooled(), so the two never interleave.
+  *
+  * @param filename The name of the MP3 file to update.
+  * @param block Complete tag block, header included.
+  * @param len Length of @p block.
+  * @return 0 on success, non-zero on failure.
+  */
+ int write_raw_tag(const char *filename, const unsigned char *block, size_t len) 
+ {
+     Id3Header hdr;
+     if (id3_parse_header(block, len, &hdr) != ID3_PARSE_OK ||
+         len - ID3_HEADER_SIZE > ID3_MAX_TAG_SIZE) 
+     {
+         display_error("Invalid raw tag block.");
+         return -1;
+     }
+     int lock = -1;
+     if (id3_lock_mode() != ID3_LOCK_NONE && (lock = id3_lock_file(filename)) < 0) 
+     {
+         display_error("Cannot lock file for editing.");
+         return -1;
+     }
+     int ret = replace_tag_block(filename, block, len);
+     id3_unlock_file(lock);
+     return ret;
+ }
+ 
+ /**
+  * @brief Writes the ID3 tags to an MP3 file without a buffer pool.
+  *
+  * @param filename The name of the MP3 file to update.
+  * @param data Pointer to the TagData structure containing the new tag values.
+  * @return 0 on success, non-zero on failure.
+  */
+ int write_id3_tags(const char *filename, const TagData *data) 
+ {
+     return write_id3_tags_pooled(NULL, filename, data);
+ }
+ 
+ /**
+  * @brief Runs one read-modify-write cycle on a file under the current locking mode.
+  *
+  * In exclusive mode the file is locked before it is read and unlocked after the write.
+  * In optimistic mode it is read without a lock; the lock is only taken to check that the
+  * file still matches what was read and to write it. If it changed, the whole cycle is
+  * repeated after a short randomized backoff. Completed files are added to the
+  * checkpoint log, if one is open.
+  *
+  * @param pool Per-worker pool to draw buffers from, or NULL.
+  * @param filename The MP3 file to edit.
+  * @param fn Function applying the edit to the tags read.
+  * @param ctx Context passed to @p fn.
+  * @return 0 on success, non-zero on failure.
+  */
+ int id3_edit_file_pooled(Id3Pool *pool, const char *filename, Id3EditFn fn, void *ctx) 
+ {
+     Id3LockMode mode = id3_lock_mode();
+     for (int attempt = 0; attempt < EDIT_MAX_ATTEMPTS; attempt++) 
+     {
+         int lock = -1;
+         if (mode == ID3_LOCK_EXCLUSIVE && (lock = id3_lock_file(filename)) < 0) 
+         {
+             display_error("Cannot lock file for editing.");
+             return -1;
+         }
+         
+         TagData *data = read_id3_tags_pooled(pool, filename);
+         int ret = data ? fn(data, ctx) : -1;
+         if (ret == 0 && data->dirty) 
+         {
+             if (mode == ID3_LOCK_OPTIMISTIC) 
+             {
+                 lock = id3_lock_file(filename);
+                 if (lock < 0) ret = -1;
+                 else if (!id3_file_unchanged(lock, &data->source)) ret = EDIT_CONFLICT;
+             }
+             if (ret == 0) ret = update_id3_tags_pooled(pool, filename, data);
+         }
+         id3_unlock_file(lock);
+         if (data && pool) id3_pool_release_tag(pool, data);
+         else free_tag_data(data);
+         
+         if (ret == 0) id3_checkpoint_record(filename);
+         if (ret != EDIT_CONFLICT) return ret;
+         // Another writer got there first; back off for 1-2, 2-4, 4-8... ms and retry.
+         usleep((useconds_t)((1000u << attempt) + id3_random() % (1000u << attempt)));
+     }
+     display_error("File kept changing while editing; giving up.");
+     return -1;
+ }
+ 
+ /**
+  * @brief Field and value of a single-field edit.
+  */
+ typedef struct 
+ {
+     TagField field;
+     const char *value;
+ } SingleEdit;
+ 
+ static int apply_single_edit(TagData *data, void *ctx) 
+ {
+     const SingleEdit *edit = (const SingleEdit *)ctx;
+     if (tag_set(data, edit->field, edit->value) != 0) 
+     {
+         display_error("Memory allocation failed.");
+         return -1;
+     }
      return 0;
  }
  
  /**
   * @brief Edits a specific tag in an MP3 file.
   *
-  * This function reads the current tags into a TagData structure,
-  * updates the specified field, and rewrites the file with the new tags.
+  * This function reads the current tags into a TagData structure, updates the
+  * specified field, and writes only what changed: nothing if the value is the
+  * same, the frame's bytes if it has the same length, the tag otherwise. The
+  * file is protected against concurrent edits as set by id3_lock_set_mode().
   *
   * @param filename The MP3 file to edit.
   * @param tag The tag field to edit (e.g., "title", "artist", "album", "year", "comment", "genre").
@@ -139,68 +723,117 @@
   */
  int edit_tag(const char *filename, const char *tag, const char *value) 
  {
-     // Read the current tags (if available).
-     TagData *data = read_id3_tags(filename);
-     if (!data) 
+     int field = tag_field_from_name(tag);
+     if (field < 0) 
      {
-         display_error("Failed to read tags for editing.");
+         display_error("Unknown tag.");
          return -1;
      }
      
-     // Update the specified tag field.
-     if (strcmp(tag, "title") == 0) 
+     SingleEdit edit;
+     edit.field = (TagField)field;
+     edit.value = value;
+     return id3_edit_file_pooled(NULL, filename, apply_single_edit, &edit);
+ }
+ 
+ /**
+  * @brief New values and the fields to take from them.
+  */
+ typedef struct 
+ {
+     const TagData *values;
+     unsigned int mask;
+ } MaskedEdit;
+ 
+ static int apply_masked_edit(TagData *data, void *ctx) 
+ {
+     const MaskedEdit *edit = (const MaskedEdit *)ctx;
+     // tag_set() leaves fields that keep their value clean.
+     for (int i = 0; i < TAG_FIELD_COUNT; i++) 
      {
-         free(data->title);
-         data->title = strdup(value);
-     } 
-     else if (strcmp(tag, "artist") == 0) {
-         free(data->artist);
-         data->artist = strdup(value);
-     } 
-     else if (strcmp(tag, "album") == 0) {
-         free(data->album);
-         data->album = strdup(value);
-     } 
-     else if (strcmp(tag, "year") == 0) {
-         free(data->year);
-         data->year = strdup(value);
-     } 
-     else if (strcmp(tag, "comment") == 0) {
-         free(data->comment);
-         data->comment = strdup(value);
-     } 
-     else if (strcmp(tag, "genre") == 0) {
-         free(data->genre);
-         data->genre = strdup(value);
+         if (!(edit->mask & (1u << i))) continue;
+         if (tag_set(data, (TagField)i, tag_get(edit->values, (TagField)i)) != 0) return -1;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Applies several field changes to an MP3 file with a single write.
+  *
+  * This function reads the current tags, copies every field selected by @p mask from
+  * @p values, and writes the changes once with update_id3_tags_pooled(). If none of the
+  * selected fields actually changes, the file is not written at all.
+  *
+  * @param pool Per-worker pool to draw buffers from, or NULL.
+  * @param filename The MP3 file to edit.
+  * @param values TagData holding the new values.
+  * @param mask Bit (1u << TagField) for each field of @p values to apply.
+  * @return 0 on success (including when nothing changed), non-zero on failure.
+  */
+ int edit_tags_pooled(Id3Pool *pool, const char *filename, const TagData *values, unsigned int mask) 
+ {
+     MaskedEdit edit;
+     edit.values = values;
+     edit.mask = mask;
+     return id3_edit_file_pooled(pool, filename, apply_masked_edit, &edit);
+ }
+
+ /**
+  * @brief Source fields applied by id3_copy_tags() to every target.
+  */
+ typedef struct 
+ {
+     const TagData *values;      /**< Tags read from the source */
+     unsigned int mask;          /**< Fields set in the source */
+     char *const *targets;       /**< Files receiving the fields */
+     size_t count;               /**< Number of targets */
+     int number_tracks;          /**< Set a per-target "n/total" track */
+ } CopyTagsJob;
+
+ /**
+  * @brief Batch work function applying the source's fields to one target.
+  */
+ static int copy_tags_to_target(Id3Pool *pool, size_t index, void *ctx) 
+ {
+     const CopyTagsJob *job = (const CopyTagsJob *)ctx;
+     const char *target = job->targets[index];
+     if (!id3_path_selected(target)) return 0;
+     int ret;
+     if (!job->number_tracks) 
+     {
+         ret = edit_tags_pooled(pool, target, job->values, job->mask);
      } 
      else 
      {
-         display_error("Unknown tag.");
-         // Free allocated memory.
-         free(data->version);
-         free(data->title);
-         free(data->artist);
-         free(data->album);
-         free(data->year);
-         free(data->comment);
-         free(data->genre);
-         free(data);
-         return -1;
+         // Only the track differs per target, so set it on a copy of the shared values.
+         TagData *values = pool ? id3_pool_acquire_tag(pool) : create_tag_data();
+         char track[48];
+         snprintf(track, sizeof(track), "%zu/%zu", index + 1, job->count);
+         ret = values && copy_tag_data(values, job->values) == 0 && tag_set(values, TAG_TRACK, track) == 0
+             ? edit_tags_pooled(pool, target, values, job->mask | (1u << TAG_TRACK)) : -1;
+         if (values && pool) id3_pool_release_tag(pool, values);
+         else free_tag_data(values);
      }
-     
-     // Write the updated tags to the file.
-     int ret = write_id3_tags(filename, data);
-     
-     // Free allocated memory.
-     free(data->version);
-     free(data->title);
-     free(data->artist);
-     free(data->album);
-     free(data->year);
-     free(data->comment);
-     free(data->genre);
-     free(data);
-     
+     if (ret != 0) fprintf(stderr, "Error: Failed to copy tags to %s\n", target);
      return ret;
  }
- 
\ No newline at end of file
+
+ long id3_copy_tags(const char *source, char *const targets[], size_t count, int number_tracks, int jobs) 
+ {
+     TagData *values = read_id3_tags(source);
+     if (!values) return -1;
+     CopyTagsJob job;
+     job.values = values;
+     job.mask = 0;
+     for (int i = 0; i < TAG_FIELD_COUNT; i++) 
+     {
+         if (tag_get(values, (TagField)i)) job.mask |= 1u << i;
+     }
+     if (number_tracks) job.mask &= ~(1u << TAG_TRACK);
+     job.targets = targets;
+     job.count = count;
+     job.number_tracks = number_tracks;
+     long failures = id3_batch_run(count, jobs, copy_tags_to_target, &job);
+     free_tag_data(values);
+     return failures;
+ }
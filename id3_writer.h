@@ -2,19 +2,140 @@
 #define ID3_WRITER_H
 
 #include "id3_utils.h"
+#include "id3_pool.h"
+
+/**
+ * @brief Serializes a single v2.3 text frame.
+ *
+ * @param out Destination buffer with room for the frame, or NULL to only measure it.
+ * @param frame_id 4-character frame ID (e.g., "TIT2").
+ * @param content Frame text; NULL produces nothing.
+ * @param content_size Length of @p content in bytes.
+ * @return Number of bytes the frame occupies.
+ */
+size_t id3_serialize_frame(unsigned char *out, const char *frame_id, const char *content,
+                           size_t content_size);
+
+/**
+ * @brief Serializes every set field of a TagData structure as v2.3 frames.
+ *
+ * @param out Destination buffer, or NULL to only measure the frames.
+ * @param data TagData whose fields are serialized.
+ * @return Total size of the frames in bytes.
+ */
+size_t id3_serialize_frames(unsigned char *out, const TagData *data);
 
 /**
  * @brief Writes the ID3 tags to an MP3 file.
  * 
+ * The known fields of an existing tag are replaced; its other frames, such as
+ * attached pictures, are kept.
+ *
  * @param filename The name of the MP3 file.
  * @param data Pointer to the TagData structure containing the ID3 tags.
  * @return 0 on success, non-zero on failure.
  */
 int write_id3_tags(const char *filename, const TagData *data);
 
+/**
+ * @brief Writes the ID3 tags to an MP3 file, serializing into a pooled buffer.
+ * 
+ * @param pool Pool owned by the calling worker, or NULL to allocate per call.
+ * @param filename The name of the MP3 file.
+ * @param data Pointer to the TagData structure containing the ID3 tags.
+ * @return 0 on success, non-zero on failure.
+ */
+int write_id3_tags_pooled(Id3Pool *pool, const char *filename, const TagData *data);
+
+/**
+ * @brief Writes the changed fields of a tag back to the file it was read from.
+ *
+ * Nothing is written when no field is dirty. When every changed value keeps its
+ * length, only those values are patched into their frames; otherwise the tag is
+ * rebuilt as by write_id3_tags_pooled(), keeping the frames of unknown fields.
+ *
+ * @param pool Pool owned by the calling worker, or NULL to allocate per call.
+ * @param filename The MP3 file @p data was read from.
+ * @param data TagData returned by read_id3_tags_pooled() and then modified.
+ * @return 0 on success, non-zero on failure.
+ */
+int update_id3_tags_pooled(Id3Pool *pool, const char *filename, const TagData *data);
+
+/**
+ * @brief Replaces the tag of an MP3 file with a raw, already serialized tag block.
+ *
+ * The block is written in place when the existing tag is large enough (the
+ * remainder becomes padding); otherwise the file is rewritten. The file is
+ * locked for the write as set by id3_lock_set_mode().
+ *
+ * @param filename The name of the MP3 file.
+ * @param block Complete tag block starting with its 10-byte ID3 header.
+ * @param len Length of @p block in bytes.
+ * @return 0 on success, non-zero on failure.
+ */
+int write_raw_tag(const char *filename, const unsigned char *block, size_t len);
+
+/**
+ * @brief Edit applied by id3_edit_file_pooled() to the tags it has read.
+ *
+ * @param data Tags as currently stored in the file; modify them with tag_set().
+ * @param ctx  Caller context.
+ * @return 0 on success, non-zero to abandon the edit.
+ */
+typedef int (*Id3EditFn)(TagData *data, void *ctx);
+
+/**
+ * @brief Reads a file's tags, applies an edit and writes what changed, safely against
+ * concurrent edits by other threads and processes.
+ *
+ * The protection follows id3_lock_mode(): an exclusive lock for the whole cycle, or an
+ * optimistic read followed by a locked check-and-write that restarts the cycle (at most
+ * a few times) when the file changed in between.
+ *
+ * @param pool Pool owned by the calling worker, or NULL to allocate per call.
+ * @param filename The MP3 file to edit.
+ * @param fn Edit to apply; it may be called more than once in optimistic mode.
+ * @param ctx Context passed to @p fn.
+ * @return 0 on success (including when nothing changed), non-zero on failure.
+ */
+int id3_edit_file_pooled(Id3Pool *pool, const char *filename, Id3EditFn fn, void *ctx);
+
 /**
 TODO: Add documention as sample given above
  */
 int edit_tag(const char *filename, const char *tag, const char *value);
 
+/**
+ * @brief Applies several field changes to an MP3 file with a single write.
+ *
+ * Fields whose new value equals the current one are ignored, and the file is
+ * not written at all when nothing changes.
+ *
+ * @param pool Pool owned by the calling worker, or NULL to allocate per call.
+ * @param filename The MP3 file to edit.
+ * @param values TagData holding the new values.
+ * @param mask Bit (1u << TagField) for each field of @p values to apply.
+ * @return 0 on success, non-zero on failure.
+ */
+int edit_tags_pooled(Id3Pool *pool, const char *filename, const TagData *values, unsigned int mask);
+
+/**
+ * @brief Applies the tag fields of one file to many files.
+ *
+ * The source is read once. Each target gets the fields set in the source
+ * through edit_tags_pooled(), so its pictures and other frames are kept and the
+ * tag is patched in place when the new frames fit; fields the source does not
+ * have are left as they are. Targets outside the shard or already in the
+ * checkpoint log are skipped (see id3_path_selected()).
+ *
+ * @param source        File whose tags are copied.
+ * @param targets       Files receiving the tags.
+ * @param count         Number of entries in @p targets.
+ * @param number_tracks Non-zero to set each target's track to "n/count" by its position.
+ * @param jobs          Number of worker threads (0 selects the default).
+ * @return Number of targets that could not be written, or -1 if the source could not be read
+ *         or the workers could not be started.
+ */
+long id3_copy_tags(const char *source, char *const targets[], size_t count, int number_tracks, int jobs);
+
 #endif // ID3_WRITER_H
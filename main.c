@@ -11,6 +11,22 @@
  #include "main.h"
  #include "id3_reader.h"
  #include "id3_writer.h"
+ #include "id3_batch.h"
+ #include "id3_manifest.h"
+ #include "id3_scan.h"
+ #include "id3_archive.h"
+ #include "id3_filename.h"
+ #include "id3_index.h"
+ #include "id3_diff.h"
+ #include "id3_normalize.h"
+ #include "id3_stats.h"
+ #include "id3_dupes.h"
+ #include "id3_playlist.h"
+ #include "id3_lock.h"
+ #include "id3_checkpoint.h"
+ #include "id3_queue.h"
+ #include "id3_io.h"
+ #include "id3_shm.h"
  #include "error_handling.h"
  
  /**
@@ -20,12 +36,83 @@
   */
  void display_help() 
  {
-     printf("Usage: mp3tagreader [options] filename\n");
+     printf("Usage: mp3tagreader [--optimistic | --no-lock] [--shard i/N] [--checkpoint <log>]\n");
+     printf("                    [--file-timeout <seconds>] [--retries N] [--nice-io]\n");
+     printf("                    [--max-bytes-per-sec N[K|M|G]] [options] filename\n");
+     printf("Edits lock each file while it is read and written; --optimistic only locks to\n");
+     printf("check the file is unchanged and write it, retrying on conflict; --no-lock never locks.\n");
+     printf("--shard i/N only processes the files whose path hashes to shard i of N; --checkpoint\n");
+     printf("skips the files listed in the log and appends each file as its edit completes.\n");
+     printf("--file-timeout puts files that take longer aside and retries them at the end.\n");
+     printf("--retries sets how many transient I/O errors (EIO, ESTALE, EAGAIN) a run may\n");
+     printf("retry with backoff (default %d).\n", ID3_IO_DEFAULT_RETRY_BUDGET);
+     printf("--nice-io only uses the disk when nobody else does; --max-bytes-per-sec caps the\n");
+     printf("combined read and write rate of all workers.\n");
      printf("Options:\n");
      printf("  -h               Display help\n");
-     printf("  -v <filename>    View tags in an MP3 file\n");
+     printf("  -v <filename>... View tags in one or more MP3 files\n");
      printf("  -w <filename>    Write dummy tags to an MP3 file\n");
      printf("  -e <tag> <filename> <value>  Edit a specific tag in an MP3 file\n");
+     printf("  --apply <manifest> [-j N]    Apply edits from a CSV/TSV manifest using N threads\n");
+     printf("  --apply <manifest> --queue <dir> [--chunk N] [--lease S] [-j N]\n");
+     printf("                               Share the manifest with other workers through lease\n");
+     printf("                               files in dir; workers may join or leave at any time\n");
+     printf("  --export-tags <archive> <file|dir>...  Save the raw tags of a library to one archive\n");
+     printf("  --import-tags <archive>      Restore the tags saved in an archive\n");
+     printf("  --copy-tags-from <src> [--number-tracks] [-j N] <target>...\n");
+     printf("                               Copy the tags of src to every target, optionally\n");
+     printf("                               numbering the targets' tracks n/total in order\n");
+     printf("  --from-filename <pattern> [-j N] <file|dir>...  Set tags from paths, e.g.\n");
+     printf("                               \"%%artist%%/%%album%%/%%track%% - %%title%%.mp3\"\n");
+     printf("  --rename <pattern> [-j N] <file|dir>...         Rename files from their tags\n");
+     printf("  --index <out.tsv> [-j N] <file|dir>...          Write a sorted index of a library\n");
+     printf("  --diff <a.mp3> <b.mp3>       Show the fields that differ between two files\n");
+     printf("  --diff-index <old> <new>     Show changes between two library indexes\n");
+     printf("  --normalize <ops> [-j N] <file|dir>...  Clean up tag text; ops is a list of\n");
+     printf("                               strip,nfc,trim,collapse,lower,upper,title or all\n");
+     printf("  --stats [--top N] [--save <f>] [-j N] <file|dir>...  Report library statistics,\n");
+     printf("                               optionally saving them for --merge-stats\n");
+     printf("  --stats-index <index> [--top N] [--save <f>]  Report statistics of a library index\n");
+     printf("  --duplicates [-d N] [-j N] <file|dir>...  Find near-duplicate artist/title pairs\n");
+     printf("                               differing by at most N edits (default 2)\n");
+     printf("  --duplicates-index <index> [-d N]       Find near-duplicates in a library index\n");
+     printf("  --playlist <query> --out <x.m3u8> [--index <index>] [-j N] [<file|dir>...]\n");
+     printf("                               Write the files matching a query, e.g.\n");
+     printf("                               \"genre = Rock and year >= 1990\", as a playlist\n");
+     printf("  --merge-index <out> <index>...           Merge per-shard index fragments\n");
+     printf("  --merge-stats [--top N] [--save <f>] <stats>...  Add up saved per-shard statistics\n");
+     printf("  --merge-checkpoints <out> <log>...       Merge per-shard checkpoint logs\n");
+     printf("  --shm-publish <name> <index>             Publish an index as shared memory in %s\n", ID3_SHM_DIR);
+     printf("  --shm-lookup <name> <path>...            Look files up in a published segment\n");
+ }
+ 
+ /**
+  * @brief Batch work function applying one grouped manifest entry.
+  *
+  * @param pool Pool owned by the worker thread.
+  * @param index Index of the manifest entry.
+  * @param ctx The Id3Manifest being applied.
+  * @return 0 on success, non-zero on failure.
+  */
+ static int apply_manifest_entry(Id3Pool *pool, size_t index, void *ctx) 
+ {
+     const Id3ManifestEdit *edit = &((const Id3Manifest *)ctx)->edits[index];
+     if (edit->set_mask == 0 || !id3_path_selected(edit->path)) return 0;
+     if (edit_tags_pooled(pool, edit->path, edit->values, edit->set_mask) != 0) 
+     {
+         fprintf(stderr, "Error: Failed to apply manifest edits to %s\n", edit->path);
+         return -1;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Reports at exit how many transient I/O errors were retried, if any.
+  */
+ static void report_retries(void) 
+ {
+     long retries = id3_io_retries_used();
+     if (retries > 0) fprintf(stderr, "Retried %ld transient I/O errors.\n", retries);
  }
  
  /**
@@ -40,6 +127,80 @@
   */
  int main(int argc, char *argv[]) 
  {
+     atexit(report_retries);
+     
+     // Options that apply to every operation below, e.g. the concurrency mode for edits
+     while (argc >= 2) 
+     {
+         int used = 1;
+         if (strcmp(argv[1], "--optimistic") == 0) 
+         {
+             id3_lock_set_mode(ID3_LOCK_OPTIMISTIC);
+         } 
+         else if (strcmp(argv[1], "--no-lock") == 0) 
+         {
+             id3_lock_set_mode(ID3_LOCK_NONE);
+         } 
+         else if (strcmp(argv[1], "--shard") == 0 && argc >= 3) 
+         {
+             if (id3_scan_set_shard(argv[2]) != 0) 
+             {
+                 display_error("Invalid shard, expected i/N with 0 <= i < N.");
+                 return 1;
+             }
+             used = 2;
+         } 
+         else if (strcmp(argv[1], "--file-timeout") == 0 && argc >= 3) 
+         {
+             double seconds = atof(argv[2]);
+             if (seconds <= 0) 
+             {
+                 display_error("Invalid file timeout, expected a number of seconds.");
+                 return 1;
+             }
+             id3_batch_set_file_budget((long)(seconds * 1000));
+             used = 2;
+         } 
+         else if (strcmp(argv[1], "--nice-io") == 0) 
+         {
+             if (id3_io_set_idle_priority() != 0) display_error("Cannot set the idle I/O priority; continuing at normal priority.");
+         } 
+         else if (strcmp(argv[1], "--max-bytes-per-sec") == 0 && argc >= 3) 
+         {
+             // Accepts a K, M or G suffix (powers of 1024)
+             char *end;
+             long long rate = strtoll(argv[2], &end, 10);
+             if (*end == 'K' || *end == 'k') rate <<= 10, end++;
+             else if (*end == 'M' || *end == 'm') rate <<= 20, end++;
+             else if (*end == 'G' || *end == 'g') rate <<= 30, end++;
+             if (rate <= 0 || *end) 
+             {
+                 display_error("Invalid rate, expected bytes per second, e.g. 20M.");
+                 return 1;
+             }
+             id3_io_set_rate_limit(rate);
+             used = 2;
+         } 
+         else if (strcmp(argv[1], "--retries") == 0 && argc >= 3) 
+         {
+             id3_io_set_retry_budget(atol(argv[2]));
+             used = 2;
+         } 
+         else if (strcmp(argv[1], "--checkpoint") == 0 && argc >= 3) 
+         {
+             if (id3_checkpoint_open(argv[2]) != 0) return 1;
+             atexit(id3_checkpoint_close);
+             used = 2;
+         } 
+         else 
+         {
+             break;
+         }
+         argv[used] = argv[0];
+         argc -= used;
+         argv += used;
+     }
+     
      // Check if there are enough arguments
      if (argc < 2) 
      {
@@ -58,6 +219,27 @@
          // View MP3 tags
          view_tags(argv[2]);
      } 
+     else if (strcmp(argv[1], "-v") == 0 && argc > 3) 
+     {
+         // View tags of several files, reusing one pool's buffers for all of them
+         Id3Pool *pool = id3_pool_create();
+         if (!pool) 
+         {
+             display_error("Memory allocation failed.");
+             return 1;
+         }
+         for (int i = 2; i < argc; i++) 
+         {
+             printf("==> %s <==\n", argv[i]);
+             TagData *data = read_id3_tags_pooled(pool, argv[i]);
+             if (data) 
+             {
+                 display_metadata(data);
+                 id3_pool_release_tag(pool, data);
+             }
+         }
+         id3_pool_destroy(pool);
+     } 
      else if (strcmp(argv[1], "-w") == 0 && argc == 3) 
      {
          // Write dummy tags to the file
@@ -69,13 +251,13 @@
          }
          
          // Assign dummy tag values
-         data->version = strdup("ID3v2.3");
-         data->title   = strdup("dummy title");
-         data->artist  = strdup("dummy artist");
-         data->album   = strdup("dummy album");
-         data->year    = strdup("dummy year");
-         data->comment = strdup("dummy comment");
-         data->genre   = strdup("dummy genre");
+         tag_set_version(data, "ID3v2.3");
+         tag_set(data, TAG_TITLE,   "dummy title");
+         tag_set(data, TAG_ARTIST,  "dummy artist");
+         tag_set(data, TAG_ALBUM,   "dummy album");
+         tag_set(data, TAG_YEAR,    "dummy year");
+         tag_set(data, TAG_COMMENT, "dummy comment");
+         tag_set(data, TAG_GENRE,   "dummy genre");
          
          // Write tags to the MP3 file
          if (write_id3_tags(argv[2], data) == 0) 
@@ -88,14 +270,7 @@
          }
          
          // Free allocated memory
-         free(data->version);
-         free(data->title);
-         free(data->artist);
-         free(data->album);
-         free(data->year);
-         free(data->comment);
-         free(data->genre);
-         free(data);
+         free_tag_data(data);
      } 
      else if (strcmp(argv[1], "-e") == 0 && argc == 5) 
      {
@@ -109,6 +284,406 @@
              display_error("Failed to edit tag.");
          }
      } 
+     else if (strcmp(argv[1], "--apply") == 0 && argc >= 3) 
+     {
+         // Bulk edit: each file named in the manifest is read and written once
+         int jobs = 0;
+         const char *queue_dir = NULL;
+         long chunk = 0;
+         long lease = 0;
+         int argi = 3;
+         while (argi + 1 < argc && argv[argi][0] == '-') 
+         {
+             if (strcmp(argv[argi], "-j") == 0) jobs = atoi(argv[argi + 1]);
+             else if (strcmp(argv[argi], "--queue") == 0) queue_dir = argv[argi + 1];
+             else if (strcmp(argv[argi], "--chunk") == 0) chunk = atol(argv[argi + 1]);
+             else if (strcmp(argv[argi], "--lease") == 0) lease = atol(argv[argi + 1]);
+             else break;
+             argi += 2;
+         }
+         if (argi != argc || jobs < 0 || chunk < 0 || lease < 0) 
+         {
+             display_help();
+             return 1;
+         }
+         Id3Manifest manifest;
+         if (id3_manifest_load(argv[2], &manifest) != 0) 
+         {
+             return 1;
+         }
+         long failures;
+         if (queue_dir) 
+         {
+             // Elastic workers: any number of processes share the manifest's chunks
+             Id3Queue queue;
+             size_t processed = 0;
+             failures = id3_queue_open(&queue, queue_dir, manifest.count, (size_t)chunk, (unsigned int)lease) == 0
+                        ? id3_queue_run(&queue, jobs, apply_manifest_entry, &manifest, &processed) : -1;
+             if (failures >= 0) 
+             {
+                 printf("Processed %zu of %zu queue chunks (%ld failed).\n", processed, queue.nchunks, failures);
+             }
+             id3_queue_close(&queue);
+         } 
+         else 
+         {
+             failures = id3_batch_run(manifest.count, jobs, apply_manifest_entry, &manifest);
+             printf("Applied %zu manifest rows to %zu files (%ld failed).\n",
+                    manifest.rows, manifest.count, failures < 0 ? (long)manifest.count : failures);
+         }
+         id3_manifest_free(&manifest);
+         if (failures != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--export-tags") == 0 && argc >= 4) 
+     {
+         // Dump the raw tag block of every file into a single archive
+         Id3PathList files = {0};
+         if (id3_scan_paths(argv + 3, argc - 3, &files) != 0) 
+         {
+             display_error("Memory allocation failed.");
+             id3_path_list_free(&files);
+             return 1;
+         }
+         long failures = id3_archive_export(argv[2], &files, 0);
+         if (failures >= 0) 
+         {
+             printf("Exported tags of %zu files (%ld failed).\n", files.count, failures);
+         }
+         id3_path_list_free(&files);
+         if (failures != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--import-tags") == 0 && argc == 3) 
+     {
+         // Restore tags from an archive written by --export-tags
+         long failures = id3_archive_import(argv[2]);
+         if (failures < 0) return 1;
+         printf("Imported tags (%ld failed).\n", failures);
+         if (failures != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--copy-tags-from") == 0 && argc >= 4) 
+     {
+         // Read the source tag once, then apply its fields to every target
+         int number_tracks = 0;
+         int jobs = 0;
+         int argi = 3;
+         for (; argi < argc; argi++) 
+         {
+             if (strcmp(argv[argi], "--number-tracks") == 0) number_tracks = 1;
+             else if (strcmp(argv[argi], "-j") == 0 && argi + 1 < argc) jobs = atoi(argv[++argi]);
+             else break;
+         }
+         if (argi == argc) 
+         {
+             display_help();
+             return 1;
+         }
+         size_t count = (size_t)(argc - argi);
+         long failures = id3_copy_tags(argv[2], argv + argi, count, number_tracks, jobs);
+         if (failures < 0) 
+         {
+             display_error("Failed to read source tags.");
+             return 1;
+         }
+         printf("Copied tags to %zu files (%ld failed).\n", count, failures);
+         if (failures != 0) return 1;
+     } 
+     else if ((strcmp(argv[1], "--from-filename") == 0 || strcmp(argv[1], "--rename") == 0) && argc >= 4) 
+     {
+         // Pattern-driven bulk modes: the pattern is compiled once for all files
+         int jobs = 0;
+         int argi = 3;
+         if (argc >= 6 && strcmp(argv[3], "-j") == 0) 
+         {
+             jobs = atoi(argv[4]);
+             argi = 5;
+         }
+         Id3Pattern pattern;
+         if (id3_pattern_compile(argv[2], &pattern) != 0) 
+         {
+             return 1;
+         }
+         long failures;
+         if (strcmp(argv[1], "--rename") == 0) 
+         {
+             failures = id3_rename_from_tags(&pattern, argv + argi, argc - argi, jobs);
+         } 
+         else 
+         {
+             Id3PathList files = {0};
+             failures = id3_scan_paths(argv + argi, argc - argi, &files) == 0
+                        ? id3_tags_from_filenames(&pattern, &files, jobs) : -1;
+             id3_path_list_free(&files);
+         }
+         id3_pattern_free(&pattern);
+         if (failures < 0) 
+         {
+             display_error("Failed to start processing.");
+             return 1;
+         }
+         printf("Done (%ld failed).\n", failures);
+         if (failures != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--index") == 0 && argc >= 4) 
+     {
+         // Snapshot the tags of a library into a sorted index
+         int jobs = 0;
+         int argi = 3;
+         if (argc >= 6 && strcmp(argv[3], "-j") == 0) 
+         {
+             jobs = atoi(argv[4]);
+             argi = 5;
+         }
+         Id3PathList files = {0};
+         long failures = id3_scan_paths(argv + argi, argc - argi, &files) == 0
+                         ? id3_index_build(argv[2], &files, jobs) : -1;
+         if (failures >= 0 && strcmp(argv[2], "-") != 0) 
+         {
+             printf("Indexed %zu files (%ld failed).\n", files.count, failures);
+         }
+         id3_path_list_free(&files);
+         if (failures != 0) return 1;
+     } 
+     else if ((strcmp(argv[1], "--diff") == 0 || strcmp(argv[1], "--diff-index") == 0) && argc == 4) 
+     {
+         // Like diff(1): exit status 0 when equal, 1 when different, 2 on error
+         long count = strcmp(argv[1], "--diff") == 0 ? id3_diff_files(argv[2], argv[3], stdout)
+                                                     : id3_diff_indexes(argv[2], argv[3], stdout);
+         if (count < 0) 
+         {
+             display_error("Comparison failed.");
+             return 2;
+         }
+         return count > 0 ? 1 : 0;
+     } 
+     else if (strcmp(argv[1], "--normalize") == 0 && argc >= 4) 
+     {
+         // Normalize tag text, rewriting only the files whose values change
+         unsigned int ops;
+         int jobs = 0;
+         int argi = 3;
+         if (id3_normalize_parse(argv[2], &ops) != 0) 
+         {
+             return 1;
+         }
+         if (argc >= 6 && strcmp(argv[3], "-j") == 0) 
+         {
+             jobs = atoi(argv[4]);
+             argi = 5;
+         }
+         Id3PathList files = {0};
+         size_t modified = 0;
+         long failures = id3_scan_paths(argv + argi, argc - argi, &files) == 0
+                         ? id3_normalize_files(&files, ops, jobs, &modified) : -1;
+         if (failures >= 0) 
+         {
+             printf("Normalized %zu of %zu files (%ld failed).\n", modified, files.count, failures);
+         }
+         id3_path_list_free(&files);
+         if (failures != 0) return 1;
+     } 
+     else if ((strcmp(argv[1], "--stats") == 0 || strcmp(argv[1], "--stats-index") == 0) && argc >= 3) 
+     {
+         // Library statistics, listing the 20 most frequent values per group by default
+         int index_mode = strcmp(argv[1], "--stats-index") == 0;
+         int jobs = 0;
+         long top = 20;
+         const char *save = NULL;
+         int argi = index_mode ? 3 : 2;
+         while (argi + 1 < argc && argv[argi][0] == '-') 
+         {
+             if (strcmp(argv[argi], "--top") == 0) top = atol(argv[argi + 1]);
+             else if (strcmp(argv[argi], "--save") == 0) save = argv[argi + 1];
+             else if (strcmp(argv[argi], "-j") == 0 && !index_mode) jobs = atoi(argv[argi + 1]);
+             else break;
+             argi += 2;
+         }
+         if (index_mode ? argi != argc : argi >= argc) 
+         {
+             display_help();
+             return 1;
+         }
+         Id3Stats stats = {0};
+         long failures;
+         if (index_mode) 
+         {
+             failures = id3_stats_init(&stats, 0) == 0 ? id3_stats_index(&stats, argv[2]) : -1;
+         } 
+         else 
+         {
+             Id3PathList files = {0};
+             failures = id3_scan_paths(argv + argi, argc - argi, &files) == 0 &&
+                        id3_stats_init(&stats, (unsigned int)files.count + 1) == 0
+                        ? id3_stats_scan(&stats, &files, jobs) : -1;
+             id3_path_list_free(&files);
+         }
+         if (failures >= 0) 
+         {
+             id3_stats_print(stdout, &stats, top > 0 ? (size_t)top : 0);
+             if (failures > 0) printf("(%ld files could not be read)\n", failures);
+             if (save && id3_stats_save(&stats, save) != 0) failures = -1;
+         }
+         id3_stats_free(&stats);
+         if (failures != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--merge-stats") == 0 && argc >= 3) 
+     {
+         // Statistics of a sharded run, added up from the saved per-shard files
+         long top = 20;
+         const char *save = NULL;
+         int argi = 2;
+         while (argi + 1 < argc && argv[argi][0] == '-') 
+         {
+             if (strcmp(argv[argi], "--top") == 0) top = atol(argv[argi + 1]);
+             else if (strcmp(argv[argi], "--save") == 0) save = argv[argi + 1];
+             else break;
+             argi += 2;
+         }
+         if (argi >= argc) 
+         {
+             display_help();
+             return 1;
+         }
+         Id3Stats stats = {0};
+         int ret = id3_stats_init(&stats, 0);
+         for (int i = argi; i < argc && ret == 0; i++) 
+         {
+             ret = id3_stats_load(&stats, argv[i]);
+         }
+         if (ret == 0) 
+         {
+             id3_stats_print(stdout, &stats, top > 0 ? (size_t)top : 0);
+             if (save) ret = id3_stats_save(&stats, save);
+         }
+         id3_stats_free(&stats);
+         if (ret != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--merge-index") == 0 && argc >= 4) 
+     {
+         // One sorted index from the per-shard fragments
+         long rows = id3_index_merge(argv[2], argv + 3, argc - 3);
+         if (rows < 0) return 1;
+         if (strcmp(argv[2], "-") != 0) printf("Merged %ld index rows.\n", rows);
+     } 
+     else if (strcmp(argv[1], "--merge-checkpoints") == 0 && argc >= 4) 
+     {
+         // One checkpoint log from the per-shard logs
+         long done = id3_checkpoint_merge(argv[2], argv + 3, argc - 3);
+         if (done < 0) return 1;
+         if (strcmp(argv[2], "-") != 0) printf("Merged %ld completed files.\n", done);
+     } 
+     else if ((strcmp(argv[1], "--duplicates") == 0 || strcmp(argv[1], "--duplicates-index") == 0) && argc >= 3) 
+     {
+         // Near-duplicate detection over files or an index
+         int index_mode = strcmp(argv[1], "--duplicates-index") == 0;
+         int jobs = 0;
+         int distance = ID3_DUPES_DEFAULT_DISTANCE;
+         int argi = index_mode ? 3 : 2;
+         while (argi + 1 < argc && argv[argi][0] == '-') 
+         {
+             if (strcmp(argv[argi], "-d") == 0) distance = atoi(argv[argi + 1]);
+             else if (strcmp(argv[argi], "-j") == 0 && !index_mode) jobs = atoi(argv[argi + 1]);
+             else break;
+             argi += 2;
+         }
+         if ((index_mode ? argi != argc : argi >= argc) || distance < 0) 
+         {
+             display_help();
+             return 1;
+         }
+         long groups;
+         if (index_mode) 
+         {
+             groups = id3_find_duplicates(NULL, argv[2], jobs, distance, stdout);
+         } 
+         else 
+         {
+             Id3PathList files = {0};
+             groups = id3_scan_paths(argv + argi, argc - argi, &files) == 0
+                      ? id3_find_duplicates(&files, NULL, jobs, distance, stdout) : -1;
+             id3_path_list_free(&files);
+         }
+         if (groups < 0) 
+         {
+             display_error("Duplicate search failed.");
+             return 1;
+         }
+         printf("Found %ld duplicate groups.\n", groups);
+     } 
+     else if (strcmp(argv[1], "--playlist") == 0 && argc >= 5) 
+     {
+         // Playlist from a query, answered from an index when one is given
+         const char *out_path = NULL;
+         const char *index = NULL;
+         int jobs = 0;
+         int argi = 3;
+         while (argi + 1 < argc && argv[argi][0] == '-') 
+         {
+             if (strcmp(argv[argi], "--out") == 0) out_path = argv[argi + 1];
+             else if (strcmp(argv[argi], "--index") == 0) index = argv[argi + 1];
+             else if (strcmp(argv[argi], "-j") == 0) jobs = atoi(argv[argi + 1]);
+             else break;
+             argi += 2;
+         }
+         if (!out_path || (index ? argi != argc : argi >= argc)) 
+         {
+             display_help();
+             return 1;
+         }
+         Id3Query query;
+         if (id3_query_compile(argv[2], &query) != 0) 
+         {
+             return 1;
+         }
+         Id3PathList files = {0};
+         size_t entries = 0;
+         long failures = index || id3_scan_paths(argv + argi, argc - argi, &files) == 0
+                         ? id3_playlist_build(out_path, &query, &files, index, jobs, &entries) : -1;
+         if (failures >= 0 && strcmp(out_path, "-") != 0) 
+         {
+             printf("Wrote %zu playlist entries (%ld failed).\n", entries, failures);
+         }
+         id3_path_list_free(&files);
+         id3_query_free(&query);
+         if (failures != 0) return 1;
+     } 
+     else if (strcmp(argv[1], "--shm-publish") == 0 && argc == 4) 
+     {
+         // Library metadata for other processes to map instead of parsing
+         uint64_t epoch = 0;
+         long count = id3_shm_publish(argv[2], argv[3], &epoch);
+         if (count < 0) return 1;
+         printf("Published %ld records to %s/%s (epoch %llu).\n", count, ID3_SHM_DIR, argv[2],
+                (unsigned long long)epoch);
+     } 
+     else if (strcmp(argv[1], "--shm-lookup") == 0 && argc >= 4) 
+     {
+         // Reads straight from the mapping: no copies and no parsing
+         Id3ShmView view;
+         if (id3_shm_open(&view, argv[2]) != 0) 
+         {
+             display_error("Cannot map shared segment.");
+             return 1;
+         }
+         int missing = 0;
+         for (int i = 3; i < argc; i++) 
+         {
+             const Id3ShmRecord *record = id3_shm_find(&view, argv[i]);
+             if (!record) 
+             {
+                 fprintf(stderr, "Error: %s is not in the segment\n", argv[i]);
+                 missing = 1;
+                 continue;
+             }
+             printf("==> %s <==\n", argv[i]);
+             for (int f = 0; f < TAG_FIELD_COUNT; f++) 
+             {
+                 const char *value = id3_shm_string(&view, record->fields[f]);
+                 printf("%-8s %s\n", tag_field_name((TagField)f), value ? value : "N/A");
+             }
+         }
+         id3_shm_close(&view);
+         if (missing) return 1;
+     } 
      else 
      {
          // Display help message for incorrect usage
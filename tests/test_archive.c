@@ -0,0 +1,80 @@
+/**
+ * @file test_archive.c
+ * @brief Tag archive export and import.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_archive.h"
+#include "id3_reader.h"
+#include "id3_scan.h"
+#include "id3_writer.h"
+
+static void test_pack(void)
+{
+    unsigned char raw[600], packed[700], back[600];
+    memset(raw, 0, sizeof(raw));
+    memcpy(raw, "ID3\x03\x00\x00", 6);
+    memcpy(raw + 100, "text between zero runs", 22);
+    size_t packed_len = id3_pack(raw, sizeof(raw), packed);
+    CHECK(packed_len <= id3_pack_bound(sizeof(raw)) && packed_len < 64);
+    CHECK(id3_unpack(packed, packed_len, back, sizeof(back)) == 0);
+    CHECK(memcmp(raw, back, sizeof(raw)) == 0);
+    // A wrong output length is detected.
+    CHECK(id3_unpack(packed, packed_len, back, sizeof(back) - 1) != 0);
+}
+
+static void test_round_trip(void)
+{
+    const char *a = test_path("archive_a.mp3"), *b = test_path("archive_b.mp3");
+    TestFrame frames_a[] = { { "TIT2", "First", 0 }, { "APIC", "\x89PNG image", 10 } };
+    TestFrame frames_b[] = { { "TIT2", "Second", 0 }, { "TPE1", "Artist", 0 } };
+    CHECK(test_write_mp3(a, 3, frames_a, 2, 2000, 1000) == 0);
+    CHECK(test_write_mp3(b, 4, frames_b, 2, 0, 1000) == 0);
+
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, a);
+    id3_path_list_add(&files, b);
+    const char *archive = test_path("tags.archive");
+    CHECK(id3_archive_export(archive, &files, 2) == 0);
+    id3_path_list_free(&files);
+
+    // Change both files, one beyond what its tag can hold in place.
+    CHECK(edit_tag(a, "title", "Changed") == 0);
+    char longer[300];
+    memset(longer, 'x', sizeof(longer) - 1);
+    longer[sizeof(longer) - 1] = '\0';
+    CHECK(edit_tag(b, "comment", longer) == 0);
+
+    // Import restores the exported tags exactly, unknown frames included.
+    CHECK(id3_archive_import(archive) == 0);
+    TagData *da = read_id3_tags(a), *db = read_id3_tags(b);
+    CHECK(da && strcmp(tag_get(da, TAG_TITLE), "First") == 0 && da->art_bytes == 10);
+    CHECK(db && strcmp(tag_get(db, TAG_TITLE), "Second") == 0 && tag_get(db, TAG_COMMENT) == NULL);
+    CHECK(db && strcmp(db->version, "ID3v2.4.0") == 0);
+    free_tag_data(da);
+    free_tag_data(db);
+}
+
+static void test_unsupported_tags(void)
+{
+    // A v2.2 tag cannot be restored by import, so export reports it instead of archiving it.
+    const char *old = test_path("archive_v22.mp3");
+    TestFrame frames[] = { { "TT2\x00", "Old", 0 } };
+    CHECK(test_write_mp3(old, 2, frames, 1, 0, 1000) == 0);
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, old);
+    const char *archive = test_path("v22.archive");
+    CHECK(id3_archive_export(archive, &files, 1) == 1);
+    id3_path_list_free(&files);
+    CHECK(id3_archive_import(archive) == 0);
+    CHECK(test_count(archive, "archive_v22") == 0);
+}
+
+void test_archive(void)
+{
+    test_pack();
+    test_round_trip();
+    test_unsupported_tags();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file test_budget.c
+ * @brief Per-file time budgets: slow items are deferred to the end of a batch.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_batch.h"
+#include "id3_io.h"
+
+#define BUDGET_ITEMS 20 /**< Items of the test batch */
+#define SLOW_ITEM    3  /**< Item that outruns its budget */
+#define FAILING_ITEM 7  /**< Item that fails for another reason */
+
+/**
+ * @brief Record of the runs of a batch.
+ */
+typedef struct
+{
+    int fd;                      /**< File every item reads */
+    _Atomic int runs[BUDGET_ITEMS];
+    _Atomic int order;           /**< Runs started so far */
+    int slow_last_run;           /**< Value of @c order when the slow item last started */
+    int slow_timed_out;          /**< Whether the slow item's first read failed with ETIMEDOUT */
+} BudgetRun;
+
+static int budget_item(Id3Pool *pool, size_t index, void *ctx)
+{
+    (void)pool;
+    BudgetRun *run = (BudgetRun *)ctx;
+    int order = atomic_fetch_add(&run->order, 1);
+    int attempt = atomic_fetch_add(&run->runs[index], 1);
+    char buf[16];
+    if (index == SLOW_ITEM)
+    {
+        run->slow_last_run = order;
+        // The first run stalls past its budget; its next read is cancelled.
+        if (attempt == 0)
+        {
+            usleep(100000);
+            int ret = id3_pread_full(run->fd, buf, sizeof(buf), 0);
+            run->slow_timed_out = ret != 0 && errno == ETIMEDOUT && id3_io_deadline_hit();
+            return ret;
+        }
+    }
+    if (index == FAILING_ITEM) return -1;
+    return id3_pread_full(run->fd, buf, sizeof(buf), 0);
+}
+
+void test_budget(void)
+{
+    const char *path = test_path("budget.bin");
+    CHECK(test_write_text(path, "some bytes to read") == 0);
+    static BudgetRun run;
+    run.fd = open(path, O_RDONLY);
+    if (run.fd < 0) return;
+
+    // The slow item is deferred, not failed, and run again after every other item.
+    id3_batch_set_file_budget(50);
+    CHECK(id3_batch_run(BUDGET_ITEMS, 2, budget_item, &run) == 1);
+    id3_batch_set_file_budget(0);
+    CHECK(run.slow_timed_out);
+    CHECK(atomic_load(&run.runs[SLOW_ITEM]) == 2);
+    CHECK(run.slow_last_run == BUDGET_ITEMS);
+    for (int i = 0; i < BUDGET_ITEMS; i++)
+    {
+        if (i != SLOW_ITEM) CHECK(atomic_load(&run.runs[i]) == 1);
+    }
+
+    // Without a budget nothing is cancelled.
+    id3_io_set_deadline(0);
+    char buf[4];
+    CHECK(id3_pread_full(run.fd, buf, sizeof(buf), 0) == 0 && !id3_io_deadline_hit());
+    close(run.fd);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file test_cache.c
+ * @brief Tag cache: hits, revalidation after changes, and eviction.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_cache.h"
+#include "id3_writer.h"
+
+/**
+ * @brief Reads a file through the cache; returns non-zero if its title is @p title.
+ */
+static int cached_title_is(Id3Cache *cache, const char *path, const char *title)
+{
+    TagData *data = id3_cache_read(cache, NULL, path);
+    int ok = data && tag_get(data, TAG_TITLE) && strcmp(tag_get(data, TAG_TITLE), title) == 0;
+    free_tag_data(data);
+    return ok;
+}
+
+static void test_revalidation(void)
+{
+    const char *path = test_path("cached.mp3");
+    TestFrame frames[] = { { "TIT2", "First", 0 } };
+    CHECK(test_write_mp3(path, 3, frames, 1, 64, 0) == 0);
+    // An old modification time, so that the edit below changes it whatever the clock's granularity.
+    const struct timespec old[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    CHECK(utimensat(AT_FDCWD, path, old, 0) == 0);
+    Id3Cache *cache = id3_cache_create(1 << 20);
+    if (!cache) return;
+    Id3CacheStats stats;
+
+    // The second read is a hit.
+    CHECK(cached_title_is(cache, path, "First"));
+    CHECK(cached_title_is(cache, path, "First"));
+    id3_cache_stats(cache, &stats);
+    CHECK(stats.hits == 1 && stats.misses == 1 && stats.entries == 1);
+
+    // A same-size edit changes the modification time, so the file is read again.
+    CHECK(edit_tag(path, "title", "Other") == 0);
+    CHECK(cached_title_is(cache, path, "Other"));
+    id3_cache_stats(cache, &stats);
+    CHECK(stats.hits == 1 && stats.misses == 2);
+
+    // So is a file replaced by a rename, whose inode is new.
+    CHECK(edit_tag(path, "title", "A much longer title than before") == 0);
+    CHECK(cached_title_is(cache, path, "A much longer title than before"));
+    CHECK(cached_title_is(cache, path, "A much longer title than before"));
+    id3_cache_stats(cache, &stats);
+    CHECK(stats.hits == 2 && stats.misses == 3);
+
+    // Another name of the same file shares its entry.
+    char link_path[600];
+    snprintf(link_path, sizeof(link_path), "%s.link", path);
+    CHECK(link(path, link_path) == 0);
+    CHECK(cached_title_is(cache, link_path, "A much longer title than before"));
+    id3_cache_stats(cache, &stats);
+    CHECK(stats.hits == 3);
+
+    id3_cache_clear(cache);
+    id3_cache_stats(cache, &stats);
+    CHECK(stats.entries == 0 && stats.bytes == 0);
+    CHECK(id3_cache_read(cache, NULL, test_path("missing.mp3")) == NULL);
+    id3_cache_destroy(cache);
+}
+
+static void test_eviction(void)
+{
+    // A budget of a few tags per shard keeps the cache small however many files are read.
+    Id3Cache *cache = id3_cache_create(ID3_CACHE_SHARDS * 2048);
+    if (!cache) return;
+    char name[32], title[300];
+    memset(title, 't', sizeof(title) - 1);
+    title[sizeof(title) - 1] = '\0';
+    TestFrame frames[] = { { "TIT2", title, 0 } };
+    for (int i = 0; i < 200; i++)
+    {
+        snprintf(name, sizeof(name), "evict_%d.mp3", i);
+        CHECK(test_write_mp3(test_path(name), 3, frames, 1, 0, 0) == 0);
+        CHECK(cached_title_is(cache, test_path(name), title));
+    }
+    Id3CacheStats stats;
+    id3_cache_stats(cache, &stats);
+    CHECK(stats.evictions > 0 && stats.entries < 200);
+    CHECK(stats.bytes <= (size_t)ID3_CACHE_SHARDS * 2048);
+    id3_cache_destroy(cache);
+}
+
+void test_cache(void)
+{
+    test_revalidation();
+    test_eviction();
+}
@@ -0,0 +1,208 @@
+/**
+ * @file test_catalog.c
+ * @brief Lock-free catalog: updates, removal, and reclamation of replaced records.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_catalog.h"
+
+#define STRESS_PATHS   8
+#define STRESS_UPDATES 20000
+
+static TagData *titled(const char *title)
+{
+    TagData *data = create_tag_data();
+    if (data)
+    {
+        tag_set(data, TAG_TITLE, title);
+        tag_set(data, TAG_ARTIST, title);
+    }
+    return data;
+}
+
+static void test_basics(void)
+{
+    Id3Catalog *catalog = id3_catalog_create(4);
+    CHECK(catalog != NULL);
+    if (!catalog) return;
+    TagData *data = titled("One");
+    CHECK(id3_catalog_update(catalog, "a.mp3", data) == 0);
+    CHECK(id3_catalog_update(catalog, "b.mp3", data) == 0);
+    free_tag_data(data);
+    data = titled("Two");
+    CHECK(id3_catalog_update(catalog, "a.mp3", data) == 0);
+    CHECK(id3_catalog_count(catalog) == 2);
+
+    Id3CatalogReader reader;
+    CHECK(id3_catalog_reader_open(catalog, &reader) == 0);
+    id3_catalog_pin(&reader);
+    const Id3CatalogRecord *a = id3_catalog_find(catalog, "a.mp3");
+    const Id3CatalogRecord *b = id3_catalog_find(catalog, "b.mp3");
+    CHECK(a && strcmp(a->path, "a.mp3") == 0 && strcmp(tag_get(a->data, TAG_TITLE), "Two") == 0);
+    CHECK(a && b && a->version > b->version);
+    CHECK(id3_catalog_find(catalog, "c.mp3") == NULL);
+    id3_catalog_unpin(&reader);
+
+    // A removed path keeps its slot: it can come back, and the capacity counts it.
+    CHECK(id3_catalog_remove(catalog, "b.mp3") == 0 && id3_catalog_remove(catalog, "z.mp3") == 0);
+    CHECK(id3_catalog_count(catalog) == 1);
+    id3_catalog_pin(&reader);
+    CHECK(id3_catalog_find(catalog, "b.mp3") == NULL);
+    id3_catalog_unpin(&reader);
+    CHECK(id3_catalog_update(catalog, "b.mp3", data) == 0 && id3_catalog_count(catalog) == 2);
+    CHECK(id3_catalog_update(catalog, "c.mp3", data) == 0);
+    CHECK(id3_catalog_update(catalog, "d.mp3", data) == 0);
+    CHECK(id3_catalog_update(catalog, "e.mp3", data) == -1);
+    free_tag_data(data);
+
+    // Reader handles are limited.
+    static Id3CatalogReader many[ID3_CATALOG_MAX_READERS];
+    int opened = 0;
+    while (opened < ID3_CATALOG_MAX_READERS && id3_catalog_reader_open(catalog, &many[opened]) == 0) opened++;
+    CHECK(opened == ID3_CATALOG_MAX_READERS - 1);
+    id3_catalog_reader_close(&reader);
+    CHECK(id3_catalog_reader_open(catalog, &reader) == 0);
+    id3_catalog_reader_close(&reader);
+    for (int i = 0; i < opened; i++) id3_catalog_reader_close(&many[i]);
+    id3_catalog_destroy(catalog);
+}
+
+static void test_pinned_reader(void)
+{
+    Id3Catalog *catalog = id3_catalog_create(16);
+    if (!catalog) return;
+    TagData *data = titled("Original");
+    CHECK(id3_catalog_update(catalog, "a.mp3", data) == 0);
+    free_tag_data(data);
+
+    // While a reader stays pinned, nothing it may hold is freed.
+    Id3CatalogReader reader;
+    CHECK(id3_catalog_reader_open(catalog, &reader) == 0);
+    id3_catalog_pin(&reader);
+    const Id3CatalogRecord *held = id3_catalog_find(catalog, "a.mp3");
+    char title[32];
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(title, sizeof(title), "Update %d", i);
+        data = titled(title);
+        CHECK(id3_catalog_update(catalog, "a.mp3", data) == 0);
+        free_tag_data(data);
+    }
+    CHECK(id3_catalog_retired(catalog) == 1000);
+    CHECK(held && strcmp(tag_get(held->data, TAG_TITLE), "Original") == 0);
+    const Id3CatalogRecord *now = id3_catalog_find(catalog, "a.mp3");
+    CHECK(now && strcmp(tag_get(now->data, TAG_TITLE), "Update 999") == 0);
+    id3_catalog_unpin(&reader);
+
+    // Once it unpins, the backlog is freed by the following updates.
+    for (int i = 0; i < 200; i++)
+    {
+        data = titled("Later");
+        CHECK(id3_catalog_update(catalog, "a.mp3", data) == 0);
+        free_tag_data(data);
+    }
+    CHECK(id3_catalog_retired(catalog) < 64);
+
+    // A reader that pins and unpins around each lookup does not hold anything back.
+    for (int i = 0; i < 1000; i++)
+    {
+        id3_catalog_pin(&reader);
+        CHECK(id3_catalog_find(catalog, "a.mp3") != NULL);
+        id3_catalog_unpin(&reader);
+        data = titled("Again");
+        CHECK(id3_catalog_update(catalog, i % 2 ? "a.mp3" : "b.mp3", data) == 0);
+        free_tag_data(data);
+    }
+    CHECK(id3_catalog_retired(catalog) < 64);
+    id3_catalog_reader_close(&reader);
+    id3_catalog_destroy(catalog);
+}
+
+typedef struct
+{
+    Id3Catalog *catalog;
+    int id;
+    _Atomic int *done;
+    int torn;
+} StressArgs;
+
+static void *stress_writer(void *arg)
+{
+    StressArgs *args = (StressArgs *)arg;
+    char path[32], value[32];
+    for (int i = 0; i < STRESS_UPDATES; i++)
+    {
+        snprintf(path, sizeof(path), "%d.mp3", i % STRESS_PATHS);
+        snprintf(value, sizeof(value), "w%d-%d", args->id, i);
+        TagData *data = titled(value);
+        if (i % 97 == 0) id3_catalog_remove(args->catalog, path);
+        else id3_catalog_update(args->catalog, path, data);
+        free_tag_data(data);
+    }
+    return NULL;
+}
+
+static void *stress_reader(void *arg)
+{
+    StressArgs *args = (StressArgs *)arg;
+    Id3CatalogReader reader;
+    if (id3_catalog_reader_open(args->catalog, &reader) != 0) return NULL;
+    char path[32];
+    for (int i = 0; !atomic_load(args->done); i++)
+    {
+        snprintf(path, sizeof(path), "%d.mp3", i % STRESS_PATHS);
+        id3_catalog_pin(&reader);
+        const Id3CatalogRecord *r = id3_catalog_find(args->catalog, path);
+        // Both fields of a record were written together; a freed and reused record would not match.
+        if (r && (strcmp(r->path, path) != 0 || strcmp(tag_get(r->data, TAG_TITLE), tag_get(r->data, TAG_ARTIST)) != 0))
+            args->torn++;
+        id3_catalog_unpin(&reader);
+    }
+    id3_catalog_reader_close(&reader);
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    Id3Catalog *catalog = id3_catalog_create(STRESS_PATHS);
+    if (!catalog) return;
+    _Atomic int done = 0;
+    pthread_t writers[2], readers[4];
+    StressArgs wargs[2], rargs[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rargs[i] = (StressArgs){ catalog, i, &done, 0 };
+        pthread_create(&readers[i], NULL, stress_reader, &rargs[i]);
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        wargs[i] = (StressArgs){ catalog, i, &done, 0 };
+        pthread_create(&writers[i], NULL, stress_writer, &wargs[i]);
+    }
+    for (int i = 0; i < 2; i++) pthread_join(writers[i], NULL);
+    atomic_store(&done, 1);
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_join(readers[i], NULL);
+        CHECK(rargs[i].torn == 0);
+    }
+    CHECK(id3_catalog_count(catalog) <= STRESS_PATHS);
+
+    // A reader descheduled while pinned may have held back a backlog; it drains once readers are gone.
+    TagData *data = titled("Last");
+    for (int i = 0; i < 200; i++) id3_catalog_update(catalog, "0.mp3", data);
+    free_tag_data(data);
+    CHECK(id3_catalog_retired(catalog) < 64);
+    id3_catalog_destroy(catalog);
+}
+
+void test_catalog(void)
+{
+    test_basics();
+    test_pinned_reader();
+    test_concurrent();
+}
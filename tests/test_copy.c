@@ -0,0 +1,88 @@
+/**
+ * @file test_copy.c
+ * @brief Applying one file's tags to many targets with id3_copy_tags().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+
+#define COPY_TARGETS 6
+#define PICTURE_SIZE 200 /**< Bytes of each target's picture frame */
+
+/**
+ * @brief Returns non-zero if the bytes after the tag of @p path equal @p audio_len bytes of fixture audio.
+ */
+static int audio_intact(const char *path, size_t audio_len)
+{
+    const char *ref = test_path("copy_ref.mp3");
+    if (test_write_mp3(ref, 3, NULL, 0, 0, audio_len) != 0) return 0;
+    size_t len, ref_len;
+    char *bytes = test_read_file(path, &len), *ref_bytes = test_read_file(ref, &ref_len);
+    int ok = bytes && ref_bytes && len >= ref_len - ID3_HEADER_SIZE &&
+             memcmp(bytes + len - (ref_len - ID3_HEADER_SIZE), ref_bytes + ID3_HEADER_SIZE,
+                    ref_len - ID3_HEADER_SIZE) == 0;
+    free(bytes);
+    free(ref_bytes);
+    return ok;
+}
+
+void test_copy(void)
+{
+    const char *source = test_path("copy_src.mp3");
+    TestFrame src_frames[] =
+    {
+        { "TPE1", "Band", 0 }, { "TALB", "Album", 0 }, { "TYER", "2020", 0 },
+        { "TRCK", "7", 0 }, { "TXXX", "\0key\0value", 10 },
+    };
+    CHECK(test_write_mp3(source, 3, src_frames, 5, 0, 100) == 0);
+
+    // Targets of both versions, with and without room, each with its own title, album and picture.
+    static char names[COPY_TARGETS][512];
+    char *targets[COPY_TARGETS];
+    char picture[PICTURE_SIZE];
+    for (int i = 0; i < PICTURE_SIZE; i++) picture[i] = (char)(i * 5 + 1);
+    for (int i = 0; i < COPY_TARGETS; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "copy_%d.mp3", i);
+        snprintf(names[i], sizeof(names[i]), "%s", test_path(name));
+        TestFrame frames[] =
+        {
+            { "TIT2", "Own title", 0 }, { "APIC", picture, PICTURE_SIZE }, { "TALB", "Old album", 0 },
+        };
+        CHECK(test_write_mp3(names[i], i < 3 ? 3 : 4, frames, 3, i % 2 ? 1024 : 0, 2000) == 0);
+        targets[i] = names[i];
+    }
+
+    CHECK(id3_copy_tags(source, targets, COPY_TARGETS, 0, 3) == 0);
+    for (int i = 0; i < COPY_TARGETS; i++)
+    {
+        TagData *data = read_id3_tags(names[i]);
+        CHECK(data && strcmp(tag_get(data, TAG_TITLE), "Own title") == 0);
+        CHECK(data && strcmp(tag_get(data, TAG_ARTIST), "Band") == 0);
+        CHECK(data && strcmp(tag_get(data, TAG_ALBUM), "Album") == 0);
+        CHECK(data && strcmp(tag_get(data, TAG_TRACK), "7") == 0);
+        CHECK(data && data->art_bytes == PICTURE_SIZE && data->version[6] == (i < 3 ? '3' : '4'));
+        CHECK(test_count(names[i], "APIC") == 1 && test_count(names[i], "TXXX") == 0);
+        CHECK(audio_intact(names[i], 2000));
+        free_tag_data(data);
+    }
+
+    // Numbered tracks follow the order of the targets.
+    CHECK(id3_copy_tags(source, targets, COPY_TARGETS, 1, 2) == 0);
+    for (int i = 0; i < COPY_TARGETS; i++)
+    {
+        char track[16];
+        snprintf(track, sizeof(track), "%d/%d", i + 1, COPY_TARGETS);
+        TagData *data = read_id3_tags(names[i]);
+        CHECK(data && strcmp(tag_get(data, TAG_TRACK), track) == 0);
+        CHECK(data && strcmp(tag_get(data, TAG_ALBUM), "Album") == 0 && data->art_bytes == PICTURE_SIZE);
+        free_tag_data(data);
+    }
+
+    CHECK(id3_copy_tags(test_path("copy_missing.mp3"), targets, COPY_TARGETS, 0, 1) == -1);
+}
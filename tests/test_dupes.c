@@ -0,0 +1,155 @@
+/**
+ * @file test_dupes.c
+ * @brief Duplicate keys, bounded edit distance and duplicate groups.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_dupes.h"
+
+/**
+ * @brief Returns non-zero if the key of @p value is @p expect.
+ */
+static int key_is(const char *value, int artist, const char *expect)
+{
+    char *key = id3_dupe_key(value, strlen(value), artist);
+    int ok = key && strcmp(key, expect) == 0;
+    free(key);
+    return ok;
+}
+
+/**
+ * @brief Plain dynamic-programming Levenshtein distance, the reference for the fast versions.
+ */
+static int reference_distance(const char *a, size_t alen, const char *b, size_t blen)
+{
+    int *row = (int *)malloc((blen + 1) * sizeof(int));
+    for (size_t j = 0; j <= blen; j++) row[j] = (int)j;
+    for (size_t i = 1; i <= alen; i++)
+    {
+        int diag = row[0];
+        row[0] = (int)i;
+        for (size_t j = 1; j <= blen; j++)
+        {
+            int up = row[j];
+            int best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    int d = row[blen];
+    free(row);
+    return d;
+}
+
+static void test_keys(void)
+{
+    CHECK(key_is("The Beatles", 1, "beatles"));
+    CHECK(key_is("Beatles, The", 1, "beatles"));
+    CHECK(key_is("  Hey   Jude! ", 0, "hey jude"));
+    CHECK(key_is("The End", 0, "the end"));
+    CHECK(key_is("Cafe\xCC\x81", 0, "caf\xC3\xA9"));
+}
+
+static void test_distance(void)
+{
+    CHECK(id3_edit_distance("kitten", 6, "sitting", 7, 5) == 3);
+    CHECK(id3_edit_distance("same", 4, "same", 4, 2) == 0);
+    CHECK(id3_edit_distance("", 0, "abc", 3, 5) == 3);
+    CHECK(id3_edit_distance("abcdef", 6, "uvwxyz", 6, 2) > 2);
+
+    // Random strings on both sides of the 64-byte bit-parallel limit agree with the reference.
+    char a[100], b[100];
+    srand(1);
+    for (int round = 0; round < 500; round++)
+    {
+        size_t alen = (size_t)(rand() % 90), blen = alen;
+        for (size_t i = 0; i < alen; i++) a[i] = (char)('a' + rand() % 4);
+        memcpy(b, a, alen);
+        // A few random edits.
+        for (int e = rand() % 5; e > 0; e--)
+        {
+            size_t at = blen ? (size_t)rand() % blen : 0;
+            int kind = rand() % 3;
+            if (kind == 0 && blen) b[at] = (char)('a' + rand() % 4);
+            else if (kind == 1 && blen) memmove(b + at, b + at + 1, --blen - at);
+            else if (blen < sizeof(b))
+            {
+                memmove(b + at + 1, b + at, blen++ - at);
+                b[at] = 'z';
+            }
+        }
+        int expect = reference_distance(a, alen, b, blen);
+        for (int max = 0; max <= 4; max++)
+        {
+            int d = id3_edit_distance(a, alen, b, blen, max);
+            CHECK(expect <= max ? d == expect : d > max);
+        }
+    }
+}
+
+static void test_groups(void)
+{
+    TestFrame one[] = { { "TPE1", "The Beatles", 0 }, { "TIT2", "Hey Jude", 0 } };
+    TestFrame two[] = { { "TPE1", "Beatles, The", 0 }, { "TIT2", "Hey Jud", 0 } };
+    TestFrame three[] = { { "TPE1", "Beatles", 0 }, { "TIT2", "Let It Be", 0 } };
+    CHECK(test_write_mp3(test_path("dupe_1.mp3"), 3, one, 2, 0, 0) == 0);
+    CHECK(test_write_mp3(test_path("dupe_2.mp3"), 3, two, 2, 0, 0) == 0);
+    CHECK(test_write_mp3(test_path("dupe_3.mp3"), 3, three, 2, 0, 0) == 0);
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, test_path("dupe_1.mp3"));
+    id3_path_list_add(&files, test_path("dupe_2.mp3"));
+    id3_path_list_add(&files, test_path("dupe_3.mp3"));
+
+    const char *out_path = test_path("dupes.out");
+    FILE *out = fopen(out_path, "w");
+    if (!out) return;
+    CHECK(id3_find_duplicates(&files, NULL, 2, ID3_DUPES_DEFAULT_DISTANCE, out) == 1);
+    CHECK(id3_find_duplicates(&files, NULL, 2, 0, out) == 0);
+    fclose(out);
+    CHECK(test_count(out_path, "Group 1 (2 files)") == 1);
+    CHECK(test_count(out_path, "dupe_3.mp3") == 0);
+    id3_path_list_free(&files);
+}
+
+static void test_interleaved_groups(void)
+{
+    // Members of different groups alternate in path order; each group still lists its own in order.
+    const char *index = test_path("dupes.idx");
+    CHECK(test_write_text(index,
+        "path\tartist\ttitle\n"
+        "p0.mp3\tArtist A\tSong A\n"
+        "p1.mp3\tArtist B\tSong B\n"
+        "p2.mp3\tArtist A\tSong A\n"
+        "p3.mp3\tSomeone\tUnique\n"
+        "p4.mp3\tArtist B\tSong B\n"
+        "p5.mp3\tArtist A\tSong A\n") == 0);
+    const char *out_path = test_path("dupes_index.out");
+    FILE *out = fopen(out_path, "w");
+    if (!out) return;
+    CHECK(id3_find_duplicates(NULL, index, 2, 0, out) == 2);
+    fclose(out);
+    size_t len;
+    char *text = test_read_file(out_path, &len);
+    CHECK(text && strcmp(text,
+        "Group 1 (3 files):\n"
+        "  p0.mp3: Artist A - Song A\n"
+        "  p2.mp3: Artist A - Song A\n"
+        "  p5.mp3: Artist A - Song A\n"
+        "Group 2 (2 files):\n"
+        "  p1.mp3: Artist B - Song B\n"
+        "  p4.mp3: Artist B - Song B\n") == 0);
+    free(text);
+}
+
+void test_dupes(void)
+{
+    test_keys();
+    test_distance();
+    test_groups();
+    test_interleaved_groups();
+}
@@ -0,0 +1,86 @@
+/**
+ * @file test_hardlink.c
+ * @brief Growing the tag of a hardlinked file keeps its inode and every name of it.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+
+/**
+ * @brief Returns the number of entries of @p dir, "." and ".." excluded.
+ */
+static int count_entries(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+    int n = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL)
+    {
+        if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0) n++;
+    }
+    closedir(d);
+    return n;
+}
+
+/**
+ * @brief Edits a file with two names in @p dir so that its tag must grow.
+ */
+static void grow_linked(const char *dir)
+{
+    char path[600], link_path[600];
+    snprintf(path, sizeof(path), "%s/song.mp3", dir);
+    snprintf(link_path, sizeof(link_path), "%s/alias.mp3", dir);
+    char picture[64];
+    memset(picture, 'p', sizeof(picture));
+    TestFrame frames[] = { { "TIT2", "Title", 0 }, { "APIC", picture, sizeof(picture) } };
+    CHECK(test_write_mp3(path, 3, frames, 2, 0, 40000) == 0);
+    CHECK(link(path, link_path) == 0);
+    struct stat before, after;
+    CHECK(stat(path, &before) == 0);
+
+    CHECK(edit_tag(path, "title", "A title long enough to need a larger tag") == 0);
+    CHECK(stat(path, &after) == 0);
+    CHECK(after.st_ino == before.st_ino && after.st_nlink == 2);
+    CHECK(after.st_size > before.st_size);
+
+    // The other name sees the new tag, with the picture and the audio intact.
+    TagData *data = read_id3_tags(link_path);
+    CHECK(data && strcmp(tag_get(data, TAG_TITLE), "A title long enough to need a larger tag") == 0);
+    CHECK(data && data->art_bytes == sizeof(picture));
+    free_tag_data(data);
+    CHECK(test_count(link_path, "\xFF\xFB\x90") == test_count(path, "\xFF\xFB\x90"));
+    CHECK(test_count(link_path, "\xFF\xFB\x90") >= 40000 / 417);
+
+    // No temporary file is left behind.
+    CHECK(count_entries(dir) == 2);
+}
+
+void test_hardlink(void)
+{
+    // Where ranges can be inserted (ext4, XFS), the tag grows in place.
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", test_path("linked"));
+    CHECK(mkdir(dir, 0755) == 0);
+    grow_linked(dir);
+
+    // tmpfs cannot insert ranges, so the new content is copied back over the original.
+    char shm_dir[] = "/dev/shm/id3_tests.XXXXXX";
+    if (!mkdtemp(shm_dir)) return;
+    grow_linked(shm_dir);
+    char path[600];
+    snprintf(path, sizeof(path), "%s/song.mp3", shm_dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/alias.mp3", shm_dir);
+    unlink(path);
+    rmdir(shm_dir);
+}
@@ -0,0 +1,148 @@
+/**
+ * @file test_index.c
+ * @brief Library indexes: build, read, merge, and diffs of files and indexes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_diff.h"
+#include "id3_index.h"
+#include "id3_scan.h"
+#include "id3_writer.h"
+
+/**
+ * @brief Writes a fixture tagged with @p title and @p artist.
+ */
+static void make_file(const char *name, const char *title, const char *artist)
+{
+    TestFrame frames[] = { { "TIT2", title, 0 }, { "TPE1", artist, 0 } };
+    CHECK(test_write_mp3(test_path(name), 3, frames, 2, 64, 500) == 0);
+}
+
+/**
+ * @brief Builds an index of the named scratch files.
+ */
+static long build(const char *index, const char *const names[], int count)
+{
+    Id3PathList files = { 0 };
+    for (int i = 0; i < count; i++) id3_path_list_add(&files, test_path(names[i]));
+    long ret = id3_index_build(test_path(index), &files, 2);
+    id3_path_list_free(&files);
+    return ret;
+}
+
+/**
+ * @brief Runs a diff of two indexes; returns its result and the text it printed.
+ */
+static long diff(const char *a, const char *b, char **text)
+{
+    const char *out_path = test_path("diff.out");
+    FILE *out = fopen(out_path, "w");
+    if (!out) return -2;
+    long ret = id3_diff_indexes(test_path(a), test_path(b), out);
+    fclose(out);
+    *text = test_read_file(out_path, NULL);
+    return ret;
+}
+
+static void test_build_and_read(void)
+{
+    make_file("ix_b.mp3", "B title", "B artist");
+    make_file("ix_a.mp3", "A title", "A artist");
+    make_file("ix_c.mp3", "C title", "C artist");
+    const char *names[] = { "ix_a.mp3", "ix_b.mp3", "ix_c.mp3" };
+    CHECK(build("all.idx", names, 3) == 0);
+
+    // Rows come back sorted by path with their fields.
+    Id3IndexReader reader;
+    CHECK(id3_index_open(&reader, test_path("all.idx")) == 0);
+    const char *expect[] = { "A title", "B title", "C title" };
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(id3_index_next(&reader) == 1);
+        CHECK(strcmp(tag_get(reader.record, TAG_TITLE), expect[i]) == 0);
+    }
+    CHECK(id3_index_next(&reader) == 0);
+    id3_index_close(&reader);
+}
+
+static void test_merge(void)
+{
+    // Fragments, e.g. of two shards, merge into the index of the whole library.
+    const char *first[] = { "ix_a.mp3", "ix_c.mp3" }, *second[] = { "ix_b.mp3", "ix_c.mp3" };
+    CHECK(build("part1.idx", first, 2) == 0);
+    CHECK(build("part2.idx", second, 2) == 0);
+    char p1[512], p2[512];
+    snprintf(p1, sizeof(p1), "%s", test_path("part1.idx"));
+    snprintf(p2, sizeof(p2), "%s", test_path("part2.idx"));
+    char *inputs[] = { p1, p2 };
+    CHECK(id3_index_merge(test_path("merged.idx"), inputs, 2) == 3);
+
+    char *merged = test_read_file(test_path("merged.idx"), NULL);
+    char *all = test_read_file(test_path("all.idx"), NULL);
+    CHECK(merged && all && strcmp(merged, all) == 0);
+    free(merged);
+    free(all);
+}
+
+static void test_diffs(void)
+{
+    // Two files.
+    const char *out_path = test_path("diff.out");
+    FILE *out = fopen(out_path, "w");
+    if (!out) return;
+    CHECK(id3_diff_files(test_path("ix_a.mp3"), test_path("ix_b.mp3"), out) == 2);
+    CHECK(id3_diff_files(test_path("ix_a.mp3"), test_path("ix_a.mp3"), out) == 0);
+    fclose(out);
+
+    // Two snapshots: one file removed, one added, one changed.
+    make_file("ix_d.mp3", "D title", "D artist");
+    const char *before[] = { "ix_a.mp3", "ix_b.mp3", "ix_c.mp3" };
+    CHECK(build("before.idx", before, 3) == 0);
+    CHECK(edit_tag(test_path("ix_b.mp3"), "title", "B changed") == 0);
+    const char *after[] = { "ix_b.mp3", "ix_c.mp3", "ix_d.mp3" };
+    CHECK(build("after.idx", after, 3) == 0);
+
+    char *text = NULL;
+    CHECK(diff("before.idx", "after.idx", &text) == 3);
+    CHECK(text && strstr(text, "- ") && strstr(text, "ix_a.mp3\n"));
+    CHECK(text && strstr(text, "+ ") && strstr(text, "ix_d.mp3\n"));
+    CHECK(text && strstr(text, "~ ") && strstr(text, "B changed"));
+    free(text);
+}
+
+static void test_diff_stops_on_error(void)
+{
+    // An index that repeats its first row fails at the second one. The rows still left on
+    // the other side must not be reported as removed.
+    char *good = test_read_file(test_path("before.idx"), NULL);
+    if (!good) return;
+    char *header_end = strchr(good, '\n');
+    char *first_row_end = header_end ? strchr(header_end + 1, '\n') : NULL;
+    CHECK(first_row_end != NULL);
+    if (!first_row_end) return;
+    first_row_end[1] = '\0';
+    size_t len = strlen(good);
+    char *bad = (char *)malloc(2 * len + 1);
+    if (!bad) return;
+    memcpy(bad, good, len);
+    strcpy(bad + len, header_end + 1);
+    CHECK(test_write_text(test_path("bad.idx"), bad) == 0);
+
+    char *text = NULL;
+    CHECK(diff("before.idx", "bad.idx", &text) == -1);
+    CHECK(text && strstr(text, "ix_b.mp3") == NULL && strstr(text, "ix_c.mp3") == NULL);
+    free(text);
+    free(bad);
+    free(good);
+}
+
+void test_index(void)
+{
+    test_build_and_read();
+    test_merge();
+    test_diffs();
+    test_diff_stops_on_error();
+}
@@ -0,0 +1,99 @@
+/**
+ * @file test_intern.c
+ * @brief String interning table, also under concurrent use.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_intern.h"
+
+#define INTERN_THREADS 4
+#define INTERN_VALUES  500
+
+static void test_ids(void)
+{
+    Id3InternTable *table = id3_intern_create(4);
+    CHECK(table != NULL);
+    if (!table) return;
+
+    unsigned int rock = id3_intern(table, "Rock", 4);
+    CHECK(rock != ID3_INTERN_NONE);
+    CHECK(id3_intern(table, "Rock and Roll", 4) == rock); // Only the first len bytes count
+    CHECK(id3_intern(table, "Pop", 3) != rock);
+    CHECK(strcmp(id3_intern_string(table, rock), "Rock") == 0);
+    CHECK(id3_intern_find(table, "Pop", 3) != ID3_INTERN_NONE);
+    CHECK(id3_intern_find(table, "Jazz", 4) == ID3_INTERN_NONE);
+    CHECK(id3_intern_count(table) == 2);
+
+    // A full table refuses new strings but still knows the old ones.
+    id3_intern(table, "Jazz", 4);
+    id3_intern(table, "Folk", 4);
+    CHECK(id3_intern(table, "Metal", 5) == ID3_INTERN_NONE);
+    CHECK(id3_intern(table, "Rock", 4) == rock);
+    id3_intern_destroy(table);
+}
+
+static void test_tag_fields(void)
+{
+    Id3InternTable *table = id3_intern_create(0);
+    if (!table) return;
+    TagData *a = create_tag_data(), *b = create_tag_data();
+    tag_set(a, TAG_ARTIST, "Band");
+    tag_set(a, TAG_GENRE, "Rock");
+    tag_set(b, TAG_ARTIST, "Band");
+
+    unsigned int ia[TAG_FIELD_COUNT], ib[TAG_FIELD_COUNT];
+    id3_intern_tag(table, a, ia);
+    id3_intern_tag(table, b, ib);
+    CHECK(ia[TAG_ARTIST] == ib[TAG_ARTIST] && ia[TAG_ARTIST] != ID3_INTERN_NONE);
+    CHECK(ib[TAG_GENRE] == ID3_INTERN_NONE); // Unset
+    CHECK(ia[TAG_TITLE] == ID3_INTERN_NONE);  // Not an interned field
+    free_tag_data(a);
+    free_tag_data(b);
+    id3_intern_destroy(table);
+}
+
+static Id3InternTable *shared;
+static unsigned int seen[INTERN_THREADS][INTERN_VALUES];
+
+static void *intern_worker(void *arg)
+{
+    int t = (int)(size_t)arg;
+    char value[32];
+    for (int i = 0; i < INTERN_VALUES; i++)
+    {
+        int v = (i * 7 + t * 13) % INTERN_VALUES;
+        int n = snprintf(value, sizeof(value), "value %d", v);
+        seen[t][v] = id3_intern(shared, value, (size_t)n);
+    }
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    shared = id3_intern_create(0);
+    if (!shared) return;
+    pthread_t threads[INTERN_THREADS];
+    for (int t = 0; t < INTERN_THREADS; t++)
+    {
+        pthread_create(&threads[t], NULL, intern_worker, (void *)(size_t)t);
+    }
+    for (int t = 0; t < INTERN_THREADS; t++) pthread_join(threads[t], NULL);
+
+    // Every thread got the same ID for the same string, and each string is stored once.
+    CHECK(id3_intern_count(shared) == INTERN_VALUES);
+    for (int v = 0; v < INTERN_VALUES; v++)
+    {
+        for (int t = 1; t < INTERN_THREADS; t++) CHECK(seen[t][v] == seen[0][v]);
+    }
+    id3_intern_destroy(shared);
+}
+
+void test_intern(void)
+{
+    test_ids();
+    test_tag_fields();
+    test_concurrent();
+}
@@ -0,0 +1,60 @@
+/**
+ * @file test_io.c
+ * @brief 64-bit offsets and positioned I/O.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_io.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+
+#define BEYOND_4G (5LL << 30) /**< An offset that does not fit in 32 bits */
+
+static void test_positioned_io(void)
+{
+    const char *path = test_path("large.bin");
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+
+    // Positioned I/O leaves the file offset alone and reaches past 4 GiB (the file is sparse).
+    char out[] = "far away", in[sizeof(out)] = "";
+    CHECK(id3_pwrite_full(fd, out, sizeof(out), BEYOND_4G) == 0);
+    CHECK(lseek(fd, 0, SEEK_CUR) == 0);
+    CHECK(id3_pread_full(fd, in, sizeof(in), BEYOND_4G) == 0);
+    CHECK(memcmp(in, out, sizeof(out)) == 0);
+
+    // Reading past the end is an error, not a short read.
+    CHECK(id3_pread_full(fd, in, sizeof(in), BEYOND_4G + 4) != 0);
+    close(fd);
+    unlink(path);
+}
+
+static void test_large_file_edit(void)
+{
+    const char *path = test_path("large.mp3");
+    TestFrame frames[] = { { "TIT2", "Title", 0 }, { "TPE1", "Artist", 0 } };
+    CHECK(test_write_mp3(path, 3, frames, 2, 256, 4096) == 0);
+    CHECK(truncate(path, BEYOND_4G) == 0);
+
+    // The tag of a multi-GB file is read and edited in place without touching the audio.
+    CHECK(edit_tag(path, "title", "A longer title") == 0);
+    TagData *data = read_id3_tags(path);
+    CHECK(data && strcmp(tag_get(data, TAG_TITLE), "A longer title") == 0);
+    CHECK(data && strcmp(tag_get(data, TAG_ARTIST), "Artist") == 0);
+    free_tag_data(data);
+    CHECK(test_file_size(path) == BEYOND_4G);
+    unlink(path);
+}
+
+void test_io(void)
+{
+    test_positioned_io();
+    test_large_file_edit();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file test_lock.c
+ * @brief Exclusive and optimistic locking of concurrent edits.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_lock.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+
+#define EDIT_THREADS 4  /**< Threads editing one file at once */
+#define EDIT_ROUNDS  10 /**< Edits made by each thread */
+
+static const char *edit_fields[EDIT_THREADS] = { "title", "artist", "album", "comment" };
+
+static const char *shared_path;
+
+/**
+ * @brief Makes edits of one field, each longer than the last so that most rewrite the tag.
+ */
+static void *edit_thread(void *arg)
+{
+    int thread = (int)(size_t)arg;
+    char value[64];
+    for (int round = 0; round < EDIT_ROUNDS; round++)
+    {
+        snprintf(value, sizeof(value), "%s %0*d", edit_fields[thread], round + 1, round);
+        CHECK(edit_tag(shared_path, edit_fields[thread], value) == 0);
+    }
+    return NULL;
+}
+
+static void test_concurrent_edits(Id3LockMode mode, const char *name)
+{
+    shared_path = test_path(name);
+    TestFrame frames[] = { { "TIT2", "t", 0 } };
+    CHECK(test_write_mp3(shared_path, 3, frames, 1, 0, 2000) == 0);
+    id3_lock_set_mode(mode);
+
+    // No edit is lost: each thread's last value is in the file at the end.
+    pthread_t threads[EDIT_THREADS];
+    for (int i = 0; i < EDIT_THREADS; i++) pthread_create(&threads[i], NULL, edit_thread, (void *)(size_t)i);
+    for (int i = 0; i < EDIT_THREADS; i++) pthread_join(threads[i], NULL);
+    id3_lock_set_mode(ID3_LOCK_EXCLUSIVE);
+
+    TagData *data = read_id3_tags(shared_path);
+    CHECK(data != NULL);
+    if (!data) return;
+    char value[64];
+    for (int i = 0; i < EDIT_THREADS; i++)
+    {
+        snprintf(value, sizeof(value), "%s %0*d", edit_fields[i], EDIT_ROUNDS, EDIT_ROUNDS - 1);
+        const char *got = tag_get(data, (TagField)tag_field_from_name(edit_fields[i]));
+        CHECK(got && strcmp(got, value) == 0);
+    }
+    free_tag_data(data);
+}
+
+static void test_change_detection(void)
+{
+    const char *path = test_path("stamp.mp3");
+    TestFrame frames[] = { { "TIT2", "Title", 0 } };
+    CHECK(test_write_mp3(path, 3, frames, 1, 64, 0) == 0);
+    TagData *data = read_id3_tags(path);
+    if (!data) return;
+
+    int lock = id3_lock_file(path);
+    CHECK(lock >= 0 && id3_file_unchanged(lock, &data->source));
+    id3_unlock_file(lock);
+
+    // Another writer changes the tag, even without changing the file's size.
+    TagData *other = read_id3_tags(path);
+    tag_set(other, TAG_TITLE, "Other");
+    CHECK(other && update_id3_tags_pooled(NULL, path, other) == 0);
+    free_tag_data(other);
+    lock = id3_lock_file(path);
+    CHECK(lock >= 0 && !id3_file_unchanged(lock, &data->source));
+    id3_unlock_file(lock);
+    free_tag_data(data);
+}
+
+static void test_random(void)
+{
+    // The per-thread generator does not get stuck.
+    unsigned int a = id3_random(), b = id3_random(), c = id3_random();
+    CHECK(a != b || b != c);
+}
+
+void test_lock(void)
+{
+    test_concurrent_edits(ID3_LOCK_EXCLUSIVE, "exclusive.mp3");
+    test_concurrent_edits(ID3_LOCK_OPTIMISTIC, "optimistic.mp3");
+    test_change_detection();
+    test_random();
+}
@@ -0,0 +1,72 @@
+/**
+ * @file test_main.c
+ * @brief Test driver: runs every suite, or the suites named on the command line.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+
+/**
+ * @brief Suites in the order of the features they cover.
+ */
+static const struct
+{
+    const char *name;
+    void (*run)(void);
+} suites[] =
+{
+    { "io",         test_io },
+    { "parser",     test_parser },
+    { "pool",       test_pool },
+    { "tagdata",    test_tagdata },
+    { "intern",     test_intern },
+    { "manifest",   test_manifest },
+    { "archive",    test_archive },
+    { "copy",       test_copy },
+    { "pattern",    test_pattern },
+    { "index",      test_index },
+    { "normalize",  test_normalize },
+    { "writer",     test_writer },
+    { "stats",      test_stats },
+    { "dupes",      test_dupes },
+    { "playlist",   test_playlist },
+    { "lock",       test_lock },
+    { "shard",      test_shard },
+    { "queue",      test_queue },
+    { "budget",     test_budget },
+    { "retry",      test_retry },
+    { "rate",       test_rate },
+    { "hardlink",   test_hardlink },
+    { "cache",      test_cache },
+    { "shm",        test_shm },
+    { "catalog",    test_catalog },
+};
+
+int main(int argc, char *argv[])
+{
+    if (test_scratch_create() != 0)
+    {
+        fprintf(stderr, "Cannot create a scratch directory.\n");
+        return 1;
+    }
+    int ran = 0;
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++)
+    {
+        int selected = argc < 2;
+        for (int a = 1; a < argc && !selected; a++) selected = strcmp(argv[a], suites[i].name) == 0;
+        if (!selected) continue;
+        int before = test_failures();
+        suites[i].run();
+        printf("%-12s %s\n", suites[i].name, test_failures() == before ? "ok" : "FAILED");
+        ran++;
+    }
+    test_scratch_remove();
+    if (ran == 0)
+    {
+        fprintf(stderr, "No such suite.\n");
+        return 1;
+    }
+    printf("%d suite(s), %d failed check(s)\n", ran, test_failures());
+    return test_failures() ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file test_manifest.c
+ * @brief Loading bulk-edit manifests and applying them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_manifest.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+
+static void test_load(void)
+{
+    const char *csv = test_path("edits.csv");
+    char text[1024];
+    snprintf(text, sizeof(text),
+             "path,title,artist,year\n"
+             "a.mp3,\"Hello, World\",Band,\n"
+             "b.mp3,,Other,1999\n"
+             "a.mp3,,,2001\n"
+             "\"c \"\"quoted\"\".mp3\",T,,\n");
+    CHECK(test_write_text(csv, text) == 0);
+
+    Id3Manifest manifest;
+    CHECK(id3_manifest_load(csv, &manifest) == 0);
+    CHECK(manifest.rows == 4 && manifest.count == 3);
+    if (manifest.count != 3) return;
+
+    // Rows naming the same file are merged; empty cells change nothing.
+    const Id3ManifestEdit *a = &manifest.edits[0];
+    CHECK(strcmp(a->path, "a.mp3") == 0);
+    CHECK(a->set_mask == ((1u << TAG_TITLE) | (1u << TAG_ARTIST) | (1u << TAG_YEAR)));
+    CHECK(strcmp(tag_get(a->values, TAG_TITLE), "Hello, World") == 0);
+    CHECK(strcmp(tag_get(a->values, TAG_YEAR), "2001") == 0);
+    CHECK(manifest.edits[1].set_mask == ((1u << TAG_ARTIST) | (1u << TAG_YEAR)));
+    CHECK(strcmp(manifest.edits[2].path, "c \"quoted\".mp3") == 0);
+    id3_manifest_free(&manifest);
+
+    // Tab-separated manifests are detected from the header.
+    CHECK(test_write_text(csv, "path\tgenre\nx.mp3\tRock, Pop\n") == 0);
+    CHECK(id3_manifest_load(csv, &manifest) == 0);
+    CHECK(manifest.count == 1 && strcmp(tag_get(manifest.edits[0].values, TAG_GENRE), "Rock, Pop") == 0);
+    id3_manifest_free(&manifest);
+
+    // Unknown columns and a missing path column are rejected.
+    CHECK(test_write_text(csv, "path,colour\nx.mp3,red\n") == 0);
+    CHECK(id3_manifest_load(csv, &manifest) != 0);
+    CHECK(test_write_text(csv, "title\nx\n") == 0);
+    CHECK(id3_manifest_load(csv, &manifest) != 0);
+}
+
+static void test_apply(void)
+{
+    const char *mp3 = test_path("apply.mp3");
+    TestFrame frames[] = { { "TIT2", "Old title", 0 }, { "TPE1", "Artist", 0 } };
+    CHECK(test_write_mp3(mp3, 3, frames, 2, 128, 1000) == 0);
+
+    const char *csv = test_path("apply.csv");
+    char text[1024];
+    snprintf(text, sizeof(text), "path,title,album\n%s,New title,Album\n", mp3);
+    CHECK(test_write_text(csv, text) == 0);
+
+    // Every row's fields are written with one edit; the other fields are kept.
+    Id3Manifest manifest;
+    CHECK(id3_manifest_load(csv, &manifest) == 0);
+    if (manifest.count != 1) return;
+    CHECK(edit_tags_pooled(NULL, manifest.edits[0].path, manifest.edits[0].values,
+                           manifest.edits[0].set_mask) == 0);
+    id3_manifest_free(&manifest);
+
+    TagData *data = read_id3_tags(mp3);
+    CHECK(data && strcmp(tag_get(data, TAG_TITLE), "New title") == 0);
+    CHECK(data && strcmp(tag_get(data, TAG_ALBUM), "Album") == 0);
+    CHECK(data && strcmp(tag_get(data, TAG_ARTIST), "Artist") == 0);
+    free_tag_data(data);
+}
+
+void test_manifest(void)
+{
+    test_load();
+    test_apply();
+}
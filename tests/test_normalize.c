@@ -0,0 +1,102 @@
+/**
+ * @file test_normalize.c
+ * @brief Normalization passes, on ASCII and UTF-8 values and on files.
+ */
+
+#include <string.h>
+#include "test_util.h"
+#include "id3_normalize.h"
+#include "id3_reader.h"
+
+/**
+ * @brief Returns non-zero if normalizing @p in with @p ops gives @p expect.
+ */
+static int normalizes_to(const char *in, unsigned int ops, const char *expect)
+{
+    char out[256];
+    size_t n = id3_normalize_value(in, strlen(in), out, ops);
+    return n == strlen(expect) && memcmp(out, expect, n) == 0;
+}
+
+static void test_parse(void)
+{
+    unsigned int ops;
+    CHECK(id3_normalize_parse("trim,collapse,title", &ops) == 0);
+    CHECK(ops == (ID3_NORM_TRIM | ID3_NORM_COLLAPSE | ID3_NORM_TITLE));
+    CHECK(id3_normalize_parse("all", &ops) == 0);
+    CHECK(ops == (ID3_NORM_STRIP | ID3_NORM_NFC | ID3_NORM_TRIM | ID3_NORM_COLLAPSE));
+    CHECK(id3_normalize_parse("trim,bogus", &ops) == -1);
+    CHECK(id3_normalize_parse("lower,upper", &ops) == -1);
+    CHECK(id3_normalize_parse("", &ops) == -1);
+}
+
+static void test_ascii(void)
+{
+    // Control bytes are removed wherever they fall relative to the vector blocks; tabs stay.
+    char in[80], expect[80];
+    for (size_t pos = 0; pos < 40; pos++)
+    {
+        memset(in, 'a', 40);
+        in[40] = '\0';
+        in[pos] = pos % 3 ? '\x01' : '\x7F';
+        in[39 - pos / 2] = '\t';
+        size_t n = 0;
+        for (size_t i = 0; i < 40; i++)
+        {
+            if (in[i] != '\x01' && in[i] != '\x7F') expect[n++] = in[i];
+        }
+        expect[n] = '\0';
+        CHECK(normalizes_to(in, ID3_NORM_STRIP, expect));
+    }
+    CHECK(normalizes_to("\x01\x02\x03", ID3_NORM_STRIP, ""));
+    CHECK(normalizes_to("Plain title", ID3_NORM_STRIP | ID3_NORM_NFC, "Plain title"));
+
+    CHECK(normalizes_to("  a \t b  ", ID3_NORM_TRIM, "a \t b"));
+    CHECK(normalizes_to("  a \t b  ", ID3_NORM_TRIM | ID3_NORM_COLLAPSE, "a b"));
+    CHECK(normalizes_to("the BEST of", ID3_NORM_TITLE, "The Best Of"));
+    CHECK(normalizes_to("don't stop", ID3_NORM_TITLE, "Don't Stop"));
+    CHECK(normalizes_to("MiXeD", ID3_NORM_LOWER, "mixed"));
+    CHECK(normalizes_to("MiXeD", ID3_NORM_UPPER, "MIXED"));
+}
+
+static void test_utf8(void)
+{
+    // A BOM is stripped and a base letter + combining mark is composed.
+    CHECK(normalizes_to("\xEF\xBB\xBF" "Caf" "e\xCC\x81", ID3_NORM_STRIP | ID3_NORM_NFC, "Caf\xC3\xA9"));
+    CHECK(normalizes_to("e\xCC\x81", ID3_NORM_STRIP, "e\xCC\x81"));
+    CHECK(normalizes_to("\x01" "\xC3\xA9t\xC3\xA9 ", ID3_NORM_STRIP | ID3_NORM_TRIM, "\xC3\xA9t\xC3\xA9"));
+    // Combining marks without a composition are kept.
+    CHECK(normalizes_to("q\xCC\x81", ID3_NORM_NFC, "q\xCC\x81"));
+}
+
+static void test_tags_and_files(void)
+{
+    TagData *data = create_tag_data();
+    tag_set(data, TAG_TITLE, "  spaced  out ");
+    tag_set(data, TAG_ARTIST, "Clean");
+    CHECK(id3_normalize_tag(data, ID3_NORM_TRIM | ID3_NORM_COLLAPSE) == 1u << TAG_TITLE);
+    CHECK(strcmp(tag_get(data, TAG_TITLE), "spaced out") == 0);
+    free_tag_data(data);
+
+    // Only files whose values change are rewritten.
+    TestFrame dirty[] = { { "TIT2", " title ", 0 } }, clean[] = { { "TIT2", "title", 0 } };
+    CHECK(test_write_mp3(test_path("norm_a.mp3"), 3, dirty, 1, 32, 0) == 0);
+    CHECK(test_write_mp3(test_path("norm_b.mp3"), 3, clean, 1, 32, 0) == 0);
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, test_path("norm_a.mp3"));
+    id3_path_list_add(&files, test_path("norm_b.mp3"));
+    size_t modified = 0;
+    CHECK(id3_normalize_files(&files, ID3_NORM_TRIM, 2, &modified) == 0 && modified == 1);
+    id3_path_list_free(&files);
+    data = read_id3_tags(test_path("norm_a.mp3"));
+    CHECK(data && strcmp(tag_get(data, TAG_TITLE), "title") == 0);
+    free_tag_data(data);
+}
+
+void test_normalize(void)
+{
+    test_parse();
+    test_ascii();
+    test_utf8();
+    test_tags_and_files();
+}
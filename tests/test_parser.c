@@ -0,0 +1,138 @@
+/**
+ * @file test_parser.c
+ * @brief Bounded frame parser on well-formed and hostile input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_parser.h"
+#include "id3_reader.h"
+
+/**
+ * @brief Writes a tag header into @p buf; returns its size.
+ */
+static size_t build_tag(unsigned char *buf, int major, unsigned char flags, unsigned int tag_size)
+{
+    memcpy(buf, "ID3", 3);
+    buf[3] = (unsigned char)major;
+    buf[4] = 0;
+    buf[5] = flags;
+    id3_syncsafe_encode(tag_size, &buf[6]);
+    return ID3_HEADER_SIZE;
+}
+
+/**
+ * @brief Writes a v2.3 frame whose declared size may differ from its content; returns the bytes written.
+ */
+static size_t put_frame(unsigned char *p, const char *id, unsigned int size, const char *content, size_t len)
+{
+    memcpy(p, id, 4);
+    p[4] = (unsigned char)(size >> 24);
+    p[5] = (unsigned char)(size >> 16);
+    p[6] = (unsigned char)(size >> 8);
+    p[7] = (unsigned char)size;
+    p[8] = p[9] = 0;
+    memcpy(p + FRAME_HEADER_SIZE, content, len);
+    return FRAME_HEADER_SIZE + len;
+}
+
+static void test_headers(void)
+{
+    unsigned char buf[ID3_HEADER_SIZE];
+    Id3Header hdr;
+
+    CHECK(id3_parse_header((const unsigned char *)"TAG", 3, &hdr) == ID3_PARSE_NO_TAG);
+    build_tag(buf, 2, 0, 100);
+    CHECK(id3_parse_header(buf, sizeof(buf), &hdr) == ID3_PARSE_BAD_HEADER);
+    build_tag(buf, 3, 0, 100);
+    buf[7] |= 0x80;
+    CHECK(id3_parse_header(buf, sizeof(buf), &hdr) == ID3_PARSE_BAD_HEADER);
+    build_tag(buf, 4, 0, 1234);
+    CHECK(id3_parse_header(buf, sizeof(buf), &hdr) == ID3_PARSE_OK);
+    CHECK(hdr.major == 4 && hdr.tag_size == 1234);
+}
+
+static void test_frames(void)
+{
+    unsigned char buf[512];
+    Id3Header hdr;
+    size_t pos = build_tag(buf, 3, 0, 0);
+    pos += put_frame(buf + pos, "TIT2", 5, "Title", 5);
+    pos += put_frame(buf + pos, "APIC", 7, "picture", 7);
+    pos += put_frame(buf + pos, "TPE1", 9, "Artist\0xy", 9);
+    memset(buf + pos, 0, 32); // Padding
+    pos += 32;
+    id3_syncsafe_encode((unsigned int)(pos - ID3_HEADER_SIZE), &buf[6]);
+
+    TagData *data = create_tag_data();
+    CHECK(id3_parse_header(buf, pos, &hdr) == ID3_PARSE_OK);
+    CHECK(id3_parse_frames(&hdr, buf + ID3_HEADER_SIZE, pos - ID3_HEADER_SIZE, data) == ID3_PARSE_OK);
+    CHECK(strcmp(tag_get(data, TAG_TITLE), "Title") == 0);
+    CHECK(strcmp(tag_get(data, TAG_ARTIST), "Artist") == 0); // Up to the first NUL
+    CHECK(tag_get(data, TAG_ALBUM) == NULL);
+    CHECK(data->art_bytes == 7);
+    CHECK(data->frame_offset[TAG_TITLE] == ID3_HEADER_SIZE + FRAME_HEADER_SIZE);
+    CHECK(data->frame_length[TAG_TITLE] == 5);
+    free_tag_data(data);
+}
+
+static void test_hostile_sizes(void)
+{
+    unsigned char buf[128];
+    Id3Header hdr;
+    TagData *data = create_tag_data();
+
+    // A frame claiming more bytes than the tag holds.
+    size_t pos = build_tag(buf, 3, 0, 0);
+    pos += put_frame(buf + pos, "TIT2", 0xFFFFFFF0u, "x", 1);
+    id3_syncsafe_encode((unsigned int)(pos - ID3_HEADER_SIZE), &buf[6]);
+    id3_parse_header(buf, pos, &hdr);
+    CHECK(id3_parse_frames(&hdr, buf + ID3_HEADER_SIZE, pos - ID3_HEADER_SIZE, data) == ID3_PARSE_TRUNCATED);
+
+    // A tag size larger than the buffer: only the bytes present are parsed.
+    clear_tag_data(data);
+    pos = build_tag(buf, 3, 0, 0x0FFFFFFF);
+    pos += put_frame(buf + pos, "TIT2", 40, "short", 5);
+    id3_parse_header(buf, pos, &hdr);
+    CHECK(id3_parse_frames(&hdr, buf + ID3_HEADER_SIZE, pos - ID3_HEADER_SIZE, data) == ID3_PARSE_TRUNCATED);
+
+    // An extended header larger than the tag.
+    clear_tag_data(data);
+    pos = build_tag(buf, 3, 0x40, 20);
+    memcpy(buf + pos, "\x00\x00\x01\x00", 4);
+    memset(buf + pos + 4, 0, 16);
+    id3_parse_header(buf, pos + 20, &hdr);
+    CHECK(id3_parse_frames(&hdr, buf + ID3_HEADER_SIZE, 20, data) == ID3_PARSE_TRUNCATED);
+    free_tag_data(data);
+}
+
+static void test_tag_past_end(void)
+{
+    // A declared tag size beyond the end of the file is rejected before any allocation.
+    const char *path = test_path("past_end.mp3");
+    TestFrame frames[] = { { "TIT2", "Title", 0 } };
+    CHECK(test_write_mp3(path, 3, frames, 1, 0, 0) == 0);
+    size_t len;
+    char *bytes = test_read_file(path, &len);
+    CHECK(bytes != NULL);
+    if (!bytes) return;
+    id3_syncsafe_encode(1 << 20, (unsigned char *)&bytes[6]);
+    FILE *fp = fopen(path, "wb");
+    if (fp)
+    {
+        fwrite(bytes, 1, len, fp);
+        fclose(fp);
+    }
+    free(bytes);
+    CHECK(read_id3_tags(path) == NULL);
+}
+
+void test_parser(void)
+{
+    test_headers();
+    test_frames();
+    test_hostile_sizes();
+    test_tag_past_end();
+}
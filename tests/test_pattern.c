@@ -0,0 +1,97 @@
+/**
+ * @file test_pattern.c
+ * @brief Filename patterns: parsing, matching, formatting and the bulk modes built on them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "test_util.h"
+#include "id3_filename.h"
+#include "id3_pattern.h"
+#include "id3_reader.h"
+
+static void test_compile(void)
+{
+    Id3Pattern p;
+    CHECK(id3_pattern_compile("%artist%/%album%/%track% - %title%.mp3", &p) == 0);
+    CHECK(p.components == 3);
+    CHECK(p.count == 8);
+    CHECK(p.tokens[0].field == TAG_ARTIST && p.tokens[1].field == -1 && p.tokens[1].len == 1);
+    CHECK(p.tokens[6].field == TAG_TITLE);
+    CHECK(p.tokens[7].field == -1 && strcmp(p.tokens[7].text, ".mp3") == 0);
+    id3_pattern_free(&p);
+
+    // Unknown fields, adjacent placeholders and unterminated placeholders are rejected.
+    CHECK(id3_pattern_compile("%colour%.mp3", &p) != 0);
+    CHECK(id3_pattern_compile("%artist%%title%.mp3", &p) != 0);
+    CHECK(id3_pattern_compile("%artist - x.mp3", &p) != 0);
+}
+
+static void test_match_and_format(void)
+{
+    Id3Pattern p;
+    CHECK(id3_pattern_compile("%artist%/%album%/%track% - %title%.mp3", &p) == 0);
+    TagData *values = create_tag_data();
+    unsigned int mask = 0;
+
+    // Only the trailing components take part in the match.
+    CHECK(id3_pattern_match(&p, "/music/Band/Album Name/03 - Song - Live.mp3", values, &mask) == 0);
+    CHECK(mask == ((1u << TAG_ARTIST) | (1u << TAG_ALBUM) | (1u << TAG_TRACK) | (1u << TAG_TITLE)));
+    CHECK(strcmp(tag_get(values, TAG_ARTIST), "Band") == 0);
+    CHECK(strcmp(tag_get(values, TAG_ALBUM), "Album Name") == 0);
+    CHECK(strcmp(tag_get(values, TAG_TRACK), "03") == 0);
+    CHECK(strcmp(tag_get(values, TAG_TITLE), "Song - Live") == 0);
+    CHECK(id3_pattern_match(&p, "Band/Album/Song.mp3", values, &mask) != 0);
+    CHECK(id3_pattern_match(&p, "Album/03 - Song.mp3", values, &mask) != 0);
+
+    // Formatting replaces characters that cannot appear in a component.
+    char out[256];
+    tag_set(values, TAG_ARTIST, "AC/DC");
+    tag_set(values, TAG_ALBUM, "Album Name");
+    CHECK(id3_pattern_format(&p, values, out, sizeof(out)) == 0);
+    CHECK(strcmp(out, "AC_DC/Album Name/03 - Song - Live.mp3") == 0);
+    CHECK(id3_pattern_format(&p, values, out, 10) != 0);
+    tag_set(values, TAG_ALBUM, NULL);
+    CHECK(id3_pattern_format(&p, values, out, sizeof(out)) != 0);
+    free_tag_data(values);
+    id3_pattern_free(&p);
+}
+
+static void test_bulk_modes(void)
+{
+    char dir[512], path[600];
+    snprintf(dir, sizeof(dir), "%s", test_path("library"));
+    mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/Band - Song.mp3", dir);
+    TestFrame frames[] = { { "TALB", "Album", 0 } };
+    CHECK(test_write_mp3(path, 3, frames, 1, 64, 1000) == 0);
+
+    // Tags from the file name.
+    Id3Pattern from;
+    CHECK(id3_pattern_compile("%artist% - %title%.mp3", &from) == 0);
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, path);
+    CHECK(id3_tags_from_filenames(&from, &files, 1) == 0);
+    id3_path_list_free(&files);
+    id3_pattern_free(&from);
+    TagData *data = read_id3_tags(path);
+    CHECK(data && strcmp(tag_get(data, TAG_ARTIST), "Band") == 0 && strcmp(tag_get(data, TAG_TITLE), "Song") == 0);
+    free_tag_data(data);
+
+    // File name from the tags, into a new subdirectory of the given directory.
+    Id3Pattern to;
+    CHECK(id3_pattern_compile("%artist%/%album%/%title%.mp3", &to) == 0);
+    char *inputs[] = { dir };
+    CHECK(id3_rename_from_tags(&to, inputs, 1, 1) == 0);
+    snprintf(path, sizeof(path), "%s/Band/Album/Song.mp3", dir);
+    CHECK(test_file_size(path) > 0);
+    id3_pattern_free(&to);
+}
+
+void test_pattern(void)
+{
+    test_compile();
+    test_match_and_format();
+    test_bulk_modes();
+}
@@ -0,0 +1,90 @@
+/**
+ * @file test_playlist.c
+ * @brief Playlist queries, and playlists built from files and from an index.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_index.h"
+#include "id3_playlist.h"
+
+/**
+ * @brief Returns non-zero if @p text compiles and matches @p data as expected.
+ */
+static int query_gives(const char *text, const TagData *data, int expect)
+{
+    Id3Query query;
+    if (id3_query_compile(text, &query) != 0) return 0;
+    int match = id3_query_match(&query, data) != 0;
+    id3_query_free(&query);
+    return match == expect;
+}
+
+static void test_queries(void)
+{
+    TagData *data = create_tag_data();
+    tag_set(data, TAG_GENRE, "Rock");
+    tag_set(data, TAG_YEAR, "1994");
+    tag_set(data, TAG_ARTIST, "The Band");
+    data->duration = 240;
+
+    CHECK(query_gives("", data, 1));
+    CHECK(query_gives("genre = rock", data, 1));
+    CHECK(query_gives("genre != Rock", data, 0));
+    CHECK(query_gives("year >= 1990 and year < 2000", data, 1));
+    CHECK(query_gives("year > 1994", data, 0));
+    CHECK(query_gives("artist ~ \"the b\" && duration <= 240", data, 1));
+    CHECK(query_gives("album = \"\"", data, 1));
+    CHECK(query_gives("duration > 300", data, 0));
+
+    Id3Query query;
+    CHECK(id3_query_compile("colour = red", &query) == -1);
+    CHECK(id3_query_compile("genre Rock", &query) == -1);
+    CHECK(id3_query_compile("genre = \"unterminated", &query) == -1);
+    free_tag_data(data);
+}
+
+static void test_playlists(void)
+{
+    TestFrame rock[] = { { "TCON", "Rock", 0 }, { "TIT2", "Loud", 0 }, { "TPE1", "Band", 0 } };
+    TestFrame jazz[] = { { "TCON", "Jazz", 0 }, { "TIT2", "Soft", 0 } };
+    CHECK(test_write_mp3(test_path("pl_a.mp3"), 3, rock, 3, 0, 4170) == 0);
+    CHECK(test_write_mp3(test_path("pl_b.mp3"), 3, jazz, 2, 0, 4170) == 0);
+    CHECK(test_write_mp3(test_path("pl_c.mp3"), 4, rock, 3, 0, 4170) == 0);
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, test_path("pl_a.mp3"));
+    id3_path_list_add(&files, test_path("pl_b.mp3"));
+    id3_path_list_add(&files, test_path("pl_c.mp3"));
+    Id3Query query;
+    CHECK(id3_query_compile("genre = Rock", &query) == 0);
+
+    // From the files.
+    size_t entries = 0;
+    CHECK(id3_playlist_build(test_path("files.m3u"), &query, &files, NULL, 2, &entries) == 0);
+    CHECK(entries == 2);
+    CHECK(test_count(test_path("files.m3u"), "#EXTM3U\n") == 1);
+    CHECK(test_count(test_path("files.m3u"), "#EXTINF:") == 2);
+    CHECK(test_count(test_path("files.m3u"), "Band - Loud") == 2);
+    CHECK(test_count(test_path("files.m3u"), "pl_b.mp3") == 0);
+
+    // From an index, with the same result.
+    CHECK(id3_index_build(test_path("pl.idx"), &files, 1) == 0);
+    CHECK(id3_playlist_build(test_path("index.m3u"), &query, NULL, test_path("pl.idx"), 1, &entries) == 0);
+    CHECK(entries == 2);
+    char *from_files = test_read_file(test_path("files.m3u"), NULL);
+    char *from_index = test_read_file(test_path("index.m3u"), NULL);
+    CHECK(from_files && from_index && strcmp(from_files, from_index) == 0);
+    free(from_files);
+    free(from_index);
+
+    CHECK(id3_playlist_build(test_path("missing/x.m3u"), &query, &files, NULL, 1, &entries) == -1);
+    id3_query_free(&query);
+    id3_path_list_free(&files);
+}
+
+void test_playlist(void)
+{
+    test_queries();
+    test_playlists();
+}
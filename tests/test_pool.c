@@ -0,0 +1,83 @@
+/**
+ * @file test_pool.c
+ * @brief Per-worker buffer and TagData pools.
+ */
+
+#include <string.h>
+#include "test_util.h"
+#include "id3_pool.h"
+#include "id3_reader.h"
+
+static void test_tag_recycling(void)
+{
+    Id3Pool *pool = id3_pool_create();
+    CHECK(pool != NULL);
+    if (!pool) return;
+
+    // A released TagData comes back cleared, with its arena kept.
+    TagData *data = id3_pool_acquire_tag(pool);
+    char long_value[100];
+    memset(long_value, 'x', sizeof(long_value) - 1);
+    long_value[sizeof(long_value) - 1] = '\0';
+    CHECK(tag_set(data, TAG_COMMENT, long_value) == 0);
+    char *arena = data->arena;
+    id3_pool_release_tag(pool, data);
+    TagData *again = id3_pool_acquire_tag(pool);
+    CHECK(again == data);
+    CHECK(again->arena == arena && again->arena_len == 0);
+    CHECK(tag_get(again, TAG_COMMENT) == NULL && again->dirty == 0);
+
+    // Only a bounded number of objects is kept.
+    TagData *many[ID3_POOL_MAX_FREE_TAGS + 4];
+    many[0] = again;
+    for (int i = 1; i < ID3_POOL_MAX_FREE_TAGS + 4; i++) many[i] = id3_pool_acquire_tag(pool);
+    for (int i = 0; i < ID3_POOL_MAX_FREE_TAGS + 4; i++) id3_pool_release_tag(pool, many[i]);
+    CHECK(pool->free_count == ID3_POOL_MAX_FREE_TAGS);
+    id3_pool_destroy(pool);
+}
+
+static void test_buffers(void)
+{
+    Id3Pool *pool = id3_pool_create();
+    if (!pool) return;
+
+    // Buffers are reused while they are large enough.
+    unsigned char *small = id3_pool_io_buffer(pool, 100);
+    CHECK(small != NULL && id3_pool_io_buffer(pool, 200) == small);
+
+    // One huge request is given back after a window of small ones.
+    CHECK(id3_pool_io_buffer(pool, 1 << 20) != NULL);
+    CHECK(pool->io_cap >= (1 << 20));
+    for (int i = 0; i < 1000; i++) id3_pool_io_buffer(pool, 100);
+    CHECK(pool->io_cap < (1 << 20));
+    id3_pool_destroy(pool);
+}
+
+static void test_pooled_reads(void)
+{
+    const char *path = test_path("pool.mp3");
+    TestFrame frames[] = { { "TIT2", "Title", 0 }, { "TPE1", "Artist", 0 } };
+    CHECK(test_write_mp3(path, 3, frames, 2, 64, 0) == 0);
+
+    // Reading many files through a pool keeps reusing the same objects.
+    Id3Pool *pool = id3_pool_create();
+    if (!pool) return;
+    TagData *first = read_id3_tags_pooled(pool, path);
+    CHECK(first && strcmp(tag_get(first, TAG_ARTIST), "Artist") == 0);
+    id3_pool_release_tag(pool, first);
+    for (int i = 0; i < 10; i++)
+    {
+        TagData *data = read_id3_tags_pooled(pool, path);
+        CHECK(data == first);
+        CHECK(data && strcmp(tag_get(data, TAG_TITLE), "Title") == 0);
+        id3_pool_release_tag(pool, data);
+    }
+    id3_pool_destroy(pool);
+}
+
+void test_pool(void)
+{
+    test_tag_recycling();
+    test_buffers();
+    test_pooled_reads();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file test_queue.c
+ * @brief Work queues: chunk claims by several workers and takeover of expired leases.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_queue.h"
+
+#define QUEUE_ITEMS 50 /**< Items of each test job */
+
+static int item_log = -1; /**< Log every processed item is appended to */
+
+/**
+ * @brief Appends the item's index to the log, with one write so that workers do not interleave.
+ */
+static int log_item(Id3Pool *pool, size_t index, void *ctx)
+{
+    (void)pool;
+    (void)ctx;
+    char line[32];
+    int len = snprintf(line, sizeof(line), "[%zu]\n", index);
+    return write(item_log, line, (size_t)len) == len ? 0 : -1;
+}
+
+/**
+ * @brief Returns non-zero if the log lists every item exactly once.
+ */
+static int each_item_once(const char *log)
+{
+    int ok = 1;
+    char needle[32];
+    for (int i = 0; i < QUEUE_ITEMS; i++)
+    {
+        snprintf(needle, sizeof(needle), "[%d]\n", i);
+        if (test_count(log, needle) != 1) ok = 0;
+    }
+    return ok;
+}
+
+static void test_two_workers(void)
+{
+    const char *dir = test_path("queue2");
+    const char *log = test_path("queue2.log");
+    item_log = open(log, O_WRONLY | O_CREAT | O_APPEND | O_TRUNC, 0644);
+    if (item_log < 0) return;
+
+    // A second process works on the same queue at the same time.
+    Id3Queue queue;
+    CHECK(id3_queue_open(&queue, dir, QUEUE_ITEMS, 3, 4) == 0);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        size_t n;
+        _exit(id3_queue_run(&queue, 2, log_item, NULL, &n) == 0 ? 0 : 1);
+    }
+    size_t mine = 0;
+    CHECK(id3_queue_run(&queue, 2, log_item, NULL, &mine) == 0);
+    int status = -1;
+    waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(queue.nchunks == (QUEUE_ITEMS + 2) / 3);
+    CHECK(each_item_once(log));
+
+    // Every chunk is done, so a late worker finds nothing to do.
+    CHECK(id3_queue_run(&queue, 1, log_item, NULL, &mine) == 0 && mine == 0);
+    id3_queue_close(&queue);
+    close(item_log);
+
+    // Workers must agree on the job.
+    CHECK(id3_queue_open(&queue, dir, QUEUE_ITEMS + 1, 3, 4) == -1);
+}
+
+static void test_lease_expiry(void)
+{
+    const char *dir = test_path("queue_lease");
+    const char *log = test_path("queue_lease.log");
+    item_log = open(log, O_WRONLY | O_CREAT | O_APPEND | O_TRUNC, 0644);
+    if (item_log < 0) return;
+    Id3Queue queue;
+    CHECK(id3_queue_open(&queue, dir, QUEUE_ITEMS, 10, 2) == 0);
+
+    // Chunk 0 was claimed by a worker that died long ago; chunk 1 has just been claimed.
+    char path[600];
+    snprintf(path, sizeof(path), "%s/0.lease.0", dir);
+    CHECK(test_write_text(path, "gone 1\n") == 0);
+    const struct timespec old[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    CHECK(utimensat(AT_FDCWD, path, old, 0) == 0);
+    snprintf(path, sizeof(path), "%s/1.lease.0", dir);
+    CHECK(test_write_text(path, "busy 2\n") == 0);
+
+    // The stale lease is taken over at once, the fresh one once it expires; each by a new generation.
+    size_t mine = 0;
+    CHECK(id3_queue_run(&queue, 1, log_item, NULL, &mine) == 0);
+    CHECK(mine == queue.nchunks);
+    CHECK(each_item_once(log));
+    snprintf(path, sizeof(path), "%s/0.lease.1", dir);
+    CHECK(access(path, F_OK) == 0);
+    snprintf(path, sizeof(path), "%s/1.lease.1", dir);
+    CHECK(access(path, F_OK) == 0);
+    snprintf(path, sizeof(path), "%s/2.lease.1", dir);
+    CHECK(access(path, F_OK) != 0);
+    id3_queue_close(&queue);
+    close(item_log);
+}
+
+void test_queue(void)
+{
+    test_two_workers();
+    test_lease_expiry();
+}
@@ -0,0 +1,99 @@
+/**
+ * @file test_retry.c
+ * @brief Retries of transient I/O errors, their budget, and writes failing with EIO.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "test_util.h"
+#include "id3_io.h"
+
+static int fail_reads;  /**< Number of following reads that fail with EIO */
+static int fail_writes; /**< Number of following writes that fail with EIO */
+
+/*
+ * The I/O layer calls pread64() and pwrite64(); these definitions take the place
+ * of the C library's in the test program, so errors can be injected.
+ */
+ssize_t pread64(int fd, void *buf, size_t len, off_t offset)
+{
+    if (fail_reads > 0)
+    {
+        fail_reads--;
+        errno = EIO;
+        return -1;
+    }
+    return syscall(SYS_pread64, fd, buf, len, offset);
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t len, off_t offset)
+{
+    if (fail_writes > 0)
+    {
+        fail_writes--;
+        errno = EIO;
+        return -1;
+    }
+    return syscall(SYS_pwrite64, fd, buf, len, offset);
+}
+
+static void test_policy(void)
+{
+    CHECK(id3_io_transient(EIO) && id3_io_transient(ESTALE) && id3_io_transient(EAGAIN));
+    CHECK(!id3_io_transient(ENOENT) && !id3_io_transient(EACCES));
+
+    // Retries come out of the run's budget, except after EINTR; permanent errors are never retried.
+    id3_io_set_retry_budget(2);
+    long used = id3_io_retries_used();
+    CHECK(id3_io_retry(EAGAIN, 0) == 1 && errno == EAGAIN);
+    CHECK(id3_io_retry(EIO, 1) == 1);
+    CHECK(id3_io_retry(EIO, 0) == 0);
+    CHECK(id3_io_retry(EINTR, 0) == 1);
+    CHECK(id3_io_retries_used() == used + 2);
+    id3_io_set_retry_budget(100);
+    CHECK(id3_io_retry(ENOENT, 0) == 0);
+    CHECK(id3_io_retry(EIO, 100) == 0);
+}
+
+static void test_injected_errors(void)
+{
+    const char *path = test_path("retry.bin");
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+    CHECK(id3_pwrite_full(fd, "0123456789", 10, 0) == 0);
+
+    // A read that fails with EIO a couple of times succeeds once the error goes away.
+    char buf[10];
+    id3_io_set_retry_budget(100);
+    long used = id3_io_retries_used();
+    fail_reads = 2;
+    CHECK(id3_pread_full(fd, buf, sizeof(buf), 0) == 0 && memcmp(buf, "0123456789", 10) == 0);
+    CHECK(id3_io_retries_used() == used + 2);
+
+    // A write that fails with EIO is not repeated: the error is reported at once.
+    fail_writes = 1;
+    errno = 0;
+    CHECK(id3_pwrite_full(fd, "abcdefghij", 10, 0) == -1 && errno == EIO);
+    CHECK(fail_writes == 0 && id3_io_retries_used() == used + 2);
+    fail_writes = 0;
+
+    // With no budget left, a read error is final too.
+    id3_io_set_retry_budget(0);
+    fail_reads = 1;
+    CHECK(id3_pread_full(fd, buf, sizeof(buf), 0) == -1 && errno == EIO);
+    fail_reads = 0;
+    id3_io_set_retry_budget(ID3_IO_DEFAULT_RETRY_BUDGET);
+    close(fd);
+}
+
+void test_retry(void)
+{
+    test_policy();
+    test_injected_errors();
+}
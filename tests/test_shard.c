@@ -0,0 +1,185 @@
+/**
+ * @file test_shard.c
+ * @brief Library shards and checkpoint logs.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_checkpoint.h"
+#include "id3_filename.h"
+#include "id3_scan.h"
+
+#define SHARD_FILES 20 /**< Files of the sharded library */
+#define SHARDS      3  /**< Shards it is split into */
+
+/**
+ * @brief Scans @p root as shard @p index and marks each file found, by name, in @p seen.
+ */
+static void scan_shard(const char *root, int index, int seen[SHARD_FILES])
+{
+    char spec[16];
+    snprintf(spec, sizeof(spec), "%d/%d", index, SHARDS);
+    CHECK(id3_scan_set_shard(spec) == 0);
+    Id3PathList list = { 0 };
+    char *inputs[] = { (char *)root };
+    CHECK(id3_scan_paths(inputs, 1, &list) == 0);
+    for (size_t i = 0; i < list.count; i++)
+    {
+        int n;
+        const char *name = strrchr(list.paths[i], '/');
+        if (name && sscanf(name, "/s%d.mp3", &n) == 1 && n >= 0 && n < SHARD_FILES) seen[n]++;
+    }
+    id3_path_list_free(&list);
+    CHECK(id3_scan_set_shard("0/1") == 0);
+}
+
+static void test_shards(void)
+{
+    char root[512], alias[512], path[600];
+    snprintf(root, sizeof(root), "%s", test_path("shard_library"));
+    snprintf(alias, sizeof(alias), "%s", test_path("shard_mount"));
+    CHECK(mkdir(root, 0755) == 0);
+    snprintf(path, sizeof(path), "%s/sub", root);
+    CHECK(mkdir(path, 0755) == 0);
+    CHECK(symlink(root, alias) == 0);
+    TestFrame frames[] = { { "TIT2", "Title", 0 } };
+    for (int i = 0; i < SHARD_FILES; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%ss%d.mp3", root, i % 2 ? "sub/" : "", i);
+        CHECK(test_write_mp3(path, 3, frames, 1, 0, 0) == 0);
+    }
+
+    // The shards are disjoint and cover every file.
+    int seen[SHARD_FILES] = { 0 };
+    for (int s = 0; s < SHARDS; s++) scan_shard(root, s, seen);
+    for (int i = 0; i < SHARD_FILES; i++) CHECK(seen[i] == 1);
+
+    // A host naming the library differently (another mount point, a trailing slash) gets the same shards.
+    char alias_slash[600];
+    snprintf(alias_slash, sizeof(alias_slash), "%s/", alias);
+    for (int s = 0; s < SHARDS; s++)
+    {
+        int here[SHARD_FILES] = { 0 }, there[SHARD_FILES] = { 0 };
+        scan_shard(root, s, here);
+        scan_shard(alias_slash, s, there);
+        CHECK(memcmp(here, there, sizeof(here)) == 0);
+    }
+
+    CHECK(id3_scan_set_shard("3/3") == -1);
+    CHECK(id3_scan_set_shard("1/2x") == -1);
+}
+
+static void test_checkpoints(void)
+{
+    const char *log1 = test_path("done.1");
+    char saved[512];
+    snprintf(saved, sizeof(saved), "%s", log1);
+
+    // Completed files are skipped by the next run.
+    CHECK(id3_checkpoint_open(saved) == 0);
+    id3_checkpoint_record("/music/a.mp3");
+    id3_checkpoint_record("/music/b.mp3");
+    id3_checkpoint_close();
+    CHECK(id3_checkpoint_open(saved) == 0);
+    CHECK(id3_checkpoint_contains("/music/a.mp3") && id3_checkpoint_contains("/music/b.mp3"));
+    CHECK(!id3_checkpoint_contains("/music/c.mp3"));
+    CHECK(!id3_path_selected("/music/a.mp3") && id3_path_selected("/music/c.mp3"));
+    id3_checkpoint_close();
+    CHECK(!id3_checkpoint_contains("/music/a.mp3"));
+
+    // Logs merge into one sorted log without duplicates.
+    char log2[512], merged[512];
+    snprintf(log2, sizeof(log2), "%s", test_path("done.2"));
+    snprintf(merged, sizeof(merged), "%s", test_path("done.all"));
+    CHECK(test_write_text(log2, "/music/c.mp3\n/music/a.mp3\n") == 0);
+    char *inputs[] = { saved, log2 };
+    CHECK(id3_checkpoint_merge(merged, inputs, 2) == 3);
+    char *text = test_read_file(merged, NULL);
+    CHECK(text && strcmp(text, "/music/a.mp3\n/music/b.mp3\n/music/c.mp3\n") == 0);
+    free(text);
+}
+
+/**
+ * @brief Returns non-zero if file @p i of the rename test has been renamed.
+ */
+static int renamed(const char *dir, int i)
+{
+    char path[600];
+    snprintf(path, sizeof(path), "%s/T%d.mp3", dir, i);
+    return test_file_size(path) > 0;
+}
+
+static void test_rename_inputs(void)
+{
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", test_path("shard_rename"));
+    CHECK(mkdir(dir, 0755) == 0);
+    static char names[SHARD_FILES][600];
+    char *inputs[SHARD_FILES];
+    for (int i = 0; i < SHARD_FILES; i++)
+    {
+        char title[16];
+        snprintf(title, sizeof(title), "T%d", i);
+        TestFrame frames[] = { { "TIT2", title, 0 } };
+        snprintf(names[i], sizeof(names[i]), "%s/r%d.mp3", dir, i);
+        CHECK(test_write_mp3(names[i], 3, frames, 1, 0, 0) == 0);
+        inputs[i] = names[i];
+    }
+    Id3Pattern pattern;
+    CHECK(id3_pattern_compile("%title%.mp3", &pattern) == 0);
+
+    // Files named directly are split between shards like scanned ones: each is renamed once.
+    for (int s = 0; s < SHARDS; s++)
+    {
+        char spec[16];
+        snprintf(spec, sizeof(spec), "%d/%d", s, SHARDS);
+        CHECK(id3_scan_set_shard(spec) == 0);
+        int before[SHARD_FILES];
+        for (int i = 0; i < SHARD_FILES; i++) before[i] = renamed(dir, i);
+        CHECK(id3_rename_from_tags(&pattern, inputs, SHARD_FILES, 2) == 0);
+        for (int i = 0; i < SHARD_FILES; i++)
+        {
+            CHECK(renamed(dir, i) == (before[i] || id3_path_selected(inputs[i])));
+        }
+    }
+    CHECK(id3_scan_set_shard("0/1") == 0);
+    for (int i = 0; i < SHARD_FILES; i++) CHECK(renamed(dir, i));
+
+    // Renames are logged under both names, so a rerun skips the files instead of failing on them.
+    char log[512];
+    snprintf(log, sizeof(log), "%s", test_path("rename.done"));
+    for (int i = 0; i < SHARD_FILES; i++)
+    {
+        char title[16];
+        snprintf(title, sizeof(title), "T%d", i);
+        TestFrame frames[] = { { "TIT2", title, 0 } };
+        snprintf(names[i], sizeof(names[i]), "%s/again%d.mp3", dir, i);
+        CHECK(test_write_mp3(names[i], 3, frames, 1, 0, 0) == 0);
+    }
+    Id3Pattern sub;
+    CHECK(id3_pattern_compile("sub/%title%.mp3", &sub) == 0);
+    CHECK(id3_checkpoint_open(log) == 0);
+    CHECK(id3_rename_from_tags(&sub, inputs, SHARD_FILES, 2) == 0);
+    id3_checkpoint_close();
+    CHECK(id3_checkpoint_open(log) == 0);
+    char path[600];
+    snprintf(path, sizeof(path), "%s/sub/T3.mp3", dir);
+    CHECK(id3_checkpoint_contains(names[3]) && id3_checkpoint_contains(path));
+    CHECK(id3_rename_from_tags(&sub, inputs, SHARD_FILES, 2) == 0);
+    id3_checkpoint_close();
+    id3_pattern_free(&sub);
+    id3_pattern_free(&pattern);
+}
+
+void test_shard(void)
+{
+    test_shards();
+    test_checkpoints();
+    test_rename_inputs();
+}
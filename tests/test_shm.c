@@ -0,0 +1,139 @@
+/**
+ * @file test_shm.c
+ * @brief Shared-memory library segments: publishing, lookups, refreshes and damaged segments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "id3_index.h"
+#include "id3_shm.h"
+
+static char segment[64];  /**< Name of the test's segment */
+
+/**
+ * @brief Builds an index of @p count fixture files, titled by @p prefix.
+ */
+static void build_index(const char *index, int count, const char *prefix)
+{
+    Id3PathList files = { 0 };
+    char name[32], title[64];
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "shm_%02d.mp3", i);
+        snprintf(title, sizeof(title), "%s %d", prefix, i);
+        TestFrame frames[] = { { "TIT2", title, 0 }, { "TCON", i % 2 ? "Rock" : "Jazz", 0 } };
+        CHECK(test_write_mp3(test_path(name), 3, frames, 2, 0, 0) == 0);
+        id3_path_list_add(&files, test_path(name));
+    }
+    CHECK(id3_index_build(index, &files, 1) == 0);
+    id3_path_list_free(&files);
+}
+
+/**
+ * @brief Writes a copy of the test's segment under @p name with one byte changed.
+ */
+static void publish_damaged(const char *name, size_t at, unsigned char value)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", ID3_SHM_DIR, segment);
+    size_t len;
+    unsigned char *bytes = (unsigned char *)test_read_file(path, &len);
+    if (!bytes) return;
+    if (at == (size_t)-1) at = len - 1;
+    bytes[at] = value;
+    snprintf(path, sizeof(path), "%s/%s", ID3_SHM_DIR, name);
+    FILE *fp = fopen(path, "wb");
+    if (fp)
+    {
+        fwrite(bytes, 1, len, fp);
+        fclose(fp);
+    }
+    free(bytes);
+}
+
+static void test_publish_and_find(void)
+{
+    char index[512];
+    snprintf(index, sizeof(index), "%s", test_path("shm.idx"));
+    build_index(index, 10, "Title");
+    uint64_t epoch = 0;
+    CHECK(id3_shm_publish(segment, index, &epoch) == 10 && epoch >= 1);
+
+    Id3ShmView view;
+    CHECK(id3_shm_open(&view, segment) == 0);
+    if (!view.base) return;
+    for (int i = 0; i < 10; i++)
+    {
+        char name[32], title[64];
+        snprintf(name, sizeof(name), "shm_%02d.mp3", i);
+        snprintf(title, sizeof(title), "Title %d", i);
+        const Id3ShmRecord *r = id3_shm_find(&view, test_path(name));
+        CHECK(r && strcmp(id3_shm_string(&view, r->fields[TAG_TITLE]), title) == 0);
+        CHECK(r && id3_shm_string(&view, r->fields[TAG_ALBUM]) == NULL);
+    }
+    CHECK(id3_shm_find(&view, test_path("absent.mp3")) == NULL);
+
+    // Equal values are stored once.
+    const Id3ShmRecord *a = id3_shm_find(&view, test_path("shm_01.mp3"));
+    const Id3ShmRecord *b = id3_shm_find(&view, test_path("shm_03.mp3"));
+    CHECK(a && b && a->fields[TAG_GENRE] == b->fields[TAG_GENRE]);
+
+    // A new publish is picked up by a refresh, once.
+    CHECK(id3_shm_refresh(&view, segment) == 0);
+    build_index(index, 12, "New");
+    CHECK(id3_shm_publish(segment, index, NULL) == 12);
+    CHECK(id3_shm_refresh(&view, segment) == 1);
+    CHECK(view.header->epoch == epoch + 1 && view.header->count == 12);
+    const Id3ShmRecord *r = id3_shm_find(&view, test_path("shm_11.mp3"));
+    CHECK(r && strcmp(id3_shm_string(&view, r->fields[TAG_TITLE]), "New 11") == 0);
+    CHECK(id3_shm_refresh(&view, segment) == 0);
+    CHECK(id3_shm_string(&view, view.size + 5) == NULL);
+    id3_shm_close(&view);
+
+    // An empty index publishes an empty segment.
+    CHECK(test_write_text(index, "path\ttitle\n") == 0);
+    char empty[80];
+    snprintf(empty, sizeof(empty), "%s.empty", segment);
+    CHECK(id3_shm_publish(empty, index, NULL) == 0);
+    CHECK(id3_shm_open(&view, empty) == 0 && id3_shm_find(&view, "x") == NULL);
+    id3_shm_close(&view);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", ID3_SHM_DIR, empty);
+    unlink(path);
+}
+
+static void test_damaged(void)
+{
+    char damaged[80], path[128];
+    snprintf(damaged, sizeof(damaged), "%s.bad", segment);
+    snprintf(path, sizeof(path), "%s/%s", ID3_SHM_DIR, damaged);
+    Id3ShmView view;
+
+    // A string area that does not end with a NUL is refused.
+    publish_damaged(damaged, (size_t)-1, 'x');
+    CHECK(id3_shm_open(&view, damaged) == -1);
+
+    // A record whose path offset is out of range is not followed.
+    CHECK(id3_shm_open(&view, segment) == 0);
+    // Top byte of the path offset of the middle record, the first one a lookup compares.
+    size_t path_at = view.header->records + view.header->count / 2 * sizeof(Id3ShmRecord) + 7;
+    id3_shm_close(&view);
+    publish_damaged(damaged, path_at, 0x40);
+    CHECK(id3_shm_open(&view, damaged) == 0);
+    CHECK(id3_shm_find(&view, test_path("shm_05.mp3")) == NULL);
+    id3_shm_close(&view);
+    unlink(path);
+}
+
+void test_shm(void)
+{
+    snprintf(segment, sizeof(segment), "id3_test_%ld", (long)getpid());
+    test_publish_and_find();
+    test_damaged();
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", ID3_SHM_DIR, segment);
+    unlink(path);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file test_stats.c
+ * @brief Library statistics from files, indexes and saved statistics.
+ */
+
+#include <string.h>
+#include "test_util.h"
+#include "id3_index.h"
+#include "id3_stats.h"
+
+/**
+ * @brief Returns the count of @p value in @p group, or 0 if it was never seen.
+ */
+static size_t group_count(const Id3Stats *stats, Id3StatsGroup group, const char *value)
+{
+    unsigned int id = id3_intern_find(stats->names[group], value, strlen(value));
+    return id == ID3_INTERN_NONE || id >= stats->total.caps[group] ? 0 : stats->total.counts[group][id];
+}
+
+/**
+ * @brief Checks the counts of the three fixture files, @p times over.
+ */
+static void check_counts(const Id3Stats *stats, size_t times)
+{
+    CHECK(stats->total.files == 3 * times);
+    CHECK(stats->total.missing[TAG_YEAR] == 1 * times);
+    CHECK(stats->total.missing[TAG_ALBUM] == 3 * times);
+    CHECK(stats->total.art_bytes == 100 * times);
+    CHECK(group_count(stats, ID3_STATS_GENRE, "Rock") == 2 * times);
+    CHECK(group_count(stats, ID3_STATS_GENRE, "Jazz") == 1 * times);
+    CHECK(group_count(stats, ID3_STATS_YEAR, "1999") == 2 * times);
+}
+
+void test_stats(void)
+{
+    char picture[100] = "";
+    TestFrame a[] = { { "TCON", "Rock", 0 }, { "TYER", "1999", 0 }, { "APIC", picture, sizeof(picture) } };
+    TestFrame b[] = { { "TCON", "Rock", 0 }, { "TYER", "1999", 0 } };
+    TestFrame c[] = { { "TCON", "Jazz", 0 } };
+    CHECK(test_write_mp3(test_path("stats_a.mp3"), 3, a, 3, 0, 0) == 0);
+    CHECK(test_write_mp3(test_path("stats_b.mp3"), 4, b, 2, 16, 0) == 0);
+    CHECK(test_write_mp3(test_path("stats_c.mp3"), 3, c, 1, 0, 0) == 0);
+    Id3PathList files = { 0 };
+    id3_path_list_add(&files, test_path("stats_a.mp3"));
+    id3_path_list_add(&files, test_path("stats_b.mp3"));
+    id3_path_list_add(&files, test_path("stats_c.mp3"));
+
+    // Scanning the files in parallel.
+    Id3Stats scanned;
+    CHECK(id3_stats_init(&scanned, 0) == 0);
+    CHECK(id3_stats_scan(&scanned, &files, 3) == 0);
+    check_counts(&scanned, 1);
+    CHECK(group_count(&scanned, ID3_STATS_VERSION, "ID3v2.4.0") == 1);
+
+    // The same counts from an index.
+    Id3Stats indexed;
+    CHECK(id3_index_build(test_path("stats.idx"), &files, 1) == 0);
+    CHECK(id3_stats_init(&indexed, 0) == 0);
+    CHECK(id3_stats_index(&indexed, test_path("stats.idx")) == 0);
+    check_counts(&indexed, 1);
+    id3_stats_free(&indexed);
+
+    // Saved statistics load back, and loading adds to what is there.
+    Id3Stats loaded;
+    CHECK(id3_stats_save(&scanned, test_path("stats.tsv")) == 0);
+    CHECK(id3_stats_init(&loaded, 0) == 0);
+    CHECK(id3_stats_load(&loaded, test_path("stats.tsv")) == 0);
+    check_counts(&loaded, 1);
+    CHECK(id3_stats_load(&loaded, test_path("stats.tsv")) == 0);
+    check_counts(&loaded, 2);
+    id3_stats_free(&loaded);
+
+    // Saving to a directory that does not exist fails.
+    CHECK(id3_stats_save(&scanned, test_path("missing/stats.tsv")) == -1);
+    id3_stats_free(&scanned);
+    id3_path_list_free(&files);
+}
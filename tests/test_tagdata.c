@@ -0,0 +1,108 @@
+/**
+ * @file test_tagdata.c
+ * @brief Inline and arena storage of TagData values.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "id3_utils.h"
+
+/**
+ * @brief Fills @p buf with @p len copies of @p c and a NUL.
+ */
+static const char *repeat(char *buf, char c, size_t len)
+{
+    memset(buf, c, len);
+    buf[len] = '\0';
+    return buf;
+}
+
+static void test_inline_and_spilled(void)
+{
+    TagData *data = create_tag_data();
+    char buf[256];
+
+    CHECK(tag_set(data, TAG_TITLE, repeat(buf, 'a', TAG_INLINE_MAX)) == 0);
+    CHECK(data->fields[TAG_TITLE].len == TAG_INLINE_MAX && data->arena_len == 0);
+    CHECK(tag_set(data, TAG_ALBUM, repeat(buf, 'b', TAG_INLINE_MAX + 1)) == 0);
+    CHECK(data->fields[TAG_ALBUM].len == TAG_VALUE_SPILLED);
+    CHECK(strcmp(tag_get(data, TAG_ALBUM), buf) == 0 && tag_length(data, TAG_ALBUM) == TAG_INLINE_MAX + 1);
+
+    // Setting an equal value does not make the field dirty.
+    tag_mark_clean(data);
+    CHECK(tag_set(data, TAG_ALBUM, buf) == 0 && data->dirty == 0);
+    CHECK(tag_set(data, TAG_ALBUM, NULL) == 0 && data->dirty == 1u << TAG_ALBUM);
+    CHECK(tag_get(data, TAG_ALBUM) == NULL);
+
+    // Copies keep spilled values.
+    CHECK(tag_set(data, TAG_COMMENT, repeat(buf, 'c', 200)) == 0);
+    TagData *copy = create_tag_data();
+    CHECK(copy_tag_data(copy, data) == 0);
+    CHECK(strcmp(tag_get(copy, TAG_COMMENT), buf) == 0);
+    CHECK(tag_diff_mask(copy, data) == 0);
+    free_tag_data(copy);
+    free_tag_data(data);
+}
+
+static void test_self_reference(void)
+{
+    TagData *data = create_tag_data();
+    char *buf = (char *)malloc(1 << 16);
+    if (!buf) return;
+
+    // Values taken from the same TagData stay valid while the arena moves.
+    CHECK(tag_set(data, TAG_COMMENT, repeat(buf, 'c', 200)) == 0);
+    for (int i = 0; i < 8; i++)
+    {
+        TagField from = i % 2 ? TAG_ALBUM : TAG_COMMENT;
+        TagField to = i % 2 ? TAG_COMMENT : TAG_ALBUM;
+        // Fill the arena so that copying the value has to grow it while the source points into it.
+        size_t room = data->arena_cap - data->arena_len;
+        if (room > 201)
+        {
+            tag_set(data, TAG_TITLE, NULL);
+            CHECK(tag_set(data, TAG_TITLE, repeat(buf, 't', room - 100)) == 0);
+        }
+        size_t cap = data->arena_cap;
+        tag_set(data, to, NULL);
+        CHECK(tag_set(data, to, tag_get(data, from)) == 0);
+        CHECK(data->arena_cap > cap);
+        CHECK(tag_length(data, to) == 200 && strspn(tag_get(data, to), "c") == 200);
+    }
+
+    // Part of a value can replace the value itself.
+    CHECK(tag_set(data, TAG_COMMENT, tag_get(data, TAG_COMMENT) + 50) == 0);
+    CHECK(tag_length(data, TAG_COMMENT) == 150 && strspn(tag_get(data, TAG_COMMENT), "c") == 150);
+    free(buf);
+    free_tag_data(data);
+}
+
+static void test_space_reuse(void)
+{
+    TagData *data = create_tag_data();
+    char buf[512];
+
+    // Repeated edits of a long value do not grow the arena.
+    CHECK(tag_set(data, TAG_COMMENT, repeat(buf, 'x', 300)) == 0);
+    size_t used = data->arena_len;
+    for (int i = 0; i < 100; i++)
+    {
+        CHECK(tag_set(data, TAG_COMMENT, repeat(buf, (char)('a' + i % 26), 300 - i)) == 0);
+        CHECK(tag_length(data, TAG_COMMENT) == (size_t)(300 - i));
+        CHECK(strcmp(tag_get(data, TAG_COMMENT), buf) == 0);
+    }
+    CHECK(data->arena_len == used);
+
+    // A longer value needs new space.
+    CHECK(tag_set(data, TAG_COMMENT, repeat(buf, 'y', 400)) == 0);
+    CHECK(data->arena_len > used && strcmp(tag_get(data, TAG_COMMENT), buf) == 0);
+    free_tag_data(data);
+}
+
+void test_tagdata(void)
+{
+    test_inline_and_spilled();
+    test_self_reference();
+    test_space_reuse();
+}
@@ -0,0 +1,156 @@
+/**
+ * @file test_util.c
+ * @brief Checks, scratch files and generated MP3 fixtures for the test driver.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include "test_util.h"
+#include "id3_utils.h"
+
+#define TEST_PATH_BUFFERS 8     /**< test_path() results usable at once */
+#define MPEG_FRAME_SIZE   417   /**< Bytes of a 128 kbit/s, 44.1 kHz MPEG-1 Layer III frame */
+
+static int failures;
+static char scratch[256];
+
+void test_fail(const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    failures++;
+}
+
+int test_failures(void)
+{
+    return failures;
+}
+
+int test_scratch_create(void)
+{
+    const char *tmp = getenv("TMPDIR");
+    snprintf(scratch, sizeof(scratch), "%s/id3_tests.XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    return mkdtemp(scratch) ? 0 : -1;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st; (void)flag; (void)ftw;
+    return remove(path);
+}
+
+void test_scratch_remove(void)
+{
+    if (scratch[0]) nftw(scratch, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+const char *test_path(const char *name)
+{
+    static char buffers[TEST_PATH_BUFFERS][512];
+    static int next;
+    char *p = buffers[next++ % TEST_PATH_BUFFERS];
+    snprintf(p, sizeof(buffers[0]), "%s/%s", scratch, name);
+    return p;
+}
+
+int test_write_mp3(const char *path, int major, const TestFrame *frames, size_t count,
+                   size_t padding, size_t audio)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return -1;
+
+    size_t size = padding;
+    for (size_t i = 0; i < count; i++)
+    {
+        size += FRAME_HEADER_SIZE + (frames[i].len ? frames[i].len : strlen(frames[i].value));
+    }
+    unsigned char header[ID3_HEADER_SIZE] = { 'I', 'D', '3', (unsigned char)major, 0, 0 };
+    id3_syncsafe_encode((unsigned int)size, &header[6]);
+    fwrite(header, 1, sizeof(header), fp);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t len = frames[i].len ? frames[i].len : strlen(frames[i].value);
+        unsigned char fh[FRAME_HEADER_SIZE] = { 0 };
+        memcpy(fh, frames[i].id, 4);
+        if (major == 4)
+        {
+            id3_syncsafe_encode((unsigned int)len, &fh[4]);
+        }
+        else
+        {
+            fh[4] = (unsigned char)(len >> 24);
+            fh[5] = (unsigned char)(len >> 16);
+            fh[6] = (unsigned char)(len >> 8);
+            fh[7] = (unsigned char)len;
+        }
+        fwrite(fh, 1, sizeof(fh), fp);
+        fwrite(frames[i].value, 1, len, fp);
+    }
+    for (size_t i = 0; i < padding; i++) fputc(0, fp);
+
+    unsigned char frame[MPEG_FRAME_SIZE] = { 0xFF, 0xFB, 0x90, 0x00 };
+    for (size_t done = 0; done < audio; done += sizeof(frame))
+    {
+        fwrite(frame, 1, sizeof(frame), fp);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+int test_write_text(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fputs(text, fp);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+char *test_read_file(const char *path, size_t *len)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    size_t cap = 4096, n = 0;
+    char *buf = (char *)malloc(cap + 1);
+    size_t got;
+    while (buf && (got = fread(buf + n, 1, cap - n, fp)) > 0)
+    {
+        n += got;
+        if (n == cap)
+        {
+            char *p = (char *)realloc(buf, cap * 2 + 1);
+            if (!p) free(buf);
+            buf = p;
+            cap *= 2;
+        }
+    }
+    fclose(fp);
+    if (!buf) return NULL;
+    buf[n] = '\0';
+    if (len) *len = n;
+    return buf;
+}
+
+long long test_file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_size : -1;
+}
+
+int test_count(const char *path, const char *needle)
+{
+    size_t len, nlen = strlen(needle);
+    char *buf = test_read_file(path, &len);
+    if (!buf) return -1;
+    int count = 0;
+    for (size_t i = 0; i + nlen <= len; i++)
+    {
+        if (memcmp(buf + i, needle, nlen) == 0) count++;
+    }
+    free(buf);
+    return count;
+}
@@ -0,0 +1,116 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stddef.h>
+
+/**
+ * @brief Records a failed check; the suite keeps running.
+ */
+#define CHECK(cond) \
+    do { if (!(cond)) test_fail(__FILE__, __LINE__, #cond); } while (0)
+
+/**
+ * @brief A frame of a generated fixture.
+ */
+typedef struct
+{
+    const char *id;     /**< 4-character frame ID */
+    const char *value;  /**< Frame content */
+    size_t len;         /**< Length of @c value, or 0 to use strlen() */
+} TestFrame;
+
+/**
+ * @brief Reports a failed check and counts it.
+ */
+void test_fail(const char *file, int line, const char *expr);
+
+/**
+ * @brief Returns the number of failed checks so far.
+ */
+int test_failures(void);
+
+/**
+ * @brief Creates the scratch directory of the run.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int test_scratch_create(void);
+
+/**
+ * @brief Deletes the scratch directory and everything in it.
+ */
+void test_scratch_remove(void);
+
+/**
+ * @brief Returns the path of a file in the run's scratch directory.
+ *
+ * The result lives in one of a few rotating static buffers.
+ *
+ * @param name File name.
+ */
+const char *test_path(const char *name);
+
+/**
+ * @brief Writes an MP3 fixture: an ID3v2 tag holding @p frames, then MPEG audio frames.
+ *
+ * Frame contents are stored as the writer stores them, without an encoding byte.
+ *
+ * @param path    File to create.
+ * @param major   Tag version, 3 or 4 (v2.4 frame sizes are sync-safe).
+ * @param frames  Frames of the tag.
+ * @param count   Number of frames.
+ * @param padding Zero bytes after the frames, inside the tag.
+ * @param audio   Bytes of audio (whole 417-byte MPEG-1 Layer III frames, rounded up).
+ * @return 0 on success, -1 on failure.
+ */
+int test_write_mp3(const char *path, int major, const TestFrame *frames, size_t count,
+                   size_t padding, size_t audio);
+
+/**
+ * @brief Writes a text file.
+ */
+int test_write_text(const char *path, const char *text);
+
+/**
+ * @brief Reads a whole file into a NUL-terminated buffer the caller frees.
+ */
+char *test_read_file(const char *path, size_t *len);
+
+/**
+ * @brief Returns the size of a file, or -1.
+ */
+long long test_file_size(const char *path);
+
+/**
+ * @brief Counts the occurrences of a byte string in a file.
+ */
+int test_count(const char *path, const char *needle);
+
+/* Suites, one per feature; each checks the behavior its request introduced. */
+void test_io(void);
+void test_parser(void);
+void test_pool(void);
+void test_tagdata(void);
+void test_intern(void);
+void test_manifest(void);
+void test_archive(void);
+void test_copy(void);
+void test_pattern(void);
+void test_index(void);
+void test_normalize(void);
+void test_writer(void);
+void test_stats(void);
+void test_dupes(void);
+void test_playlist(void);
+void test_lock(void);
+void test_shard(void);
+void test_queue(void);
+void test_budget(void);
+void test_retry(void);
+void test_rate(void);
+void test_hardlink(void);
+void test_cache(void);
+void test_shm(void);
+void test_catalog(void);
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,116 @@
+/**
+ * @file test_writer.c
+ * @brief Tag rewrites keep unknown frames; unchanged and same-length edits write little or nothing.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "test_util.h"
+#include "id3_reader.h"
+#include "id3_writer.h"
+
+#define PICTURE_SIZE 300 /**< Bytes of the fixture's picture frame */
+
+static char picture[PICTURE_SIZE];
+
+/**
+ * @brief Writes a fixture with a title, an artist, a picture and a private frame, and no padding.
+ */
+static const char *make_file(const char *name, int major, const char *title)
+{
+    for (int i = 0; i < PICTURE_SIZE; i++) picture[i] = (char)(i * 7);
+    TestFrame frames[] =
+    {
+        { "TIT2", title, 0 }, { "APIC", picture, PICTURE_SIZE },
+        { "TPE1", "Artist", 0 }, { "PRIV", "owner\0data", 10 },
+    };
+    const char *path = test_path(name);
+    CHECK(test_write_mp3(path, major, frames, 4, 0, 2000) == 0);
+    return path;
+}
+
+/**
+ * @brief Returns non-zero if the file still holds the picture and private frames, once each.
+ */
+static int keeps_other_frames(const char *path)
+{
+    size_t len;
+    char *bytes = test_read_file(path, &len);
+    int ok = bytes && test_count(path, "APIC") == 1 && test_count(path, "PRIV") == 1 &&
+             memmem(bytes, len, picture, PICTURE_SIZE) != NULL &&
+             memmem(bytes, len, "owner\0data", 10) != NULL;
+    free(bytes);
+    TagData *data = read_id3_tags(path);
+    ok = ok && data && data->art_bytes == PICTURE_SIZE;
+    free_tag_data(data);
+    return ok;
+}
+
+static void test_growing_edit(void)
+{
+    for (int major = 3; major <= 4; major++)
+    {
+        const char *path = make_file(major == 3 ? "grow3.mp3" : "grow4.mp3", major, "Title");
+        long long size = test_file_size(path);
+
+        // A longer value (past 127 bytes, where v2.4 sizes differ) needs a bigger tag.
+        char title[200];
+        memset(title, 't', sizeof(title) - 1);
+        title[sizeof(title) - 1] = '\0';
+        CHECK(edit_tag(path, "title", title) == 0);
+        CHECK(test_file_size(path) > size);
+        CHECK(keeps_other_frames(path));
+
+        TagData *data = read_id3_tags(path);
+        CHECK(data && strcmp(tag_get(data, TAG_TITLE), title) == 0);
+        CHECK(data && strcmp(tag_get(data, TAG_ARTIST), "Artist") == 0);
+        CHECK(data && strstr(data->version, major == 3 ? "2.3" : "2.4") != NULL);
+
+        // New fields are added and cleared ones removed, around the kept frames.
+        if (data)
+        {
+            tag_set(data, TAG_ALBUM, "Album");
+            tag_set(data, TAG_ARTIST, NULL);
+            CHECK(write_id3_tags(path, data) == 0);
+        }
+        free_tag_data(data);
+        CHECK(keeps_other_frames(path));
+        CHECK(test_count(path, "TPE1") == 0 && test_count(path, "TALB") == 1);
+        data = read_id3_tags(path);
+        CHECK(data && strcmp(tag_get(data, TAG_ALBUM), "Album") == 0 && tag_get(data, TAG_TITLE));
+        free_tag_data(data);
+    }
+}
+
+static void test_same_length_and_no_op(void)
+{
+    const char *path = make_file("patch.mp3", 3, "Title");
+    struct stat before, after;
+
+    // An unchanged value writes nothing, so the file's times stay as they were.
+    const struct timespec old[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    CHECK(utimensat(AT_FDCWD, path, old, 0) == 0);
+    CHECK(edit_tag(path, "title", "Title") == 0);
+    CHECK(stat(path, &after) == 0 && after.st_mtime == 1000000000);
+
+    // A same-length value is patched into its frame: same inode, same size.
+    CHECK(stat(path, &before) == 0);
+    CHECK(edit_tag(path, "title", "Other") == 0);
+    CHECK(stat(path, &after) == 0);
+    CHECK(after.st_ino == before.st_ino && after.st_size == before.st_size);
+    CHECK(after.st_mtime != 1000000000);
+    CHECK(keeps_other_frames(path));
+    TagData *data = read_id3_tags(path);
+    CHECK(data && strcmp(tag_get(data, TAG_TITLE), "Other") == 0);
+    free_tag_data(data);
+}
+
+void test_writer(void)
+{
+    test_growing_edit();
+    test_same_length_and_no_op();
+}